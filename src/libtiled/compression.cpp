@@ -34,9 +34,19 @@
 #include <zlib.h>
 #endif
 
+#ifdef TILED_ZSTD_SUPPORT
+#include <zstd.h>
+#endif
+
+#ifdef TILED_LZ4_SUPPORT
+#include <lz4frame.h>
+#endif
+
 #include <QByteArray>
 #include <QDebug>
 
+#include <cstring>
+
 #ifdef Z_PREFIX
 #undef compress
 #endif
@@ -63,7 +73,79 @@ static void logZlibError(int error)
     }
 }
 
-QByteArray Tiled::decompress(const QByteArray &data, int expectedSize)
+bool Tiled::compressionSupported(CompressionMethod method)
+{
+    switch (method) {
+    case Gzip:
+    case Zlib:
+        return true;
+    case Zstandard:
+#ifdef TILED_ZSTD_SUPPORT
+        return true;
+#else
+        return false;
+#endif
+    case Lz4:
+#ifdef TILED_LZ4_SUPPORT
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    return false;
+}
+
+int Tiled::minimumCompressionLevel(CompressionMethod method)
+{
+    switch (method) {
+    case Gzip:
+    case Zlib:
+        return Z_NO_COMPRESSION;
+    case Zstandard:
+        return 1;
+    case Lz4:
+        return 0;   // Fast compression, higher levels use LZ4 HC
+    }
+
+    return 0;
+}
+
+int Tiled::maximumCompressionLevel(CompressionMethod method)
+{
+    switch (method) {
+    case Gzip:
+    case Zlib:
+        return Z_BEST_COMPRESSION;
+    case Zstandard:
+#ifdef TILED_ZSTD_SUPPORT
+        return ZSTD_maxCLevel();
+#else
+        return 1;
+#endif
+    case Lz4:
+        return 12;  // LZ4HC_CLEVEL_MAX, higher levels behave the same
+    }
+
+    return 0;
+}
+
+/**
+ * Returns the given compression \a level, or -1 to select the default level
+ * when the level is not accepted by the compression \a method.
+ */
+static int checkedCompressionLevel(CompressionMethod method, int level)
+{
+    if (level != -1 && (level < minimumCompressionLevel(method) ||
+                        level > maximumCompressionLevel(method))) {
+        qDebug() << "Invalid compression level" << level
+                 << "for this compression method, using the default level";
+        return -1;
+    }
+    return level;
+}
+
+static QByteArray decompressZlib(const QByteArray &data, int expectedSize)
 {
     QByteArray out;
     out.resize(expectedSize);
@@ -120,8 +202,109 @@ QByteArray Tiled::decompress(const QByteArray &data, int expectedSize)
     return out;
 }
 
-QByteArray Tiled::compress(const QByteArray &data, CompressionMethod method)
+QByteArray Tiled::decompress(const QByteArray &data, int expectedSize,
+                             CompressionMethod method)
 {
+    if (method == Gzip || method == Zlib)
+        return decompressZlib(data, expectedSize);
+
+    Decompressor decompressor(method);
+    decompressor.setInput(data.constData(), data.size());
+
+    QByteArray out;
+    out.resize(qMax(expectedSize, 1024));
+    int size = 0;
+
+    while (!decompressor.atEnd()) {
+        if (size == out.size())
+            out.resize(out.size() * 2);
+
+        const int read = decompressor.decompress(out.data() + size,
+                                                 out.size() - size);
+        if (read < 0)
+            return QByteArray();
+
+        // No progress means the data is truncated
+        if (read == 0 && !decompressor.atEnd())
+            return QByteArray();
+
+        size += read;
+    }
+
+    // Data following the compressed stream is considered an error
+    if (!decompressor.needsInput())
+        return QByteArray();
+
+    out.resize(size);
+    return out;
+}
+
+static QByteArray compressZstandard(const QByteArray &data, int level)
+{
+#ifdef TILED_ZSTD_SUPPORT
+    if (level == -1)
+        level = 3;  // The default level used by the zstd command line tool
+
+    QByteArray out;
+    out.resize(int(ZSTD_compressBound(data.size())));
+
+    const size_t size = ZSTD_compress(out.data(), out.size(),
+                                      data.constData(), data.size(),
+                                      level);
+    if (ZSTD_isError(size)) {
+        qDebug() << "Error while compressing data:" << ZSTD_getErrorName(size);
+        return QByteArray();
+    }
+
+    out.resize(int(size));
+    return out;
+#else
+    Q_UNUSED(data)
+    Q_UNUSED(level)
+    qDebug() << "Zstandard compression is not supported!";
+    return QByteArray();
+#endif
+}
+
+static QByteArray compressLz4(const QByteArray &data, int level)
+{
+#ifdef TILED_LZ4_SUPPORT
+    LZ4F_preferences_t preferences;
+    std::memset(&preferences, 0, sizeof(preferences));
+    if (level != -1)
+        preferences.compressionLevel = level;
+
+    QByteArray out;
+    out.resize(int(LZ4F_compressFrameBound(data.size(), &preferences)));
+
+    const size_t size = LZ4F_compressFrame(out.data(), out.size(),
+                                           data.constData(), data.size(),
+                                           &preferences);
+    if (LZ4F_isError(size)) {
+        qDebug() << "Error while compressing data:" << LZ4F_getErrorName(size);
+        return QByteArray();
+    }
+
+    out.resize(int(size));
+    return out;
+#else
+    Q_UNUSED(data)
+    Q_UNUSED(level)
+    qDebug() << "LZ4 compression is not supported!";
+    return QByteArray();
+#endif
+}
+
+QByteArray Tiled::compress(const QByteArray &data, CompressionMethod method,
+                           int level)
+{
+    level = checkedCompressionLevel(method, level);
+
+    if (method == Zstandard)
+        return compressZstandard(data, level);
+    if (method == Lz4)
+        return compressLz4(data, level);
+
     QByteArray out;
     out.resize(1024);
     int err;
@@ -136,7 +319,7 @@ QByteArray Tiled::compress(const QByteArray &data, CompressionMethod method)
 
     const int windowBits = (method == Gzip) ? 15 + 16 : 15;
 
-    err = deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits,
+    err = deflateInit2(&strm, level, Z_DEFLATED, windowBits,
                        8, Z_DEFAULT_STRATEGY);
     if (err != Z_OK) {
         logZlibError(err);
@@ -169,3 +352,341 @@ QByteArray Tiled::compress(const QByteArray &data, CompressionMethod method)
     out.resize(outLength);
     return out;
 }
+
+
+namespace Tiled {
+
+class DecompressorPrivate
+{
+public:
+    int decompressZlib(char *out, int maxSize);
+    int decompressZstandard(char *out, int maxSize);
+    int decompressLz4(char *out, int maxSize);
+
+    CompressionMethod method;
+    bool initialized;
+    bool finished;
+    bool error;
+
+    // Used by zlib and gzip
+    z_stream stream;
+
+    // Used by the other methods
+    const char *input;
+    int inputSize;
+
+#ifdef TILED_ZSTD_SUPPORT
+    ZSTD_DStream *zstdStream;
+#endif
+#ifdef TILED_LZ4_SUPPORT
+    LZ4F_decompressionContext_t lz4Context;
+#endif
+};
+
+} // namespace Tiled
+
+Decompressor::Decompressor(CompressionMethod method)
+    : d(new DecompressorPrivate)
+{
+    d->method = method;
+    d->initialized = false;
+    d->finished = false;
+    d->input = 0;
+    d->inputSize = 0;
+
+    switch (method) {
+    case Gzip:
+    case Zlib: {
+        z_stream &strm = d->stream;
+        strm.zalloc = Z_NULL;
+        strm.zfree = Z_NULL;
+        strm.opaque = Z_NULL;
+        strm.next_in = Z_NULL;
+        strm.avail_in = 0;
+
+        const int ret = inflateInit2(&strm, 15 + 32);
+        d->initialized = ret == Z_OK;
+
+        if (!d->initialized)
+            logZlibError(ret);
+        break;
+    }
+    case Zstandard:
+#ifdef TILED_ZSTD_SUPPORT
+        d->zstdStream = ZSTD_createDStream();
+        d->initialized = d->zstdStream &&
+                !ZSTD_isError(ZSTD_initDStream(d->zstdStream));
+#endif
+        if (!d->initialized)
+            qDebug() << "Unable to initialize Zstandard decompression!";
+        break;
+    case Lz4:
+#ifdef TILED_LZ4_SUPPORT
+        d->initialized = !LZ4F_isError(
+                    LZ4F_createDecompressionContext(&d->lz4Context,
+                                                    LZ4F_VERSION));
+#endif
+        if (!d->initialized)
+            qDebug() << "Unable to initialize LZ4 decompression!";
+        break;
+    }
+
+    d->error = !d->initialized;
+}
+
+Decompressor::~Decompressor()
+{
+    if (d->initialized) {
+        switch (d->method) {
+        case Gzip:
+        case Zlib:
+            inflateEnd(&d->stream);
+            break;
+        case Zstandard:
+#ifdef TILED_ZSTD_SUPPORT
+            ZSTD_freeDStream(d->zstdStream);
+#endif
+            break;
+        case Lz4:
+#ifdef TILED_LZ4_SUPPORT
+            LZ4F_freeDecompressionContext(d->lz4Context);
+#endif
+            break;
+        }
+    }
+
+    delete d;
+}
+
+void Decompressor::setInput(const char *data, int size)
+{
+    if (d->method == Gzip || d->method == Zlib) {
+        d->stream.next_in = (Bytef *) data;
+        d->stream.avail_in = size;
+    } else {
+        d->input = data;
+        d->inputSize = size;
+    }
+}
+
+bool Decompressor::needsInput() const
+{
+    if (d->method == Gzip || d->method == Zlib)
+        return d->stream.avail_in == 0;
+    return d->inputSize == 0;
+}
+
+int Decompressor::decompress(char *out, int maxSize)
+{
+    if (d->error)
+        return -1;
+    if (d->finished || maxSize == 0)
+        return 0;
+
+    switch (d->method) {
+    case Zstandard:
+        return d->decompressZstandard(out, maxSize);
+    case Lz4:
+        return d->decompressLz4(out, maxSize);
+    default:
+        return d->decompressZlib(out, maxSize);
+    }
+}
+
+bool Decompressor::atEnd() const
+{
+    return d->finished;
+}
+
+bool Decompressor::hasError() const
+{
+    return d->error;
+}
+
+int DecompressorPrivate::decompressZlib(char *out, int maxSize)
+{
+    z_stream &strm = stream;
+    strm.next_out = (Bytef *) out;
+    strm.avail_out = maxSize;
+
+    int ret = inflate(&strm, Z_NO_FLUSH);
+
+    switch (ret) {
+        case Z_NEED_DICT:
+        case Z_STREAM_ERROR:
+            ret = Z_DATA_ERROR;
+        case Z_DATA_ERROR:
+        case Z_MEM_ERROR:
+            logZlibError(ret);
+            error = true;
+            return -1;
+        case Z_STREAM_END:
+            finished = true;
+            break;
+    }
+
+    return maxSize - strm.avail_out;
+}
+
+int DecompressorPrivate::decompressZstandard(char *out, int maxSize)
+{
+#ifdef TILED_ZSTD_SUPPORT
+    ZSTD_inBuffer in = { input, size_t(inputSize), 0 };
+    ZSTD_outBuffer outBuffer = { out, size_t(maxSize), 0 };
+
+    const size_t ret = ZSTD_decompressStream(zstdStream, &outBuffer, &in);
+    if (ZSTD_isError(ret)) {
+        qDebug() << "Error while decompressing data:" << ZSTD_getErrorName(ret);
+        error = true;
+        return -1;
+    }
+
+    input += in.pos;
+    inputSize -= int(in.pos);
+
+    // A return value of 0 means the frame is fully decoded and flushed
+    if (ret == 0)
+        finished = true;
+
+    return int(outBuffer.pos);
+#else
+    Q_UNUSED(out)
+    Q_UNUSED(maxSize)
+    return -1;
+#endif
+}
+
+int DecompressorPrivate::decompressLz4(char *out, int maxSize)
+{
+#ifdef TILED_LZ4_SUPPORT
+    size_t outSize = maxSize;
+    size_t inSize = inputSize;
+
+    const size_t ret = LZ4F_decompress(lz4Context, out, &outSize,
+                                       input, &inSize, 0);
+    if (LZ4F_isError(ret)) {
+        qDebug() << "Error while decompressing data:" << LZ4F_getErrorName(ret);
+        error = true;
+        return -1;
+    }
+
+    input += inSize;
+    inputSize -= int(inSize);
+
+    // A return value of 0 means the frame is fully decoded
+    if (ret == 0)
+        finished = true;
+
+    return int(outSize);
+#else
+    Q_UNUSED(out)
+    Q_UNUSED(maxSize)
+    return -1;
+#endif
+}
+
+
+namespace Tiled {
+
+class CompressorPrivate
+{
+public:
+    bool deflateTo(QByteArray *out, int flush);
+
+    bool initialized;
+    bool error;
+    z_stream stream;
+};
+
+} // namespace Tiled
+
+Compressor::Compressor(CompressionMethod method, int level)
+    : d(new CompressorPrivate)
+{
+    d->initialized = false;
+
+    if (method == Gzip || method == Zlib) {
+        z_stream &strm = d->stream;
+        strm.zalloc = Z_NULL;
+        strm.zfree = Z_NULL;
+        strm.opaque = Z_NULL;
+        strm.next_in = Z_NULL;
+        strm.avail_in = 0;
+
+        const int windowBits = (method == Gzip) ? 15 + 16 : 15;
+
+        level = checkedCompressionLevel(method, level);
+
+        const int ret = deflateInit2(&strm, level, Z_DEFLATED, windowBits,
+                                     8, Z_DEFAULT_STRATEGY);
+        d->initialized = ret == Z_OK;
+
+        if (!d->initialized)
+            logZlibError(ret);
+    } else {
+        qDebug() << "Incremental compression is only supported for zlib and gzip!";
+    }
+
+    d->error = !d->initialized;
+}
+
+Compressor::~Compressor()
+{
+    if (d->initialized)
+        deflateEnd(&d->stream);
+
+    delete d;
+}
+
+bool Compressor::compress(const char *data, int size, QByteArray *out)
+{
+    if (d->error)
+        return false;
+
+    d->stream.next_in = (Bytef *) data;
+    d->stream.avail_in = size;
+    return d->deflateTo(out, Z_NO_FLUSH);
+}
+
+bool Compressor::finish(QByteArray *out)
+{
+    if (d->error)
+        return false;
+
+    d->stream.next_in = Z_NULL;
+    d->stream.avail_in = 0;
+    return d->deflateTo(out, Z_FINISH);
+}
+
+bool Compressor::hasError() const
+{
+    return d->error;
+}
+
+bool CompressorPrivate::deflateTo(QByteArray *out, int flush)
+{
+    char buffer[16384];
+    int ret;
+
+    do {
+        stream.next_out = (Bytef *) buffer;
+        stream.avail_out = sizeof(buffer);
+
+        ret = deflate(&stream, flush);
+        if (ret == Z_STREAM_ERROR) {
+            logZlibError(ret);
+            error = true;
+            return false;
+        }
+
+        out->append(buffer, int(sizeof(buffer) - stream.avail_out));
+    } while (stream.avail_out == 0);
+
+    if (flush == Z_FINISH && ret != Z_STREAM_END) {
+        logZlibError(ret);
+        error = true;
+        return false;
+    }
+
+    return true;
+}
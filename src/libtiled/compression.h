@@ -37,35 +37,157 @@ namespace Tiled {
 
 enum CompressionMethod {
     Gzip,
-    Zlib
+    Zlib,
+    Zstandard,
+    Lz4
 };
 
 /**
- * Decompresses either zlib or gzip compressed memory. Returns a null
- * QByteArray if decompressing failed.
+ * Returns whether the given compression \a method is available. Zstandard
+ * and LZ4 support are optional, depending on the libraries found at build
+ * time.
+ */
+bool TILEDSHARED_EXPORT compressionSupported(CompressionMethod method);
+
+/**
+ * Returns the lowest compression level accepted by the given compression
+ * \a method, apart from -1, which always selects the default level.
+ */
+int TILEDSHARED_EXPORT minimumCompressionLevel(CompressionMethod method);
+
+/**
+ * Returns the highest compression level accepted by the given compression
+ * \a method.
+ */
+int TILEDSHARED_EXPORT maximumCompressionLevel(CompressionMethod method);
+
+/**
+ * Decompresses either zlib, gzip, Zstandard or LZ4 compressed memory.
+ * Returns a null QByteArray if decompressing failed.
  *
  * Needed because qUncompress does not support gzip compressed data. Also,
  * this method does not need the expected size to be prepended to the data,
  * but it can be passed as optional parameter.
  *
+ * The zlib and gzip formats are detected automatically, so for these the
+ * \a method parameter makes no difference.
+ *
  * @param data         the compressed data
  * @param expectedSize the expected size of the uncompressed data in bytes
+ * @param method       the compression method that was used
  * @return the uncompressed data, or a null QByteArray if decompressing failed
  */
 QByteArray TILEDSHARED_EXPORT decompress(const QByteArray &data,
-                                         int expectedSize = 1024);
+                                         int expectedSize = 1024,
+                                         CompressionMethod method = Zlib);
 
 /**
- * Compresses the give data in either gzip or zlib format. Returns a null
- * QByteArray if compression failed.
+ * Compresses the give data in gzip, zlib, Zstandard or LZ4 format. Returns
+ * a null QByteArray if compression failed.
  *
  * Needed because qCompress does not support gzip compression.
  *
- * @param data the uncompressed data
+ * @param data   the uncompressed data
+ * @param method the compression method to use
+ * @param level  the compression level, or -1 to use the default level of
+ *               the compression method. Levels outside of the range
+ *               accepted by the method also use the default level.
  * @return the compressed data, or a null QByteArray if compression failed
  */
 QByteArray TILEDSHARED_EXPORT compress(const QByteArray &data,
-                                       CompressionMethod method = Zlib);
+                                       CompressionMethod method = Zlib,
+                                       int level = -1);
+
+class DecompressorPrivate;
+
+/**
+ * Decompresses either zlib, gzip, Zstandard or LZ4 compressed data
+ * incrementally. This allows large amounts of data to be processed in
+ * fixed-size blocks, without ever holding all of the uncompressed data in
+ * memory.
+ */
+class TILEDSHARED_EXPORT Decompressor
+{
+public:
+    explicit Decompressor(CompressionMethod method = Zlib);
+    ~Decompressor();
+
+    /**
+     * Sets the next block of compressed input. The data is not copied, so
+     * it needs to stay valid until needsInput() returns true.
+     */
+    void setInput(const char *data, int size);
+
+    /**
+     * Returns whether all input set with setInput() has been consumed.
+     */
+    bool needsInput() const;
+
+    /**
+     * Decompresses available input into \a out, writing at most \a maxSize
+     * bytes.
+     *
+     * @return the number of bytes written, or -1 when an error occurred
+     */
+    int decompress(char *out, int maxSize);
+
+    /**
+     * Returns whether the end of the compressed stream has been reached.
+     */
+    bool atEnd() const;
+
+    /**
+     * Returns whether an error occurred while decompressing.
+     */
+    bool hasError() const;
+
+private:
+    Q_DISABLE_COPY(Decompressor)
+
+    DecompressorPrivate *d;
+};
+
+class CompressorPrivate;
+
+/**
+ * Compresses data in zlib or gzip format incrementally. This allows large
+ * amounts of data to be compressed in fixed-size blocks, without ever
+ * holding all of the uncompressed data in memory.
+ */
+class TILEDSHARED_EXPORT Compressor
+{
+public:
+    explicit Compressor(CompressionMethod method = Zlib, int level = -1);
+    ~Compressor();
+
+    /**
+     * Compresses \a size bytes of \a data, appending any compressed output
+     * that is ready to \a out.
+     *
+     * @return <code>true</code> on success, <code>false</code> when an error
+     *         occurred
+     */
+    bool compress(const char *data, int size, QByteArray *out);
+
+    /**
+     * Ends the compressed stream, appending the remaining compressed output
+     * to \a out.
+     *
+     * @return <code>true</code> on success, <code>false</code> when an error
+     *         occurred
+     */
+    bool finish(QByteArray *out);
+
+    /**
+     * Returns whether an error occurred while compressing.
+     */
+    bool hasError() const;
+
+private:
+    Q_DISABLE_COPY(Compressor)
+
+    CompressorPrivate *d;
+};
 
 } // namespace Tiled
 
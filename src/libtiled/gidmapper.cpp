@@ -31,6 +31,8 @@
 #include "tile.h"
 #include "tileset.h"
 
+#include <QtAlgorithms>
+
 using namespace Tiled;
 
 // Bits on the far end of the 32-bit global tile ID are used for tile flags
@@ -38,11 +40,17 @@ const int FlippedHorizontallyFlag   = 0x80000000;
 const int FlippedVerticallyFlag     = 0x40000000;
 const int FlippedAntiDiagonallyFlag = 0x20000000;
 
+// Limits the memory used by the table mapping gids to tilesets. Beyond this
+// range, a binary search is used instead.
+const int MaxGidTableSize = 1 << 20;
+
 GidMapper::GidMapper()
+    : mLookupTablesDirty(false)
 {
 }
 
 GidMapper::GidMapper(const QList<Tileset *> &tilesets)
+    : mLookupTablesDirty(false)
 {
     unsigned firstGid = 1;
     foreach (Tileset *tileset, tilesets) {
@@ -51,6 +59,18 @@ GidMapper::GidMapper(const QList<Tileset *> &tilesets)
     }
 }
 
+void GidMapper::insert(unsigned firstGid, Tileset *tileset)
+{
+    mFirstGidToTileset.insert(firstGid, tileset);
+    mLookupTablesDirty = true;
+}
+
+void GidMapper::clear()
+{
+    mFirstGidToTileset.clear();
+    mLookupTablesDirty = true;
+}
+
 Cell GidMapper::gidToCell(unsigned gid, bool &ok) const
 {
     Cell result;
@@ -70,14 +90,20 @@ Cell GidMapper::gidToCell(unsigned gid, bool &ok) const
     } else if (isEmpty()) {
         ok = false;
     } else {
+        updateLookupTables();
+
         // Find the tileset containing this tile
-        QMap<unsigned, Tileset*>::const_iterator i = mFirstGidToTileset.upperBound(gid);
-        --i; // Navigate one tileset back since upper bound finds the next
-        int tileId = gid - i.key();
-        const Tileset *tileset = i.value();
+        const int index = tilesetIndexForGid(gid);
+        if (index == -1) {
+            ok = false;
+            return result;
+        }
+
+        int tileId = gid - mFirstGids.at(index);
+        const Tileset *tileset = mTilesets.at(index);
 
         if (tileset) {
-            const int columnCount = mTilesetColumnCounts.value(tileset);
+            const int columnCount = mColumnCounts.at(index);
             if (columnCount > 0 && columnCount != tileset->columnCount()) {
                 // Correct tile index for changes in image width
                 const int row = tileId / columnCount;
@@ -103,16 +129,16 @@ unsigned GidMapper::cellToGid(const Cell &cell) const
 
     const Tileset *tileset = cell.tile->tileset();
 
+    updateLookupTables();
+
     // Find the first GID for the tileset
-    QMap<unsigned, Tileset*>::const_iterator i = mFirstGidToTileset.begin();
-    QMap<unsigned, Tileset*>::const_iterator i_end = mFirstGidToTileset.end();
-    while (i != i_end && i.value() != tileset)
-        ++i;
+    QHash<const Tileset*, unsigned>::const_iterator i =
+            mTilesetFirstGids.find(tileset);
 
-    if (i == i_end) // tileset not found
+    if (i == mTilesetFirstGids.end()) // tileset not found
         return 0;
 
-    unsigned gid = i.key() + cell.tile->id();
+    unsigned gid = i.value() + cell.tile->id();
     if (cell.flippedHorizontally)
         gid |= FlippedHorizontallyFlag;
     if (cell.flippedVertically)
@@ -129,4 +155,72 @@ void GidMapper::setTilesetWidth(const Tileset *tileset, int width)
         return;
 
     mTilesetColumnCounts.insert(tileset, tileset->columnCountForWidth(width));
+    mLookupTablesDirty = true;
+}
+
+/**
+ * Rebuilds the lookup tables from the first gid and column count maps.
+ */
+void GidMapper::updateLookupTables() const
+{
+    if (!mLookupTablesDirty)
+        return;
+
+    mLookupTablesDirty = false;
+
+    mTilesetFirstGids.clear();
+    mFirstGids.clear();
+    mTilesets.clear();
+    mColumnCounts.clear();
+    mGidToTilesetIndex.clear();
+
+    QMap<unsigned, Tileset*>::const_iterator i = mFirstGidToTileset.begin();
+    QMap<unsigned, Tileset*>::const_iterator i_end = mFirstGidToTileset.end();
+    for (; i != i_end; ++i) {
+        // When a tileset was inserted more than once, the lowest first gid
+        // is used for writing
+        if (!mTilesetFirstGids.contains(i.value()))
+            mTilesetFirstGids.insert(i.value(), i.key());
+
+        mFirstGids.append(i.key());
+        mTilesets.append(i.value());
+        mColumnCounts.append(mTilesetColumnCounts.value(i.value()));
+    }
+
+    if (mFirstGids.size() < 2)
+        return;
+
+    // Map each gid up to the first gid of the last tileset to the index of
+    // its tileset. Higher gids always belong to the last tileset.
+    const unsigned tableSize = mFirstGids.last() - mFirstGids.first();
+    if (tableSize > unsigned(MaxGidTableSize))
+        return;
+
+    mGidToTilesetIndex.resize(tableSize);
+    for (int index = 0; index < mFirstGids.size() - 1; ++index) {
+        const unsigned start = mFirstGids.at(index) - mFirstGids.first();
+        const unsigned end = mFirstGids.at(index + 1) - mFirstGids.first();
+        for (unsigned gid = start; gid < end; ++gid)
+            mGidToTilesetIndex[gid] = index;
+    }
+}
+
+/**
+ * Returns the index of the tileset containing the given \a gid, or -1 when
+ * the gid lies before the first tileset.
+ */
+int GidMapper::tilesetIndexForGid(unsigned gid) const
+{
+    if (mFirstGids.isEmpty() || gid < mFirstGids.first())
+        return -1;
+    if (gid >= mFirstGids.last())
+        return mFirstGids.size() - 1;
+
+    if (!mGidToTilesetIndex.isEmpty())
+        return mGidToTilesetIndex.at(gid - mFirstGids.first());
+
+    QVector<unsigned>::const_iterator it = qUpperBound(mFirstGids.begin(),
+                                                       mFirstGids.end(),
+                                                       gid);
+    return (it - mFirstGids.begin()) - 1;
 }
@@ -31,12 +31,17 @@
 
 #include "tilelayer.h"
 
+#include <QHash>
 #include <QMap>
+#include <QVector>
 
 namespace Tiled {
 
 /**
  * A class that maps cells to global IDs (gids) and back.
+ *
+ * Lookup tables are built on the first lookup after tilesets were inserted,
+ * so that both directions of the mapping take constant time per cell.
  */
 class TILEDSHARED_EXPORT GidMapper
 {
@@ -55,13 +60,12 @@ public:
     /**
      * Insert the given \a tileset with \a firstGid as its first global ID.
      */
-    void insert(unsigned firstGid, Tileset *tileset)
-    { mFirstGidToTileset.insert(firstGid, tileset); }
+    void insert(unsigned firstGid, Tileset *tileset);
 
     /**
      * Clears the gid mapper, so that it can be reused.
      */
-    void clear() { mFirstGidToTileset.clear(); }
+    void clear();
 
     /**
      * Returns true when no tilesets are known to this gid mapper.
@@ -87,9 +91,27 @@ public:
      */
     void setTilesetWidth(const Tileset *tileset, int width);
 
+    /**
+     * Builds the lookup tables when tilesets were inserted or their widths
+     * were set since they were last built. This happens on the first lookup,
+     * but needs to be done before the gid mapper is used from several
+     * threads at the same time.
+     */
+    void updateLookupTables() const;
+
 private:
+    int tilesetIndexForGid(unsigned gid) const;
+
     QMap<unsigned, Tileset*> mFirstGidToTileset;
     QMap<const Tileset*, int> mTilesetColumnCounts;
+
+    // Lookup tables derived from the above maps
+    mutable QHash<const Tileset*, unsigned> mTilesetFirstGids;
+    mutable QVector<unsigned> mFirstGids;
+    mutable QVector<Tileset*> mTilesets;
+    mutable QVector<int> mColumnCounts;
+    mutable QVector<int> mGidToTilesetIndex;
+    mutable bool mLookupTablesDirty;
 };
 
 } // namespace Tiled
@@ -0,0 +1,179 @@
+/*
+ * imagecache.cpp
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "imagecache.h"
+
+#include <QFileInfo>
+
+using namespace Tiled;
+
+namespace {
+
+/**
+ * The default maximum amount of memory used by cached images, in kilobytes.
+ */
+const int DefaultMaximumCost = 256 * 1024;
+
+} // anonymous namespace
+
+Q_GLOBAL_STATIC(ImageCache, sharedImageCache)
+
+
+AtlasPages::AtlasPages(const QVector<QImage> &images)
+    : mImages(images)
+    , mPixmaps(images.size())
+{
+}
+
+QImage AtlasPages::image(int page) const
+{
+    QMutexLocker locker(&mMutex);
+    if (!mImages.at(page).isNull())
+        return mImages.at(page);
+    return mPixmaps.at(page).toImage();
+}
+
+const QPixmap &AtlasPages::pixmap(int page) const
+{
+    QMutexLocker locker(&mMutex);
+    if (mPixmaps.at(page).isNull() && !mImages.at(page).isNull()) {
+        mPixmaps[page] = QPixmap::fromImage(mImages.at(page));
+        mImages[page] = QImage();
+    }
+
+    // The pixmap is not changed anymore once converted
+    return mPixmaps.at(page);
+}
+
+
+ImageCache::ImageCache()
+    : mEntries(DefaultMaximumCost)
+{
+}
+
+ImageCache *ImageCache::instance()
+{
+    return sharedImageCache();
+}
+
+QImage ImageCache::loadImage(const QString &fileName)
+{
+    const QFileInfo fileInfo(fileName);
+    const QString key = fileInfo.canonicalFilePath();
+    if (key.isEmpty())
+        return QImage(fileName);
+
+    const QDateTime lastModified = fileInfo.lastModified();
+    const qint64 size = fileInfo.size();
+
+    {
+        QMutexLocker locker(&mMutex);
+        if (const Entry *entry = mEntries.object(key))
+            if (entry->lastModified == lastModified && entry->size == size)
+                return entry->image;
+    }
+
+    // Decode without holding the lock, so that other threads can use the
+    // cache in the meantime. When two threads decode the same image, the
+    // last one to finish replaces the entry, which does no harm.
+    const QImage image(key);
+    if (image.isNull())
+        return image;
+
+    Entry *entry = new Entry;
+    entry->lastModified = lastModified;
+    entry->size = size;
+    entry->image = image;
+
+    QMutexLocker locker(&mMutex);
+    mEntries.insert(key, entry, qMax(1, image.byteCount() / 1024));
+    return image;
+}
+
+void ImageCache::remove(const QString &fileName)
+{
+    const QString key = QFileInfo(fileName).canonicalFilePath();
+    if (key.isEmpty())
+        return;
+
+    QMutexLocker locker(&mMutex);
+    mEntries.remove(key);
+}
+
+SharedAtlasPages ImageCache::atlas(const QString &key)
+{
+    QMutexLocker locker(&mMutex);
+    return mAtlases.value(key).toStrongRef();
+}
+
+void ImageCache::insertAtlas(const QString &key, const SharedAtlasPages &atlas)
+{
+    QMutexLocker locker(&mMutex);
+
+    // Forget about the atlases that are no longer used by any tileset
+    QMutableHashIterator<QString, QWeakPointer<AtlasPages> > it(mAtlases);
+    while (it.hasNext())
+        if (it.next().value().isNull())
+            it.remove();
+
+    mAtlases.insert(key, atlas.toWeakRef());
+}
+
+QString ImageCache::atlasKey(const QImage &image,
+                             const QColor &transparentColor,
+                             int tileWidth, int tileHeight,
+                             int tileSpacing, int margin)
+{
+    const QString transparent = transparentColor.isValid() ?
+                transparentColor.name() : QString();
+
+    return QString(QLatin1String("%1:%2:%3x%4:%5:%6"))
+            .arg(image.cacheKey())
+            .arg(transparent)
+            .arg(tileWidth).arg(tileHeight)
+            .arg(tileSpacing).arg(margin);
+}
+
+void ImageCache::setMaximumCost(int kilobytes)
+{
+    QMutexLocker locker(&mMutex);
+    mEntries.setMaxCost(kilobytes);
+}
+
+int ImageCache::maximumCost() const
+{
+    QMutexLocker locker(&mMutex);
+    return mEntries.maxCost();
+}
+
+void ImageCache::clear()
+{
+    QMutexLocker locker(&mMutex);
+    mEntries.clear();
+    mAtlases.clear();
+}
@@ -0,0 +1,179 @@
+/*
+ * imagecache.h
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include "tiled_global.h"
+
+#include <QCache>
+#include <QColor>
+#include <QDateTime>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QPixmap>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+#include <QWeakPointer>
+
+namespace Tiled {
+
+/**
+ * The pages of a tileset atlas. The pages are prepared as images, which
+ * allows tilesets to be loaded outside of the GUI thread, and are converted
+ * to pixmaps when they are first drawn.
+ *
+ * Atlases prepared from a tileset image are shared through the ImageCache by
+ * all tilesets that use the same image with the same tile layout, so that
+ * each of their pages only exists once as a pixmap.
+ */
+class TILEDSHARED_EXPORT AtlasPages
+{
+public:
+    explicit AtlasPages(const QVector<QImage> &images);
+
+    int count() const { return mPixmaps.size(); }
+
+    /**
+     * Returns the image of the given \a page.
+     */
+    QImage image(int page) const;
+
+    /**
+     * Returns the pixmap of the given \a page, converting it when it wasn't
+     * converted yet. Needs to be called from a thread that can use pixmaps.
+     */
+    const QPixmap &pixmap(int page) const;
+
+private:
+    Q_DISABLE_COPY(AtlasPages)
+
+    mutable QMutex mMutex;
+    mutable QVector<QImage> mImages;    // Pages not yet converted to pixmaps
+    mutable QVector<QPixmap> mPixmaps;
+};
+
+typedef QSharedPointer<AtlasPages> SharedAtlasPages;
+
+/**
+ * A process-wide cache of decoded images, shared between all maps, tilesets
+ * and readers. Images are looked up by their canonical file path and are
+ * decoded again when the file was modified since it was cached.
+ *
+ * The returned images are implicitly shared with the cached ones, so an image
+ * used by several tilesets is only held in memory once. When the total size
+ * of the cached images exceeds the maximum cost, the least recently used
+ * images are dropped from the cache, which doesn't affect their users.
+ *
+ * The cache can be used from multiple threads at the same time.
+ */
+class TILEDSHARED_EXPORT ImageCache
+{
+public:
+    ImageCache();
+
+    /**
+     * Returns the cache instance shared by the whole process.
+     */
+    static ImageCache *instance();
+
+    /**
+     * Returns the image stored in \a fileName, decoding it only when it isn't
+     * cached yet or when the file changed. Returns a null image when the file
+     * could not be read.
+     */
+    QImage loadImage(const QString &fileName);
+
+    /**
+     * Removes the image stored in \a fileName from the cache, so that it is
+     * decoded again the next time it is loaded. Used when a reload is
+     * requested explicitly, since the modification time of a file may not
+     * have changed when it was written twice within a short time.
+     */
+    void remove(const QString &fileName);
+
+    /**
+     * Returns the atlas prepared for the given \a key, or a null pointer
+     * when no tileset is using such an atlas at the moment.
+     *
+     * \sa atlasKey()
+     */
+    SharedAtlasPages atlas(const QString &key);
+
+    /**
+     * Shares the given \a atlas under the given \a key. The cache only holds
+     * a weak reference, so the atlas is released along with the last tileset
+     * using it.
+     */
+    void insertAtlas(const QString &key, const SharedAtlasPages &atlas);
+
+    /**
+     * Returns the key of the atlas prepared from \a image with the given
+     * transparent color and tile layout.
+     *
+     * The key refers to the decoded image rather than to its file, so that an
+     * image returned by loadImage() leads to the same atlas for as long as it
+     * is cached, while an image decoded again after the file changed leads to
+     * a new one.
+     */
+    static QString atlasKey(const QImage &image,
+                            const QColor &transparentColor,
+                            int tileWidth, int tileHeight,
+                            int tileSpacing, int margin);
+
+    /**
+     * Sets the maximum amount of memory used by cached images, in kilobytes.
+     */
+    void setMaximumCost(int kilobytes);
+    int maximumCost() const;
+
+    /**
+     * Removes all images and atlases from the cache.
+     */
+    void clear();
+
+private:
+    Q_DISABLE_COPY(ImageCache)
+
+    struct Entry
+    {
+        QDateTime lastModified;
+        qint64 size;
+        QImage image;
+    };
+
+    mutable QMutex mMutex;
+    QCache<QString, Entry> mEntries;
+    QHash<QString, QWeakPointer<AtlasPages> > mAtlases;
+};
+
+} // namespace Tiled
+
+#endif // IMAGECACHE_H
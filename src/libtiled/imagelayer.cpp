@@ -30,7 +30,6 @@
 #include "imagelayer.h"
 #include "map.h"
 
-#include <QBitmap>
 
 using namespace Tiled;
 
@@ -43,26 +42,50 @@ ImageLayer::~ImageLayer()
 {
 }
 
+/**
+ * Returns the image of this layer. An image set by loadFromImage() is
+ * converted to a pixmap the first time it is requested, which allows image
+ * layers to be loaded outside of the GUI thread.
+ */
+const QPixmap &ImageLayer::image() const
+{
+    if (!mPendingImage.isNull()) {
+        mImage = QPixmap::fromImage(mPendingImage);
+        mPendingImage = QImage();
+    }
+
+    return mImage;
+}
+
 void ImageLayer::resetImage()
 {
     mImage = QPixmap();
+    mPendingImage = QImage();
     mImageSource.clear();
 }
 
 bool ImageLayer::loadFromImage(const QImage &image, const QString &fileName)
 {
     mImageSource = fileName;
+    mImage = QPixmap();
 
     if (image.isNull()) {
-        mImage = QPixmap();
+        mPendingImage = QImage();
         return false;
     }
 
-    mImage = QPixmap::fromImage(image);
-
     if (mTransparentColor.isValid()) {
-        const QImage mask = image.createMaskFromColor(mTransparentColor.rgb());
-        mImage.setMask(QBitmap::fromImage(mask));
+        QImage masked = image.convertToFormat(QImage::Format_ARGB32);
+        const QRgb transparent = mTransparentColor.rgb();
+        for (int y = 0; y < masked.height(); ++y) {
+            QRgb *line = reinterpret_cast<QRgb*>(masked.scanLine(y));
+            for (int x = 0; x < masked.width(); ++x)
+                if (line[x] == transparent)
+                    line[x] = 0;
+        }
+        mPendingImage = masked;
+    } else {
+        mPendingImage = image;
     }
 
     return true;
@@ -70,7 +93,7 @@ bool ImageLayer::loadFromImage(const QImage &image, const QString &fileName)
 
 bool ImageLayer::isEmpty() const
 {
-    return mImage.isNull();
+    return mImage.isNull() && mPendingImage.isNull();
 }
 
 Layer *ImageLayer::clone() const
@@ -85,6 +108,7 @@ ImageLayer *ImageLayer::initializeClone(ImageLayer *clone) const
     clone->mImageSource = mImageSource;
     clone->mTransparentColor = mTransparentColor;
     clone->mImage = mImage;
+    clone->mPendingImage = mPendingImage;
 
     return clone;
 }
@@ -36,9 +36,9 @@
 #include "tileset.h"
 
 #include <QColor>
+#include <QImage>
 #include <QPixmap>
 
-class QImage;
 
 namespace Tiled {
 
@@ -90,12 +90,13 @@ public:
     /**
       * Returns the image of this layer.
       */
-    const QPixmap &image() const { return mImage; }
+    const QPixmap &image() const;
 
     /**
       * Sets the image of this layer.
       */
-    void setImage(const QPixmap &image) { mImage = image; }
+    void setImage(const QPixmap &image)
+    { mImage = image; mPendingImage = QImage(); }
 
     /**
      * Resets layer image.
@@ -130,7 +131,8 @@ protected:
 private:
     QString mImageSource;
     QColor mTransparentColor;
-    QPixmap mImage;
+    mutable QPixmap mImage;
+    mutable QImage mPendingImage;   // Image not yet converted to a pixmap
 };
 
 } // namespace Tiled
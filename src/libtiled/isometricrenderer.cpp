@@ -70,7 +70,7 @@ QRectF IsometricRenderer::boundingRect(const MapObject *object) const
     if (!object->cell().isEmpty()) {
         const QPointF bottomCenter = pixelToScreenCoords(object->position());
         const Tile *tile = object->cell().tile;
-        const QSize imgSize = tile->image().size();
+        const QSize imgSize = tile->size();
         const QPoint tileOffset = tile->tileset()->tileOffset();
         return QRectF(bottomCenter.x() + tileOffset.x() - imgSize.width() / 2,
                       bottomCenter.y() + tileOffset.y() - imgSize.height(),
@@ -221,7 +221,7 @@ void IsometricRenderer::drawTileLayer(QPainter *painter,
     // Determine whether the current row is shifted half a tile to the right
     bool shifted = inUpperHalf ^ inLeftHalf;
 
-    CellRenderer renderer(painter);
+    CellRenderer renderer(painter, levelOfDetailThreshold());
 
     for (int y = startPos.y(); y - tileHeight < rect.bottom();
          y += tileHeight / 2)
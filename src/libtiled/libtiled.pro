@@ -22,6 +22,18 @@ win32 {
     LIBS += -lz
 }
 
+# Optional support for Zstandard and LZ4 compressed layer data
+unix:!contains(DISABLE_ZSTD, yes):system(pkg-config --exists libzstd) {
+    DEFINES += TILED_ZSTD_SUPPORT
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libzstd
+}
+unix:!contains(DISABLE_LZ4, yes):system(pkg-config --exists liblz4) {
+    DEFINES += TILED_LZ4_SUPPORT
+    CONFIG += link_pkgconfig
+    PKGCONFIG += liblz4
+}
+
 DEFINES += QT_NO_CAST_FROM_ASCII \
     QT_NO_CAST_TO_ASCII
 DEFINES += TILED_LIBRARY
@@ -29,6 +41,7 @@ contains(QT_CONFIG, reduce_exports): CONFIG += hide_symbols
 
 SOURCES += compression.cpp \
     gidmapper.cpp \
+    imagecache.cpp \
     imagelayer.cpp \
     isometricrenderer.cpp \
     layer.cpp \
@@ -41,12 +54,14 @@ SOURCES += compression.cpp \
     orthogonalrenderer.cpp \
     properties.cpp \
     staggeredrenderer.cpp \
+    threadsupport.cpp \
     tile.cpp \
     tilelayer.cpp \
     tileset.cpp \
     hexagonalrenderer.cpp
 HEADERS += compression.h \
     gidmapper.h \
+    imagecache.h \
     imagelayer.h \
     isometricrenderer.h \
     layer.h \
@@ -63,6 +78,7 @@ HEADERS += compression.h \
     properties.h \
     staggeredrenderer.h \
     terrain.h \
+    threadsupport.h \
     tile.h \
     tiled.h \
     tiled_global.h \
@@ -52,6 +52,7 @@ Map::Map(Orientation orientation,
     mStaggerAxis(StaggerY),
     mStaggerIndex(StaggerOdd),
     mLayerDataFormat(Base64Zlib),
+    mCompressionLevel(-1),
     mNextObjectId(1)
 {
 }
@@ -71,6 +72,7 @@ Map::Map(const Map &map):
     mDrawMargins(map.mDrawMargins),
     mTilesets(map.mTilesets),
     mLayerDataFormat(map.mLayerDataFormat),
+    mCompressionLevel(map.mCompressionLevel),
     mNextObjectId(1)
 {
     foreach (const Layer *layer, map.mLayers) {
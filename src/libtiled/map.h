@@ -77,7 +77,9 @@ public:
         Base64     = 1,
         Base64Gzip = 2,
         Base64Zlib = 3,
-        CSV        = 4
+        CSV        = 4,
+        Base64Zstd = 5,
+        Base64Lz4  = 6
     };
 
     /**
@@ -369,6 +371,14 @@ public:
     void setLayerDataFormat(LayerDataFormat format)
     { mLayerDataFormat = format; }
 
+    /**
+     * Returns the compression level used when saving compressed layer data.
+     * A value of -1 means the default level of the compression method is
+     * used.
+     */
+    int compressionLevel() const { return mCompressionLevel; }
+    void setCompressionLevel(int level) { mCompressionLevel = level; }
+
     /**
      * Sets the next id to be used for objects on this map.
      */
@@ -405,6 +415,7 @@ private:
     QList<Layer*> mLayers;
     QList<Tileset*> mTilesets;
     LayerDataFormat mLayerDataFormat;
+    int mCompressionLevel;
     int mNextObjectId;
 };
 
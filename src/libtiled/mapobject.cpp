@@ -29,6 +29,8 @@
 
 #include "mapobject.h"
 
+#include "objectgroup.h"
+
 using namespace Tiled;
 
 MapObject::MapObject():
@@ -80,6 +82,19 @@ void MapObject::flip(FlipDirection direction)
     }
 }
 
+QRectF MapObject::boundsWithPolygon() const
+{
+    const QRectF bounds = QRectF(mPos, mSize).normalized();
+    if (mPolygon.isEmpty())
+        return bounds;
+
+    const QRectF polygonBounds = mPolygon.boundingRect().translated(mPos);
+    return QRectF(QPointF(qMin(bounds.left(), polygonBounds.left()),
+                          qMin(bounds.top(), polygonBounds.top())),
+                  QPointF(qMax(bounds.right(), polygonBounds.right()),
+                          qMax(bounds.bottom(), polygonBounds.bottom())));
+}
+
 MapObject *MapObject::clone() const
 {
     MapObject *o = new MapObject(mName, mType, mPos, mSize);
@@ -90,3 +105,13 @@ MapObject *MapObject::clone() const
     o->setRotation(mRotation);
     return o;
 }
+
+/**
+ * Lets the object group know that the bounds of this object changed, so that
+ * it can keep its spatial index up to date.
+ */
+void MapObject::boundsChanged()
+{
+    if (mObjectGroup)
+        mObjectGroup->objectBoundsChanged(this);
+}
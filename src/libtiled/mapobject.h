@@ -116,7 +116,7 @@ public:
     /**
      * Sets the position of this object.
      */
-    void setPosition(const QPointF &pos) { mPos = pos; }
+    void setPosition(const QPointF &pos) { mPos = pos; boundsChanged(); }
 
     /**
      * Returns the x position of this object.
@@ -126,7 +126,7 @@ public:
     /**
      * Sets the x position of this object.
      */
-    void setX(qreal x) { mPos.setX(x); }
+    void setX(qreal x) { mPos.setX(x); boundsChanged(); }
 
     /**
      * Returns the y position of this object.
@@ -136,7 +136,7 @@ public:
     /**
      * Sets the x position of this object.
      */
-    void setY(qreal y) { mPos.setY(y); }
+    void setY(qreal y) { mPos.setY(y); boundsChanged(); }
 
     /**
      * Returns the size of this object.
@@ -146,7 +146,7 @@ public:
     /**
      * Sets the size of this object.
      */
-    void setSize(const QSizeF &size) { mSize = size; }
+    void setSize(const QSizeF &size) { mSize = size; boundsChanged(); }
 
     void setSize(qreal width, qreal height)
     { setSize(QSizeF(width, height)); }
@@ -159,7 +159,7 @@ public:
     /**
      * Sets the width of this object.
      */
-    void setWidth(qreal width) { mSize.setWidth(width); }
+    void setWidth(qreal width) { mSize.setWidth(width); boundsChanged(); }
 
     /**
      * Returns the height of this object.
@@ -169,7 +169,7 @@ public:
     /**
      * Sets the height of this object.
      */
-    void setHeight(qreal height) { mSize.setHeight(height); }
+    void setHeight(qreal height) { mSize.setHeight(height); boundsChanged(); }
 
     /**
      * Sets the polygon associated with this object. The polygon is only used
@@ -177,7 +177,7 @@ public:
      *
      * \sa setShape()
      */
-    void setPolygon(const QPolygonF &polygon) { mPolygon = polygon; }
+    void setPolygon(const QPolygonF &polygon) { mPolygon = polygon; boundsChanged(); }
 
     /**
      * Returns the polygon associated with this object. Returns an empty
@@ -200,6 +200,12 @@ public:
      */
     QRectF bounds() const { return QRectF(mPos, mSize); }
 
+    /**
+     * Returns the bounds of this object, extended to include its polygon
+     * when it has one.
+     */
+    QRectF boundsWithPolygon() const;
+
     /**
      * Sets the tile that is associated with this object. The object will
      * display as the tile image.
@@ -251,6 +257,8 @@ public:
     MapObject *clone() const;
 
 private:
+    void boundsChanged();
+
     int mId;
     QString mName;
     QString mType;
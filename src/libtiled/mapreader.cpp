@@ -32,6 +32,7 @@
 
 #include "compression.h"
 #include "gidmapper.h"
+#include "imagecache.h"
 #include "imagelayer.h"
 #include "objectgroup.h"
 #include "map.h"
@@ -45,20 +46,165 @@
 #include <QDebug>
 #include <QDir>
 #include <QFileInfo>
+#include <QRunnable>
+#include <QThreadPool>
 #include <QVector>
 #include <QXmlStreamReader>
 
+#include <cstring>
+
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+namespace {
+
+// The size of the blocks in which binary layer data is decoded
+const int BlockSize = 16384;
+
+/**
+ * Decodes base64 encoded text incrementally. Characters outside of the base64
+ * alphabet, like whitespace and padding, are skipped.
+ */
+class Base64Decoder
+{
+public:
+    explicit Base64Decoder(const QString &text)
+        : mData(text.constData())
+        , mEnd(mData + text.size())
+        , mBits(0)
+        , mBitCount(0)
+    {}
+
+    bool atEnd() const { return mData == mEnd; }
+
+    /**
+     * Decodes up to \a maxSize bytes into \a out. Returns the number of bytes
+     * written, which is only less than \a maxSize at the end of the text.
+     */
+    int read(char *out, int maxSize)
+    {
+        int size = 0;
+
+        while (size < maxSize && mData != mEnd) {
+            const ushort c = (mData++)->unicode();
+            unsigned value;
+
+            if (c >= 'A' && c <= 'Z')
+                value = c - 'A';
+            else if (c >= 'a' && c <= 'z')
+                value = c - 'a' + 26;
+            else if (c >= '0' && c <= '9')
+                value = c - '0' + 52;
+            else if (c == '+')
+                value = 62;
+            else if (c == '/')
+                value = 63;
+            else
+                continue;
+
+            mBits = (mBits << 6) | value;
+            mBitCount += 6;
+
+            if (mBitCount >= 8) {
+                mBitCount -= 8;
+                out[size++] = char(mBits >> mBitCount);
+            }
+        }
+
+        return size;
+    }
+
+private:
+    const QChar *mData;
+    const QChar *mEnd;
+    unsigned mBits;
+    int mBitCount;
+};
+
+/**
+ * Provides the bytes of base64 encoded and optionally compressed layer data
+ * in blocks.
+ */
+class BinaryLayerDataStream
+{
+public:
+    BinaryLayerDataStream(const QString &text, bool compressed,
+                          CompressionMethod method)
+        : mBase64(text)
+        , mDecompressor(compressed ? new Decompressor(method) : 0)
+    {}
+
+    ~BinaryLayerDataStream() { delete mDecompressor; }
+
+    /**
+     * Reads up to \a maxSize bytes into \a out. Returns the number of bytes
+     * read, 0 at the end of the data or -1 when the data is corrupt.
+     */
+    int read(char *out, int maxSize)
+    {
+        if (!mDecompressor)
+            return mBase64.read(out, maxSize);
+
+        for (;;) {
+            if (mDecompressor->needsInput() && !mBase64.atEnd()) {
+                const int size = mBase64.read(mInput, BlockSize);
+                mDecompressor->setInput(mInput, size);
+            }
+
+            const int size = mDecompressor->decompress(out, maxSize);
+
+            if (size != 0)
+                return size;
+
+            if (mDecompressor->atEnd()) {
+                // Any data following the compressed stream is an error
+                char rest;
+                if (!mDecompressor->needsInput() || mBase64.read(&rest, 1))
+                    return -1;
+                return 0;
+            }
+
+            // Stop when no progress can be made or the stream is truncated
+            if (!mDecompressor->needsInput() || mBase64.atEnd())
+                return -1;
+        }
+    }
+
+private:
+    Base64Decoder mBase64;
+    Decompressor *mDecompressor;
+    char mInput[BlockSize];
+};
+
+} // anonymous namespace
+
 namespace Tiled {
 namespace Internal {
 
+/**
+ * The encoded data of a tile layer. It is captured while parsing the XML and
+ * decoded once the whole map has been read, so that multiple layers can be
+ * decoded in parallel.
+ */
+struct LayerData
+{
+    TileLayer *tileLayer;
+    QString encoding;
+    QString compression;
+    QString text;
+    QString error;
+
+    // Location of the <data> element, used when reporting errors
+    qint64 lineNumber;
+    qint64 columnNumber;
+};
+
 class MapReaderPrivate
 {
     Q_DECLARE_TR_FUNCTIONS(MapReader)
 
     friend class Tiled::MapReader;
+    friend class LayerDataDecoder;
 
 public:
     MapReaderPrivate(MapReader *mapReader):
@@ -87,10 +233,15 @@ private:
 
     TileLayer *readLayer();
     void readLayerData(TileLayer *tileLayer);
-    void decodeBinaryLayerData(TileLayer *tileLayer,
-                               const QStringRef &text,
-                               const QStringRef &compression);
-    void decodeCSVLayerData(TileLayer *tileLayer, const QString &text);
+    void decodeLayerData();
+
+    static void decodeLayerData(LayerData &layerData,
+                                const GidMapper &gidMapper);
+    static void decodeBinaryLayerData(LayerData &layerData,
+                                      const GidMapper &gidMapper);
+    static void decodeCSVLayerData(LayerData &layerData,
+                                   const GidMapper &gidMapper);
+    static QString invalidGidError(const GidMapper &gidMapper, unsigned gid);
 
     /**
      * Returns the cell for the given global tile ID. Errors are raised with
@@ -119,12 +270,32 @@ private:
     QString mPath;
     Map *mMap;
     QList<Tileset*> mCreatedTilesets;
+    QList<LayerData> mLayerData;
     GidMapper mGidMapper;
     bool mReadingExternalTileset;
 
     QXmlStreamReader xml;
 };
 
+/**
+ * Decodes the data of a single tile layer on a worker thread.
+ */
+class LayerDataDecoder : public QRunnable
+{
+public:
+    LayerDataDecoder(LayerData *layerData, const GidMapper *gidMapper)
+        : mLayerData(layerData)
+        , mGidMapper(gidMapper)
+    {}
+
+    void run()
+    { MapReaderPrivate::decodeLayerData(*mLayerData, *mGidMapper); }
+
+private:
+    LayerData *mLayerData;
+    const GidMapper *mGidMapper;
+};
+
 } // namespace Internal
 } // namespace Tiled
 
@@ -249,6 +420,13 @@ Map *MapReaderPrivate::readMap()
     if (nextObjectId)
         mMap->setNextObjectId(nextObjectId);
 
+    bool compressionLevelOk;
+    const int compressionLevel =
+            atts.value(QLatin1String("compressionlevel")).toString()
+            .toInt(&compressionLevelOk);
+    if (compressionLevelOk)
+        mMap->setCompressionLevel(compressionLevel);
+
     mCreatedTilesets.clear();
 
     QStringRef bgColorString = atts.value(QLatin1String("backgroundcolor"));
@@ -270,6 +448,10 @@ Map *MapReaderPrivate::readMap()
             readUnknownElement();
     }
 
+    if (!xml.hasError())
+        decodeLayerData();
+    mLayerData.clear();
+
     // Clean up in case of error
     if (xml.hasError()) {
         // The tilesets are not owned by the map
@@ -413,7 +595,7 @@ void MapReaderPrivate::readTilesetTile(Tileset *tileset)
             QString source = xml.attributes().value(QLatin1String("source")).toString();
             if (!source.isEmpty())
                 source = p->resolveReference(source, mPath);
-            tileset->setTileImage(id, QPixmap::fromImage(readImage()), source);
+            tileset->setTileImage(id, readImage(), source);
         } else if (xml.name() == QLatin1String("objectgroup")) {
             tile->setObjectGroup(readObjectGroup());
         } else if (xml.name() == QLatin1String("animation")) {
@@ -593,10 +775,21 @@ void MapReaderPrivate::readLayerData(TileLayer *tileLayer)
                 mMap->setLayerDataFormat(Map::Base64Gzip);
             else if (compression == QLatin1String("zlib"))
                 mMap->setLayerDataFormat(Map::Base64Zlib);
+            else if (compression == QLatin1String("zstd"))
+                mMap->setLayerDataFormat(Map::Base64Zstd);
+            else if (compression == QLatin1String("lz4"))
+                mMap->setLayerDataFormat(Map::Base64Lz4);
         }
         // else, error handled below
     }
 
+    LayerData layerData;
+    layerData.tileLayer = tileLayer;
+    layerData.encoding = encoding.toString();
+    layerData.compression = compression.toString();
+    layerData.lineNumber = xml.lineNumber();
+    layerData.columnNumber = xml.columnNumber();
+
     int x = 0;
     int y = 0;
 
@@ -625,12 +818,9 @@ void MapReaderPrivate::readLayerData(TileLayer *tileLayer)
                 readUnknownElement();
             }
         } else if (xml.isCharacters() && !xml.isWhitespace()) {
-            if (encoding == QLatin1String("base64")) {
-                decodeBinaryLayerData(tileLayer,
-                                      xml.text(),
-                                      compression);
-            } else if (encoding == QLatin1String("csv")) {
-                decodeCSVLayerData(tileLayer, xml.text().toString());
+            if (encoding == QLatin1String("base64")
+                    || encoding == QLatin1String("csv")) {
+                layerData.text.append(xml.text());
             } else {
                 xml.raiseError(tr("Unknown encoding: %1")
                                .arg(encoding.toString()));
@@ -638,65 +828,183 @@ void MapReaderPrivate::readLayerData(TileLayer *tileLayer)
             }
         }
     }
+
+    // The actual decoding is deferred until the whole map has been read
+    if (!layerData.text.isEmpty())
+        mLayerData.append(layerData);
+}
+
+/**
+ * Decodes the data of all tile layers read so far. When there are multiple
+ * layers, they are decoded in parallel.
+ */
+void MapReaderPrivate::decodeLayerData()
+{
+    if (mLayerData.isEmpty())
+        return;
+
+    // While decoding, the layers are detached from the map, since setting
+    // their cells would otherwise adjust the draw margins of the map.
+    for (int i = 0; i < mLayerData.size(); ++i)
+        mLayerData.at(i).tileLayer->setMap(0);
+
+    // The gid mapper is shared by the decoding threads
+    mGidMapper.updateLookupTables();
+
+    if (mLayerData.size() == 1) {
+        decodeLayerData(mLayerData.first(), mGidMapper);
+    } else {
+        // A dedicated pool is used, since the reader may itself be running
+        // on a thread of the global pool
+        QThreadPool pool;
+        for (int i = 0; i < mLayerData.size(); ++i)
+            pool.start(new LayerDataDecoder(&mLayerData[i], &mGidMapper));
+        pool.waitForDone();
+    }
+
+    for (int i = 0; i < mLayerData.size(); ++i) {
+        const LayerData &layerData = mLayerData.at(i);
+        TileLayer *tileLayer = layerData.tileLayer;
+
+        tileLayer->setMap(mMap);
+        mMap->adjustDrawMargins(tileLayer->drawMargins());
+
+        // The reader is at the end of the document by now, so the location
+        // of the layer data is reported instead of the reader's location
+        if (!layerData.error.isEmpty() && !xml.hasError()) {
+            mError = tr("%3\n\nLine %1, column %2")
+                    .arg(layerData.lineNumber)
+                    .arg(layerData.columnNumber)
+                    .arg(layerData.error);
+            xml.raiseError(layerData.error);
+        }
+    }
+}
+
+/**
+ * Decodes the given layer data. Errors are stored in the layer data, since
+ * this function may be called from a worker thread.
+ */
+void MapReaderPrivate::decodeLayerData(LayerData &layerData,
+                                       const GidMapper &gidMapper)
+{
+    if (layerData.encoding == QLatin1String("base64"))
+        decodeBinaryLayerData(layerData, gidMapper);
+    else if (layerData.encoding == QLatin1String("csv"))
+        decodeCSVLayerData(layerData, gidMapper);
+
+    // Release the text right away, rather than with all other layers
+    layerData.text = QString();
 }
 
-void MapReaderPrivate::decodeBinaryLayerData(TileLayer *tileLayer,
-                                             const QStringRef &text,
-                                             const QStringRef &compression)
+/**
+ * Decodes base64 encoded, optionally compressed, layer data. The data is
+ * decoded, decompressed and converted to cells in blocks, so that the full
+ * uncompressed data is never held in memory.
+ */
+void MapReaderPrivate::decodeBinaryLayerData(LayerData &layerData,
+                                             const GidMapper &gidMapper)
 {
-#if QT_VERSION < 0x040800
-    const QString textData = QString::fromRawData(text.unicode(), text.size());
-    const QByteArray latin1Text = textData.toLatin1();
-#else
-    const QByteArray latin1Text = text.toLatin1();
-#endif
-    QByteArray tileData = QByteArray::fromBase64(latin1Text);
-    const int size = (tileLayer->width() * tileLayer->height()) * 4;
+    TileLayer *tileLayer = layerData.tileLayer;
+    const QString &compression = layerData.compression;
+
+    bool compressed = true;
+    CompressionMethod method = Zlib;
 
     if (compression == QLatin1String("zlib")
-        || compression == QLatin1String("gzip")) {
-        tileData = decompress(tileData, size);
-    } else if (!compression.isEmpty()) {
-        xml.raiseError(tr("Compression method '%1' not supported")
-                       .arg(compression.toString()));
-        return;
+            || compression == QLatin1String("gzip")) {
+        method = Zlib;
+    } else if (compression == QLatin1String("zstd")) {
+        method = Zstandard;
+    } else if (compression == QLatin1String("lz4")) {
+        method = Lz4;
+    } else {
+        compressed = false;
     }
 
-    if (size != tileData.length()) {
-        xml.raiseError(tr("Corrupt layer data for layer '%1'")
-                       .arg(tileLayer->name()));
+    if ((!compressed && !compression.isEmpty())
+            || (compressed && !compressionSupported(method))) {
+        layerData.error = tr("Compression method '%1' not supported")
+                .arg(compression);
         return;
     }
 
-    const unsigned char *data =
-            reinterpret_cast<const unsigned char*>(tileData.constData());
+    const QString corruptError = tr("Corrupt layer data for layer '%1'")
+            .arg(tileLayer->name());
+
+    BinaryLayerDataStream stream(layerData.text, compressed, method);
+    char buffer[BlockSize];
+    int buffered = 0;
+
+    const int width = tileLayer->width();
+    const int cellCount = width * tileLayer->height();
     int x = 0;
     int y = 0;
+    int index = 0;
+
+    for (;;) {
+        const int size = stream.read(buffer + buffered, BlockSize - buffered);
+        if (size < 0) {
+            layerData.error = corruptError;
+            return;
+        }
+        if (size == 0)
+            break;
+
+        buffered += size;
+
+        const unsigned char *data =
+                reinterpret_cast<const unsigned char*>(buffer);
+        const int complete = buffered - buffered % 4;
+
+        for (int i = 0; i < complete; i += 4) {
+            if (index == cellCount) {
+                layerData.error = corruptError;
+                return;
+            }
 
-    for (int i = 0; i < size - 3; i += 4) {
-        const unsigned gid = data[i] |
-                             data[i + 1] << 8 |
-                             data[i + 2] << 16 |
-                             data[i + 3] << 24;
+            const unsigned gid = data[i] |
+                                 data[i + 1] << 8 |
+                                 data[i + 2] << 16 |
+                                 data[i + 3] << 24;
 
-        tileLayer->setCell(x, y, cellForGid(gid));
+            bool ok;
+            const Cell cell = gidMapper.gidToCell(gid, ok);
+            if (!ok) {
+                layerData.error = invalidGidError(gidMapper, gid);
+                return;
+            }
 
-        x++;
-        if (x == tileLayer->width()) {
-            x = 0;
-            y++;
+            tileLayer->setCell(x, y, cell);
+            ++index;
+
+            x++;
+            if (x == width) {
+                x = 0;
+                y++;
+            }
         }
+
+        // Keep any incomplete gid for the next block
+        buffered -= complete;
+        std::memmove(buffer, buffer + complete, buffered);
     }
+
+    if (index != cellCount || buffered != 0)
+        layerData.error = corruptError;
 }
 
-void MapReaderPrivate::decodeCSVLayerData(TileLayer *tileLayer, const QString &text)
+void MapReaderPrivate::decodeCSVLayerData(LayerData &layerData,
+                                          const GidMapper &gidMapper)
 {
-    QString trimText = text.trimmed();
+    TileLayer *tileLayer = layerData.tileLayer;
+
+    QString trimText = layerData.text.trimmed();
     QStringList tiles = trimText.split(QLatin1Char(','));
 
     if (tiles.length() != tileLayer->width() * tileLayer->height()) {
-        xml.raiseError(tr("Corrupt layer data for layer '%1'")
-                       .arg(tileLayer->name()));
+        layerData.error = tr("Corrupt layer data for layer '%1'")
+                .arg(tileLayer->name());
         return;
     }
 
@@ -706,27 +1014,40 @@ void MapReaderPrivate::decodeCSVLayerData(TileLayer *tileLayer, const QString &t
             const unsigned gid = tiles.at(y * tileLayer->width() + x)
                     .toUInt(&conversionOk);
             if (!conversionOk) {
-                xml.raiseError(
+                layerData.error =
                         tr("Unable to parse tile at (%1,%2) on layer '%3'")
-                               .arg(x + 1).arg(y + 1).arg(tileLayer->name()));
+                               .arg(x + 1).arg(y + 1).arg(tileLayer->name());
                 return;
             }
-            tileLayer->setCell(x, y, cellForGid(gid));
+
+            bool ok;
+            const Cell cell = gidMapper.gidToCell(gid, ok);
+            if (!ok) {
+                layerData.error = invalidGidError(gidMapper, gid);
+                return;
+            }
+
+            tileLayer->setCell(x, y, cell);
         }
     }
 }
 
+QString MapReaderPrivate::invalidGidError(const GidMapper &gidMapper,
+                                          unsigned gid)
+{
+    if (gidMapper.isEmpty())
+        return tr("Tile used but no tilesets specified");
+    else
+        return tr("Invalid tile: %1").arg(gid);
+}
+
 Cell MapReaderPrivate::cellForGid(unsigned gid)
 {
     bool ok;
     const Cell result = mGidMapper.gidToCell(gid, ok);
 
-    if (!ok) {
-        if (mGidMapper.isEmpty())
-            xml.raiseError(tr("Tile used but no tilesets specified"));
-        else
-            xml.raiseError(tr("Invalid tile: %1").arg(gid));
-    }
+    if (!ok)
+        xml.raiseError(invalidGidError(mGidMapper, gid));
 
     return result;
 }
@@ -1032,7 +1353,7 @@ QString MapReader::resolveReference(const QString &reference,
 
 QImage MapReader::readExternalImage(const QString &source)
 {
-    return QImage(source);
+    return ImageCache::instance()->loadImage(source);
 }
 
 Tileset *MapReader::readExternalTileset(const QString &source,
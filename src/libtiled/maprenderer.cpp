@@ -35,6 +35,7 @@
 #include <QPaintEngine>
 #include <QPainter>
 #include <QVector2D>
+#include <QtCore/qmath.h>
 
 using namespace Tiled;
 
@@ -62,6 +63,30 @@ void MapRenderer::setFlag(RenderFlag flag, bool enabled)
         mFlags &= ~flag;
 }
 
+/**
+ * Returns the factor by which the given \a painter scales the drawn
+ * geometry on its device.
+ */
+qreal MapRenderer::deviceScale(const QPainter *painter)
+{
+    return qSqrt(qAbs(painter->transform().determinant()));
+}
+
+/**
+ * Returns whether tiles of the given \a tileSize should be drawn with reduced
+ * detail using the given \a painter.
+ */
+bool MapRenderer::useLevelOfDetail(const QPainter *painter,
+                                   const QSize &tileSize) const
+{
+    if (mLevelOfDetailThreshold <= 0)
+        return false;
+
+    const qreal scale = deviceScale(painter);
+    return tileSize.width() * scale < mLevelOfDetailThreshold &&
+            tileSize.height() * scale < mLevelOfDetailThreshold;
+}
+
 /**
  * Converts a line running from \a start to \a end to a polygon which
  * extends 5 pixels from the line in all directions.
@@ -91,37 +116,53 @@ static bool hasOpenGLEngine(const QPainter *painter)
             type == QPaintEngine::OpenGL2);
 }
 
-CellRenderer::CellRenderer(QPainter *painter)
+/**
+ * Constructs a cell renderer drawing with the given \a painter. Tiles that
+ * would be drawn smaller than \a levelOfDetailThreshold device pixels are
+ * filled with their average color instead.
+ */
+CellRenderer::CellRenderer(QPainter *painter, qreal levelOfDetailThreshold)
     : mPainter(painter)
-    , mTile(0)
+    , mImage(0)
     , mIsOpenGL(hasOpenGLEngine(painter))
+    , mMinimumTileSize(0)
 {
+    if (levelOfDetailThreshold > 0) {
+        const qreal scale = MapRenderer::deviceScale(painter);
+        if (scale > 0)
+            mMinimumTileSize = levelOfDetailThreshold / scale;
+    }
 }
 
 /**
  * Renders a \a cell with the given \a origin at \a pos, taking into account
  * the flipping and tile offset.
  *
- * For performance reasons, the actual drawing is delayed until a different
- * kind of tile has to be drawn. For this reason it is necessary to call
- * flush when finished doing drawCell calls. This function is also called by
- * the destructor so usually an explicit call it not needed.
+ * For performance reasons, the actual drawing is delayed until a tile has to
+ * be drawn from a different pixmap. Since tiles are drawn from the atlas of
+ * their tileset, this usually only happens when switching tilesets. For this
+ * reason it is necessary to call flush when finished doing drawCell calls.
+ * This function is also called by the destructor so usually an explicit call
+ * it not needed.
  */
 void CellRenderer::render(const Cell &cell, const QPointF &pos, Origin origin)
 {
-    if (mTile != cell.tile)
+    QRect sourceRect;
+    const Tile *tile = cell.tile->currentFrameTile();
+    const QPixmap &image = tile->atlasImage(&sourceRect);
+
+    if (mImage != &image)
         flush();
 
-    const QPixmap &image = cell.tile->currentFrameImage();
-    const QSizeF size = image.size();
+    const QSizeF size = sourceRect.size();
     const QPoint offset = cell.tile->tileset()->tileOffset();
     const QPointF sizeHalf = QPointF(size.width() / 2, size.height() / 2);
 
     QPainter::PixmapFragment fragment;
     fragment.x = pos.x() + offset.x() + sizeHalf.x();
     fragment.y = pos.y() + offset.y() + sizeHalf.y() - size.height();
-    fragment.sourceLeft = 0;
-    fragment.sourceTop = 0;
+    fragment.sourceLeft = sourceRect.left();
+    fragment.sourceTop = sourceRect.top();
     fragment.width = size.width();
     fragment.height = size.height();
     fragment.scaleX = cell.flippedHorizontally ? -1 : 1;
@@ -144,8 +185,26 @@ void CellRenderer::render(const Cell &cell, const QPointF &pos, Origin origin)
             fragment.x += halfDiff;
     }
 
+    if (size.width() < mMinimumTileSize && size.height() < mMinimumTileSize) {
+        const QRgb color = tile->averageColor();
+        if (qAlpha(color) == 0)
+            return;
+
+        flush();
+
+        QSizeF drawnSize = size;
+        if (fragment.rotation != 0)
+            drawnSize.transpose();
+
+        mPainter->fillRect(QRectF(fragment.x - drawnSize.width() / 2,
+                                  fragment.y - drawnSize.height() / 2,
+                                  drawnSize.width(), drawnSize.height()),
+                           QColor::fromRgba(color));
+        return;
+    }
+
     if (mIsOpenGL || (fragment.scaleX > 0 && fragment.scaleY > 0)) {
-        mTile = cell.tile;
+        mImage = &image;
         mFragments.append(fragment);
         return;
     }
@@ -163,7 +222,7 @@ void CellRenderer::render(const Cell &cell, const QPointF &pos, Origin origin)
 
     const QRectF target(fragment.width * -0.5, fragment.height * -0.5,
                         fragment.width, fragment.height);
-    const QRectF source(0, 0, fragment.width, fragment.height);
+    const QRectF source(sourceRect);
 
     mPainter->setTransform(transform);
     mPainter->drawPixmap(target, image, source);
@@ -175,13 +234,13 @@ void CellRenderer::render(const Cell &cell, const QPointF &pos, Origin origin)
  */
 void CellRenderer::flush()
 {
-    if (!mTile)
+    if (!mImage)
         return;
 
     mPainter->drawPixmapFragments(mFragments.constData(),
                                   mFragments.size(),
-                                  mTile->currentFrameImage());
+                                  *mImage);
 
-    mTile = 0;
+    mImage = 0;
     mFragments.resize(0);
 }
@@ -62,6 +62,7 @@ public:
         , mFlags(0)
         , mObjectLineWidth(2)
         , mPainterScale(1)
+        , mLevelOfDetailThreshold(0)
     {}
 
     virtual ~MapRenderer() {}
@@ -207,20 +208,34 @@ public:
     RenderFlags flags() const { return mFlags; }
     void setFlags(RenderFlags flags) { mFlags = flags; }
 
+    /**
+     * Returns the size in device pixels below which tiles are drawn with
+     * reduced detail, using only the average color of each tile. A value of
+     * 0 means tiles are always drawn in full detail.
+     */
+    qreal levelOfDetailThreshold() const { return mLevelOfDetailThreshold; }
+    void setLevelOfDetailThreshold(qreal threshold)
+    { mLevelOfDetailThreshold = threshold; }
+
     static QPolygonF lineToPolygon(const QPointF &start, const QPointF &end);
 
+    static qreal deviceScale(const QPainter *painter);
+
 protected:
     /**
      * Returns the map this renderer is associated with.
      */
     const Map *map() const { return mMap; }
 
+    bool useLevelOfDetail(const QPainter *painter, const QSize &tileSize) const;
+
 private:
     const Map *mMap;
 
     RenderFlags mFlags;
     qreal mObjectLineWidth;
     qreal mPainterScale;
+    qreal mLevelOfDetailThreshold;
 };
 
 inline QPointF MapRenderer::screenToTileCoords(const QPointF &point) const
@@ -255,7 +270,8 @@ public:
         BottomCenter
     };
 
-    explicit CellRenderer(QPainter *painter);
+    explicit CellRenderer(QPainter *painter,
+                          qreal levelOfDetailThreshold = 0);
 
     ~CellRenderer() { flush(); }
 
@@ -264,9 +280,10 @@ public:
 
 private:
     QPainter * const mPainter;
-    Tile *mTile;
+    const QPixmap *mImage;
     QVector<QPainter::PixmapFragment> mFragments;
     const bool mIsOpenGL;
+    qreal mMinimumTileSize;
 };
 
 } // namespace Tiled
@@ -77,6 +77,7 @@ public:
 
     QString mError;
     Map::LayerDataFormat mLayerDataFormat;
+    int mCompressionLevel;
     bool mDtdEnabled;
 
 private:
@@ -102,6 +103,7 @@ private:
 
 MapWriterPrivate::MapWriterPrivate()
     : mLayerDataFormat(Map::Base64Zlib)
+    , mCompressionLevel(-1)
     , mDtdEnabled(false)
     , mUseAbsolutePaths(false)
 {
@@ -131,6 +133,13 @@ void MapWriterPrivate::writeMap(const Map *map, QIODevice *device,
     mMapDir = QDir(path);
     mUseAbsolutePaths = path.isEmpty();
     mLayerDataFormat = map->layerDataFormat();
+    mCompressionLevel = map->compressionLevel();
+
+    // Fall back to zlib when the chosen compression method is not available
+    if ((mLayerDataFormat == Map::Base64Zstd && !compressionSupported(Zstandard))
+            || (mLayerDataFormat == Map::Base64Lz4 && !compressionSupported(Lz4))) {
+        mLayerDataFormat = Map::Base64Zlib;
+    }
 
     QXmlStreamWriter *writer = createWriter(device);
     writer->writeStartDocument();
@@ -203,6 +212,11 @@ void MapWriterPrivate::writeMap(QXmlStreamWriter &w, const Map *map)
     w.writeAttribute(QLatin1String("nextobjectid"),
                      QString::number(map->nextObjectId()));
 
+    if (map->compressionLevel() != -1) {
+        w.writeAttribute(QLatin1String("compressionlevel"),
+                         QString::number(map->compressionLevel()));
+    }
+
     writeProperties(w, map->properties());
 
     mGidMapper.clear();
@@ -405,7 +419,9 @@ void MapWriterPrivate::writeTileLayer(QXmlStreamWriter &w,
 
     if (mLayerDataFormat == Map::Base64
             || mLayerDataFormat == Map::Base64Gzip
-            || mLayerDataFormat == Map::Base64Zlib) {
+            || mLayerDataFormat == Map::Base64Zlib
+            || mLayerDataFormat == Map::Base64Zstd
+            || mLayerDataFormat == Map::Base64Lz4) {
 
         encoding = QLatin1String("base64");
 
@@ -413,6 +429,10 @@ void MapWriterPrivate::writeTileLayer(QXmlStreamWriter &w,
             compression = QLatin1String("gzip");
         else if (mLayerDataFormat == Map::Base64Zlib)
             compression = QLatin1String("zlib");
+        else if (mLayerDataFormat == Map::Base64Zstd)
+            compression = QLatin1String("zstd");
+        else if (mLayerDataFormat == Map::Base64Lz4)
+            compression = QLatin1String("lz4");
 
     } else if (mLayerDataFormat == Map::CSV)
         encoding = QLatin1String("csv");
@@ -463,9 +483,13 @@ void MapWriterPrivate::writeTileLayer(QXmlStreamWriter &w,
         }
 
         if (mLayerDataFormat == Map::Base64Gzip)
-            tileData = compress(tileData, Gzip);
+            tileData = compress(tileData, Gzip, mCompressionLevel);
         else if (mLayerDataFormat == Map::Base64Zlib)
-            tileData = compress(tileData, Zlib);
+            tileData = compress(tileData, Zlib, mCompressionLevel);
+        else if (mLayerDataFormat == Map::Base64Zstd)
+            tileData = compress(tileData, Zstandard, mCompressionLevel);
+        else if (mLayerDataFormat == Map::Base64Lz4)
+            tileData = compress(tileData, Lz4, mCompressionLevel);
 
         w.writeCharacters(QLatin1String("\n   "));
         w.writeCharacters(QString::fromLatin1(tileData.toBase64()));
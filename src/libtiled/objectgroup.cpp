@@ -35,14 +35,180 @@
 #include "tile.h"
 #include "tileset.h"
 
+#include <QSet>
+#include <QtCore/qmath.h>
+
 #include <cmath>
 #include <map.h>
 
 using namespace Tiled;
 
+namespace {
+
+// Object groups with fewer objects are queried without a spatial index
+const int MinIndexedObjects = 64;
+
+inline bool touches(const QRectF &a, const QRectF &b)
+{
+    return a.left() <= b.right() && b.left() <= a.right() &&
+            a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+/**
+ * Sorts objects by their index in the object group.
+ */
+class IndexLessThan
+{
+public:
+    explicit IndexLessThan(const QHash<const MapObject*, int> &indices)
+        : mIndices(indices)
+    {}
+
+    bool operator()(const MapObject *a, const MapObject *b) const
+    { return mIndices.value(a) < mIndices.value(b); }
+
+private:
+    const QHash<const MapObject*, int> &mIndices;
+};
+
+} // anonymous namespace
+
+namespace Tiled {
+
+/**
+ * A uniform grid over the bounds of the objects in an object group, including
+ * their polygons, used to quickly find the objects near a given area. Objects
+ * that would cover too many grid cells are kept in a separate list and are
+ * always returned as candidates.
+ */
+class ObjectGrid
+{
+public:
+    explicit ObjectGrid(const QList<MapObject*> &objects);
+
+    void insert(MapObject *object);
+    void remove(MapObject *object);
+    void update(MapObject *object);
+
+    void candidates(const QRectF &rect, QSet<MapObject*> &result) const;
+
+private:
+    static const int CellSize = 256;
+    static const int MaxCellsPerObject = 64;
+
+    static QRect cellRange(const QRectF &rect);
+    static quint64 key(int x, int y)
+    { return (quint64(quint32(x)) << 32) | quint32(y); }
+
+    QHash<quint64, QList<MapObject*> > mCells;
+    QHash<MapObject*, QRect> mObjectCells;
+    QSet<MapObject*> mLargeObjects;
+};
+
+} // namespace Tiled
+
+ObjectGrid::ObjectGrid(const QList<MapObject*> &objects)
+{
+    foreach (MapObject *object, objects)
+        insert(object);
+}
+
+void ObjectGrid::insert(MapObject *object)
+{
+    const QRect cells = cellRange(object->boundsWithPolygon());
+
+    if (qint64(cells.width()) * cells.height() > MaxCellsPerObject) {
+        mLargeObjects.insert(object);
+        return;
+    }
+
+    for (int y = cells.top(); y <= cells.bottom(); ++y)
+        for (int x = cells.left(); x <= cells.right(); ++x)
+            mCells[key(x, y)].append(object);
+
+    mObjectCells.insert(object, cells);
+}
+
+void ObjectGrid::remove(MapObject *object)
+{
+    if (mLargeObjects.remove(object))
+        return;
+
+    const QRect cells = mObjectCells.take(object);
+
+    for (int y = cells.top(); y <= cells.bottom(); ++y) {
+        for (int x = cells.left(); x <= cells.right(); ++x) {
+            QHash<quint64, QList<MapObject*> >::iterator it = mCells.find(key(x, y));
+            if (it == mCells.end())
+                continue;
+
+            it.value().removeOne(object);
+            if (it.value().isEmpty())
+                mCells.erase(it);
+        }
+    }
+}
+
+void ObjectGrid::update(MapObject *object)
+{
+    if (!mLargeObjects.contains(object)) {
+        const QHash<MapObject*, QRect>::const_iterator it = mObjectCells.find(object);
+        if (it != mObjectCells.constEnd() && it.value() == cellRange(object->boundsWithPolygon()))
+            return;
+    }
+
+    remove(object);
+    insert(object);
+}
+
+/**
+ * Adds to \a result all objects that may touch the given \a rect.
+ */
+void ObjectGrid::candidates(const QRectF &rect, QSet<MapObject*> &result) const
+{
+    result.unite(mLargeObjects);
+
+    const QRect cells = cellRange(rect);
+
+    // When the area is larger than the occupied part of the grid, it is
+    // faster to look at each of the occupied cells instead
+    if (qint64(cells.width()) * cells.height() > mCells.size()) {
+        QHash<quint64, QList<MapObject*> >::const_iterator it = mCells.constBegin();
+        for (; it != mCells.constEnd(); ++it) {
+            const int x = int(quint32(it.key() >> 32));
+            const int y = int(quint32(it.key()));
+            if (cells.contains(x, y))
+                foreach (MapObject *object, it.value())
+                    result.insert(object);
+        }
+        return;
+    }
+
+    for (int y = cells.top(); y <= cells.bottom(); ++y) {
+        for (int x = cells.left(); x <= cells.right(); ++x) {
+            QHash<quint64, QList<MapObject*> >::const_iterator it = mCells.find(key(x, y));
+            if (it != mCells.constEnd())
+                foreach (MapObject *object, it.value())
+                    result.insert(object);
+        }
+    }
+}
+
+QRect ObjectGrid::cellRange(const QRectF &rect)
+{
+    const QRectF r = rect.normalized();
+    return QRect(QPoint(qFloor(r.left() / CellSize),
+                        qFloor(r.top() / CellSize)),
+                 QPoint(qFloor(r.right() / CellSize),
+                        qFloor(r.bottom() / CellSize)));
+}
+
+
 ObjectGroup::ObjectGroup()
     : Layer(ObjectGroupType, QString(), 0, 0, 0, 0)
     , mDrawOrder(TopDownOrder)
+    , mGrid(0)
+    , mBoundingRectDirty(false)
 {
 }
 
@@ -50,12 +216,15 @@ ObjectGroup::ObjectGroup(const QString &name,
                          int x, int y, int width, int height)
     : Layer(ObjectGroupType, name, x, y, width, height)
     , mDrawOrder(TopDownOrder)
+    , mGrid(0)
+    , mBoundingRectDirty(false)
 {
 }
 
 ObjectGroup::~ObjectGroup()
 {
     qDeleteAll(mObjects);
+    delete mGrid;
 }
 
 void ObjectGroup::addObject(MapObject *object)
@@ -64,6 +233,13 @@ void ObjectGroup::addObject(MapObject *object)
     object->setObjectGroup(this);
     if (mMap && object->id() == 0)
         object->setId(mMap->takeNextObjectId());
+
+    if (!mObjectIndices.isEmpty())
+        mObjectIndices.insert(object, mObjects.size() - 1);
+    if (mGrid)
+        mGrid->insert(object);
+    if (!mBoundingRectDirty)
+        mBoundingRect = mBoundingRect.united(object->bounds());
 }
 
 void ObjectGroup::insertObject(int index, MapObject *object)
@@ -72,6 +248,12 @@ void ObjectGroup::insertObject(int index, MapObject *object)
     object->setObjectGroup(this);
     if (mMap && object->id() == 0)
         object->setId(mMap->takeNextObjectId());
+
+    updateObjectIndices(index, mObjects.size() - 1);
+    if (mGrid)
+        mGrid->insert(object);
+    if (!mBoundingRectDirty)
+        mBoundingRect = mBoundingRect.united(object->bounds());
 }
 
 int ObjectGroup::removeObject(MapObject *object)
@@ -79,8 +261,7 @@ int ObjectGroup::removeObject(MapObject *object)
     const int index = mObjects.indexOf(object);
     Q_ASSERT(index != -1);
 
-    mObjects.removeAt(index);
-    object->setObjectGroup(0);
+    removeObjectAt(index);
     return index;
 }
 
@@ -88,6 +269,79 @@ void ObjectGroup::removeObjectAt(int index)
 {
     MapObject *object = mObjects.takeAt(index);
     object->setObjectGroup(0);
+
+    mObjectIndices.remove(object);
+    updateObjectIndices(index, mObjects.size() - 1);
+    if (mGrid)
+        mGrid->remove(object);
+    mBoundingRectDirty = true;
+}
+
+void ObjectGroup::insertObjects(const QList<QPair<int, MapObject*> > &objects)
+{
+    if (objects.isEmpty())
+        return;
+
+    QList<MapObject*> merged;
+    merged.reserve(mObjects.size() + objects.size());
+
+    int remaining = 0;
+    for (int i = 0; i < objects.size(); ++i) {
+        const int index = objects.at(i).first;
+        MapObject *object = objects.at(i).second;
+
+        while (merged.size() < index && remaining < mObjects.size())
+            merged.append(mObjects.at(remaining++));
+        merged.append(object);
+
+        object->setObjectGroup(this);
+        if (mMap && object->id() == 0)
+            object->setId(mMap->takeNextObjectId());
+
+        if (mGrid)
+            mGrid->insert(object);
+        if (!mBoundingRectDirty)
+            mBoundingRect = mBoundingRect.united(object->bounds());
+    }
+
+    while (remaining < mObjects.size())
+        merged.append(mObjects.at(remaining++));
+
+    mObjects = merged;
+    updateObjectIndices(objects.first().first, mObjects.size() - 1);
+}
+
+void ObjectGroup::removeObjects(const QList<MapObject*> &objects)
+{
+    if (objects.isEmpty())
+        return;
+
+    const QSet<MapObject*> removed = objects.toSet();
+
+    QList<MapObject*> remaining;
+    remaining.reserve(mObjects.size() - removed.size());
+    int firstRemoved = -1;
+
+    for (int i = 0; i < mObjects.size(); ++i) {
+        MapObject *object = mObjects.at(i);
+        if (!removed.contains(object)) {
+            remaining.append(object);
+            continue;
+        }
+
+        if (firstRemoved == -1)
+            firstRemoved = i;
+
+        object->setObjectGroup(0);
+        mObjectIndices.remove(object);
+        if (mGrid)
+            mGrid->remove(object);
+    }
+
+    mObjects = remaining;
+    if (firstRemoved != -1)
+        updateObjectIndices(firstRemoved, mObjects.size() - 1);
+    mBoundingRectDirty = true;
 }
 
 void ObjectGroup::moveObjects(int from, int to, int count)
@@ -110,14 +364,55 @@ void ObjectGroup::moveObjects(int from, int to, int count)
 
     for (int i = 0; i < count; ++i)
         mObjects.insert(to + i, movingObjects.at(i));
+
+    updateObjectIndices(qMin(from, to), qMax(from, to) + count - 1);
 }
 
 QRectF ObjectGroup::objectsBoundingRect() const
 {
-    QRectF boundingRect;
-    foreach (const MapObject *object, mObjects)
-        boundingRect = boundingRect.united(object->bounds());
-    return boundingRect;
+    if (mBoundingRectDirty) {
+        mBoundingRect = QRectF();
+        foreach (const MapObject *object, mObjects)
+            mBoundingRect = mBoundingRect.united(object->bounds());
+        mBoundingRectDirty = false;
+    }
+    return mBoundingRect;
+}
+
+QList<MapObject*> ObjectGroup::objectsIntersecting(const QRectF &rect) const
+{
+    const QRectF area = rect.normalized();
+    QList<MapObject*> result;
+
+    if (!mGrid && mObjects.size() < MinIndexedObjects) {
+        foreach (MapObject *object, mObjects)
+            if (touches(object->boundsWithPolygon(), area))
+                result.append(object);
+        return result;
+    }
+
+    if (!mGrid)
+        mGrid = new ObjectGrid(mObjects);
+
+    QSet<MapObject*> candidates;
+    mGrid->candidates(area, candidates);
+
+    foreach (MapObject *object, candidates)
+        if (touches(object->boundsWithPolygon(), area))
+            result.append(object);
+
+    qSort(result.begin(), result.end(), IndexLessThan(objectIndices()));
+    return result;
+}
+
+QList<MapObject*> ObjectGroup::objectsAt(const QPointF &pos) const
+{
+    return objectsIntersecting(QRectF(pos, QSizeF(0, 0)));
+}
+
+int ObjectGroup::indexOfObject(const MapObject *object) const
+{
+    return objectIndices().value(object, -1);
 }
 
 bool ObjectGroup::isEmpty() const
@@ -212,6 +507,46 @@ Layer *ObjectGroup::clone() const
     return initializeClone(new ObjectGroup(mName, mX, mY, mWidth, mHeight));
 }
 
+/**
+ * Called by MapObject when its position or size changed.
+ */
+void ObjectGroup::objectBoundsChanged(MapObject *object)
+{
+    if (mGrid)
+        mGrid->update(object);
+    mBoundingRectDirty = true;
+}
+
+/**
+ * Updates the index of the objects in the range from \a first to \a last,
+ * after objects were inserted, removed or moved. Does nothing while the
+ * indexes haven't been built yet.
+ */
+void ObjectGroup::updateObjectIndices(int first, int last)
+{
+    if (mObjectIndices.isEmpty())
+        return;
+
+    last = qMin(last, mObjects.size() - 1);
+    for (int i = first; i <= last; ++i)
+        mObjectIndices.insert(mObjects.at(i), i);
+}
+
+/**
+ * Returns the index of each object in this group, used to return the results
+ * of spatial queries in a consistent order. Built on demand and updated when
+ * objects are inserted, removed or moved.
+ */
+const QHash<const MapObject*, int> &ObjectGroup::objectIndices() const
+{
+    if (mObjectIndices.isEmpty()) {
+        mObjectIndices.reserve(mObjects.size());
+        for (int i = 0; i < mObjects.size(); ++i)
+            mObjectIndices.insert(mObjects.at(i), i);
+    }
+    return mObjectIndices;
+}
+
 ObjectGroup *ObjectGroup::initializeClone(ObjectGroup *clone) const
 {
     Layer::initializeClone(clone);
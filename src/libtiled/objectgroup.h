@@ -36,12 +36,15 @@
 #include "layer.h"
 
 #include <QColor>
+#include <QHash>
 #include <QList>
 #include <QMetaType>
+#include <QPair>
 
 namespace Tiled {
 
 class MapObject;
+class ObjectGrid;
 
 /**
  * A group of objects on a map.
@@ -121,6 +124,25 @@ public:
      */
     void removeObjectAt(int index);
 
+    /**
+     * Inserts each object in \a objects at the index it is paired with. The
+     * list must be sorted by index, and each index is the one the object
+     * will have after all objects were inserted.
+     *
+     * Unlike calling insertObject() for each object, the list of objects is
+     * rebuilt only once.
+     */
+    void insertObjects(const QList<QPair<int, MapObject*> > &objects);
+
+    /**
+     * Removes the given \a objects from this object group. Ownership of the
+     * objects is transferred to the caller.
+     *
+     * Unlike calling removeObjectAt() for each object, the list of objects is
+     * rebuilt only once.
+     */
+    void removeObjects(const QList<MapObject*> &objects);
+
     /**
      * Moves \a count objects starting at \a from to the index given by \a to.
      *
@@ -134,6 +156,32 @@ public:
      */
     QRectF objectsBoundingRect() const;
 
+    /**
+     * Returns the objects whose bounds, including their polygon, intersect or
+     * touch the given \a rect, in the order in which they appear in this
+     * object group.
+     *
+     * Large object groups build a spatial index on the first query, which is
+     * kept up to date as objects are added, removed, moved or resized.
+     *
+     * \sa MapObject::boundsWithPolygon()
+     */
+    QList<MapObject*> objectsIntersecting(const QRectF &rect) const;
+
+    /**
+     * Returns the objects whose bounds, including their polygon, contain the
+     * given \a pos, in the order in which they appear in this object group.
+     */
+    QList<MapObject*> objectsAt(const QPointF &pos) const;
+
+    /**
+     * Returns the index of the given \a object in this object group, or -1
+     * when it is not part of this group. Unlike objects().indexOf(), this
+     * only takes linear time on the first call, after which the indexes are
+     * kept up to date as objects are inserted, removed or moved.
+     */
+    int indexOfObject(const MapObject *object) const;
+
     /**
      * Returns whether this object group contains any objects.
      */
@@ -182,9 +230,20 @@ protected:
     ObjectGroup *initializeClone(ObjectGroup *clone) const;
 
 private:
+    friend class MapObject;
+
+    void objectBoundsChanged(MapObject *object);
+    void updateObjectIndices(int first, int last);
+    const QHash<const MapObject*, int> &objectIndices() const;
+
     QList<MapObject*> mObjects;
     QColor mColor;
     DrawOrder mDrawOrder;
+
+    mutable ObjectGrid *mGrid;
+    mutable QHash<const MapObject*, int> mObjectIndices;
+    mutable QRectF mBoundingRect;
+    mutable bool mBoundingRectDirty;
 };
 
 
@@ -64,7 +64,7 @@ QRectF OrthogonalRenderer::boundingRect(const MapObject *object) const
     if (!object->cell().isEmpty()) {
         const QPointF bottomLeft = bounds.topLeft();
         const Tile *tile = object->cell().tile;
-        const QSize imgSize = tile->image().size();
+        const QSize imgSize = tile->size();
         const QPoint tileOffset = tile->tileset()->tileOffset();
         boundingRect = QRectF(bottomLeft.x() + tileOffset.x(),
                               bottomLeft.y() + tileOffset.y() - imgSize.height(),
@@ -234,7 +234,15 @@ void OrthogonalRenderer::drawTileLayer(QPainter *painter,
     if (startX > endX || startY > endY)
         return;
 
-    CellRenderer renderer(painter);
+    if (useLevelOfDetail(painter, QSize(tileWidth, tileHeight))) {
+        drawTileLayerOverview(painter, layer,
+                              QRect(QPoint(startX, startY),
+                                    QPoint(endX, endY)));
+        painter->setTransform(savedTransform);
+        return;
+    }
+
+    CellRenderer renderer(painter, levelOfDetailThreshold());
 
     Map::RenderOrder renderOrder = map()->renderOrder();
 
@@ -279,6 +287,46 @@ void OrthogonalRenderer::drawTileLayer(QPainter *painter,
     painter->setTransform(savedTransform);
 }
 
+/**
+ * Draws the cells in the given \a area of the tile \a layer as a single
+ * image, with one pixel showing the average color of the tile of each cell.
+ * When the tiles are smaller than a device pixel, only one cell is sampled
+ * for each pixel.
+ */
+void OrthogonalRenderer::drawTileLayerOverview(QPainter *painter,
+                                               const TileLayer *layer,
+                                               const QRect &area) const
+{
+    const int tileWidth = map()->tileWidth();
+    const int tileHeight = map()->tileHeight();
+    const qreal tileSize = qMin(tileWidth, tileHeight) * deviceScale(painter);
+    const int step = tileSize > 0 ? qMax(1, qFloor(1 / tileSize)) : 1;
+    const int columns = (area.width() + step - 1) / step;
+    const int rows = (area.height() + step - 1) / step;
+
+    QImage image(columns, rows, QImage::Format_ARGB32);
+    image.fill(0);
+
+    for (int row = 0; row < rows; ++row) {
+        QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(row));
+        const int y = area.top() + row * step;
+
+        for (int column = 0; column < columns; ++column) {
+            const Cell &cell = layer->cellAt(area.left() + column * step, y);
+            if (!cell.isEmpty())
+                line[column] = cell.tile->currentFrameTile()->averageColor();
+        }
+    }
+
+    const QRectF target(area.left() * tileWidth, area.top() * tileHeight,
+                        area.width() * tileWidth, area.height() * tileHeight);
+
+    painter->save();
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
+    painter->drawImage(target, image);
+    painter->restore();
+}
+
 void OrthogonalRenderer::drawTileSelection(QPainter *painter,
                                            const QRegion &region,
                                            const QColor &color,
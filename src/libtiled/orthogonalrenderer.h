@@ -81,6 +81,10 @@ public:
 
     using MapRenderer::pixelToScreenCoords;
     QPointF pixelToScreenCoords(qreal x, qreal y) const;
+
+private:
+    void drawTileLayerOverview(QPainter *painter, const TileLayer *layer,
+                               const QRect &area) const;
 };
 
 } // namespace Tiled
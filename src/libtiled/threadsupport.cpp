@@ -0,0 +1,67 @@
+/*
+ * threadsupport.cpp
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "threadsupport.h"
+
+#include <QPixmap>
+#include <QRunnable>
+#include <QThreadPool>
+
+using namespace Tiled;
+
+namespace {
+
+class PixmapProbe : public QRunnable
+{
+public:
+    PixmapProbe() : mResult(false) {}
+
+    void run() { mResult = !QPixmap(1, 1).isNull(); }
+    bool result() const { return mResult; }
+
+private:
+    bool mResult;
+};
+
+} // anonymous namespace
+
+bool Tiled::canUsePixmapsInThreads()
+{
+    static int result = -1;
+
+    if (result == -1) {
+        QThreadPool pool;
+        PixmapProbe probe;
+        probe.setAutoDelete(false);
+        pool.start(&probe);
+        pool.waitForDone();
+        result = probe.result() ? 1 : 0;
+    }
+
+    return result == 1;
+}
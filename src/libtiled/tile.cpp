@@ -38,6 +38,8 @@ Tile::Tile(const QPixmap &image, int id, Tileset *tileset):
     mId(id),
     mTileset(tileset),
     mImage(image),
+    mAtlasPage(0),
+    mAverageColor(0),
     mTerrain(-1),
     mTerrainProbability(-1.f),
     mObjectGroup(0),
@@ -51,6 +53,8 @@ Tile::Tile(const QPixmap &image, const QString &imageSource,
     mId(id),
     mTileset(tileset),
     mImage(image),
+    mAtlasPage(0),
+    mAverageColor(0),
     mImageSource(imageSource),
     mTerrain(-1),
     mTerrainProbability(-1.f),
@@ -64,20 +68,104 @@ Tile::~Tile()
     delete mObjectGroup;
 }
 
+/**
+ * Returns the image of this tile.
+ *
+ * Tiles of a tileset image don't keep their own image by default, but refer
+ * to an area of the tileset atlas. In that case the image is copied out of
+ * the atlas the first time it is requested.
+ */
+const QPixmap &Tile::image() const
+{
+    if (!mPendingImage.isNull()) {
+        mImage = QPixmap::fromImage(mPendingImage);
+        mPendingImage = QImage();
+    } else if (mImage.isNull() && !mAtlasRect.isNull()) {
+        mImage = mTileset->atlas(mAtlasPage).copy(mAtlasRect);
+    }
+
+    return mImage;
+}
+
+/**
+ * Sets the image of this tile. The tile will no longer be drawn from the
+ * tileset atlas until the atlas is rebuilt.
+ */
+void Tile::setImage(const QPixmap &image)
+{
+    mImage = image;
+    mPendingImage = QImage();
+    mAtlasRect = QRect();
+    mTileset->markAtlasDirty();
+}
+
+/**
+ * Sets the image of this tile. The image is only converted to a pixmap when
+ * it is needed, which allows tiles to be loaded outside of the GUI thread.
+ */
+void Tile::setImage(const QImage &image)
+{
+    mImage = QPixmap();
+    mPendingImage = image;
+    mAtlasRect = QRect();
+    mTileset->markAtlasDirty();
+}
+
+/**
+ * Returns the average color of the image of this tile, including its average
+ * opacity. Used for drawing the tile when it is very small.
+ */
+QRgb Tile::averageColor() const
+{
+    mTileset->updateAverageColors();
+    return mAverageColor;
+}
+
 /**
  * Returns the image for rendering this tile, taking into account tile
  * animations.
  */
 const QPixmap &Tile::currentFrameImage() const
+{
+    return currentFrameTile()->image();
+}
+
+/**
+ * Returns the tile that is currently displayed in place of this tile, taking
+ * into account tile animations.
+ */
+const Tile *Tile::currentFrameTile() const
 {
     if (isAnimated()) {
         const Frame &frame = mFrames.at(mCurrentFrameIndex);
-        return mTileset->tileAt(frame.tileId)->image();
+        return mTileset->tileAt(frame.tileId);
     } else {
-        return mImage;
+        return this;
     }
 }
 
+/**
+ * Returns the pixmap to draw this tile from, setting \a sourceRect to the
+ * area within that pixmap covered by the tile. This is the page of the
+ * tileset atlas holding the tile when it is part of the atlas, so that the
+ * tiles of a tileset can be drawn in a single batch. Otherwise it is the
+ * image of the tile.
+ */
+const QPixmap &Tile::atlasImage(QRect *sourceRect) const
+{
+    // Makes sure the atlas rectangles of image collection tiles are set
+    mTileset->updateAtlas();
+
+    if (!mAtlasRect.isNull()) {
+        *sourceRect = mAtlasRect;
+        return mTileset->atlas(mAtlasPage);
+    }
+
+    const QPixmap &tileImage = image();
+    *sourceRect = QRect(QPoint(0, 0), tileImage.size());
+    return tileImage;
+}
+
 Terrain *Tile::terrainAtCorner(int corner) const
 {
     return mTileset->terrain(cornerTerrainId(corner));
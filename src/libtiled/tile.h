@@ -32,6 +32,7 @@
 
 #include "object.h"
 
+#include <QImage>
 #include <QPixmap>
 
 namespace Tiled {
@@ -81,14 +82,28 @@ public:
     /**
      * Returns the image of this tile.
      */
-    const QPixmap &image() const { return mImage; }
+    const QPixmap &image() const;
 
     const QPixmap &currentFrameImage() const;
+    const Tile *currentFrameTile() const;
+
+    const QPixmap &atlasImage(QRect *sourceRect) const;
+
+    /**
+     * Returns the area this tile occupies in the texture atlas of its
+     * tileset, or a null rectangle when the tile is not part of the atlas.
+     */
+    const QRect &atlasRect() const { return mAtlasRect; }
 
     /**
-     * Sets the image of this tile.
+     * Returns the page of the tileset atlas this tile is part of.
      */
-    void setImage(const QPixmap &image) { mImage = image; }
+    int atlasPage() const { return mAtlasPage; }
+
+    void setImage(const QPixmap &image);
+    void setImage(const QImage &image);
+
+    QRgb averageColor() const;
 
     /**
      * Returns the file name of the external image that represents this tile.
@@ -103,17 +118,22 @@ public:
     /**
      * Returns the width of this tile.
      */
-    int width() const { return mImage.width(); }
+    int width() const { return size().width(); }
 
     /**
      * Returns the height of this tile.
      */
-    int height() const { return mImage.height(); }
+    int height() const { return size().height(); }
 
     /**
      * Returns the size of this tile.
      */
-    QSize size() const { return mImage.size(); }
+    QSize size() const
+    {
+        if (!mAtlasRect.isNull())
+            return mAtlasRect.size();
+        return mPendingImage.isNull() ? mImage.size() : mPendingImage.size();
+    }
 
     /**
      * Returns the Terrain of a given corner.
@@ -164,7 +184,11 @@ public:
 private:
     int mId;
     Tileset *mTileset;
-    QPixmap mImage;
+    mutable QPixmap mImage;
+    mutable QImage mPendingImage;   // Image not yet converted to a pixmap
+    QRect mAtlasRect;
+    int mAtlasPage;
+    mutable QRgb mAverageColor;
     QString mImageSource;
     unsigned mTerrain;
     float mTerrainProbability;
@@ -174,7 +198,7 @@ private:
     int mCurrentFrameIndex;
     int mUnusedTime;
 
-    friend class Tileset; // To allow changing the tile id
+    friend class Tileset; // To allow changing the tile id and atlas rect
 };
 
 /**
@@ -38,10 +38,12 @@ using namespace Tiled;
 TileLayer::TileLayer(const QString &name, int x, int y, int width, int height):
     Layer(TileLayerType, name, x, y, width, height),
     mMaxTileSize(0, 0),
-    mGrid(width * height)
+    mPalette(1, 0)
 {
     Q_ASSERT(width >= 0);
     Q_ASSERT(height >= 0);
+
+    mChunks.resize(chunkColumns() * chunkRows());
 }
 
 static QSize maxSize(const QSize &a,
@@ -60,6 +62,142 @@ static QMargins maxMargins(const QMargins &a,
                     qMax(a.bottom(), b.bottom()));
 }
 
+/**
+ * Returns the area covered by the chunk at \a chunkIndex, clipped to the
+ * bounds of this layer.
+ */
+QRect TileLayer::chunkBounds(int chunkIndex) const
+{
+    const int columns = chunkColumns();
+    const int x = (chunkIndex % columns) << ChunkBits;
+    const int y = (chunkIndex / columns) << ChunkBits;
+
+    return QRect(x, y,
+                 qMin(int(ChunkSize), mWidth - x),
+                 qMin(int(ChunkSize), mHeight - y));
+}
+
+/**
+ * Stores the packed cell at the given coordinates, allocating its chunk when
+ * needed. Does not update the draw margins.
+ */
+void TileLayer::storeCell(int x, int y, quint32 packed)
+{
+    if (mChunks.at(chunkIndex(x, y)).isEmpty()) {
+        if (packed == 0)
+            return;
+        mChunks[chunkIndex(x, y)].fill(0, ChunkSize * ChunkSize);
+    }
+
+    mChunks[chunkIndex(x, y)][indexInChunk(x, y)] = packed;
+}
+
+/**
+ * Returns the index of \a tile in the palette, adding it when necessary.
+ */
+quint32 TileLayer::paletteIndex(Tile *tile)
+{
+    if (!tile)
+        return 0;
+
+    QHash<Tile*, quint32>::const_iterator it = mPaletteIndices.find(tile);
+    if (it != mPaletteIndices.constEnd())
+        return it.value();
+
+    const quint32 index = mPalette.size();
+    Q_ASSERT(index <= PackedTileMask);
+
+    mPalette.append(tile);
+    mPaletteIndices.insert(tile, index);
+    return index;
+}
+
+quint32 TileLayer::packCellForWriting(const Cell &cell)
+{
+    const quint32 index = paletteIndex(cell.tile);
+    if (index == 0)
+        return 0;
+
+    quint32 packed = index;
+    if (cell.flippedHorizontally)
+        packed |= PackedFlippedHorizontally;
+    if (cell.flippedVertically)
+        packed |= PackedFlippedVertically;
+    if (cell.flippedAntiDiagonally)
+        packed |= PackedFlippedAntiDiagonally;
+    return packed;
+}
+
+quint32 TileLayer::packCell(const Cell &cell) const
+{
+    if (!cell.tile)
+        return 0;
+
+    QHash<Tile*, quint32>::const_iterator it = mPaletteIndices.find(cell.tile);
+    if (it == mPaletteIndices.constEnd())
+        return InvalidPackedCell;
+
+    quint32 packed = it.value();
+    if (cell.flippedHorizontally)
+        packed |= PackedFlippedHorizontally;
+    if (cell.flippedVertically)
+        packed |= PackedFlippedVertically;
+    if (cell.flippedAntiDiagonally)
+        packed |= PackedFlippedAntiDiagonally;
+    return packed;
+}
+
+/**
+ * Returns for each palette entry whether it is referenced by any cell.
+ *
+ * Only the used entries are guaranteed to point to existing tiles.
+ */
+QVector<bool> TileLayer::usedPaletteEntries() const
+{
+    QVector<bool> used(mPalette.size(), false);
+
+    for (int c = 0, c_end = mChunks.size(); c < c_end; ++c) {
+        const Chunk &chunk = mChunks.at(c);
+        for (int i = 0, i_end = chunk.size(); i < i_end; ++i)
+            used[chunk.at(i) & PackedTileMask] = true;
+    }
+
+    used[0] = false;
+    return used;
+}
+
+/**
+ * Replaces the tile of each used palette entry with the tile at the same
+ * index in \a newTiles and rebuilds the palette. Cells whose new tile is
+ * null are cleared.
+ */
+void TileLayer::remapPalette(const QVector<Tile*> &newTiles)
+{
+    Q_ASSERT(newTiles.size() == mPalette.size());
+
+    const QVector<bool> used = usedPaletteEntries();
+
+    mPalette.resize(1);
+    mPaletteIndices.clear();
+
+    QVector<quint32> remap(newTiles.size(), 0);
+    for (int i = 1, i_end = newTiles.size(); i < i_end; ++i)
+        if (used.at(i))
+            remap[i] = paletteIndex(newTiles.at(i));
+
+    for (int c = 0, c_end = mChunks.size(); c < c_end; ++c) {
+        if (mChunks.at(c).isEmpty())
+            continue;
+
+        Chunk &chunk = mChunks[c];
+        for (int i = 0, i_end = chunk.size(); i < i_end; ++i) {
+            const quint32 packed = chunk.at(i);
+            const quint32 index = remap.at(packed & PackedTileMask);
+            chunk[i] = index ? index | (packed & PackedFlipMask) : 0;
+        }
+    }
+}
+
 /**
  * Recomputes the draw margins. Needed after the tile offset of a tileset
  * has changed for example.
@@ -71,23 +209,43 @@ void TileLayer::recomputeDrawMargins()
     QSize maxTileSize(0, 0);
     QMargins offsetMargins;
 
-    for (int i = 0, i_end = mGrid.size(); i < i_end; ++i) {
-        const Cell &cell = mGrid.at(i);
-        if (const Tile *tile = cell.tile) {
-            QSize size = tile->size();
+    // Collect which palette entries are used, and whether they are used
+    // flipped anti-diagonally (bit 2) or not (bit 1)
+    QVector<quint8> usage(mPalette.size(), 0);
+
+    for (int c = 0, c_end = mChunks.size(); c < c_end; ++c) {
+        const Chunk &chunk = mChunks.at(c);
+        for (int i = 0, i_end = chunk.size(); i < i_end; ++i) {
+            const quint32 packed = chunk.at(i);
+            usage[packed & PackedTileMask] |=
+                    (packed & PackedFlippedAntiDiagonally) ? 2 : 1;
+        }
+    }
+
+    for (int i = 1, i_end = mPalette.size(); i < i_end; ++i) {
+        if (!usage.at(i))
+            continue;
 
-            if (cell.flippedAntiDiagonally)
-                size.transpose();
+        const Tile *tile = mPalette.at(i);
+        QSize size(0, 0);
 
-            const QPoint offset = tile->tileset()->tileOffset();
+        if (usage.at(i) & 1)
+            size = tile->size();
 
-            maxTileSize = maxSize(size, maxTileSize);
-            offsetMargins = maxMargins(QMargins(-offset.x(),
-                                                 -offset.y(),
-                                                 offset.x(),
-                                                 offset.y()),
-                                        offsetMargins);
+        if (usage.at(i) & 2) {
+            QSize transposed = tile->size();
+            transposed.transpose();
+            size = maxSize(size, transposed);
         }
+
+        const QPoint offset = tile->tileset()->tileOffset();
+
+        maxTileSize = maxSize(size, maxTileSize);
+        offsetMargins = maxMargins(QMargins(-offset.x(),
+                                             -offset.y(),
+                                             offset.x(),
+                                             offset.y()),
+                                    offsetMargins);
     }
 
     mMaxTileSize = maxTileSize;
@@ -120,7 +278,7 @@ void TileLayer::setCell(int x, int y, const Cell &cell)
             mMap->adjustDrawMargins(drawMargins());
     }
 
-    mGrid[x + y * mWidth] = cell;
+    storeCell(x, y, packCellForWriting(cell));
 }
 
 TileLayer *TileLayer::copy(const QRegion &region) const
@@ -188,26 +346,34 @@ void TileLayer::erase(const QRegion &area)
 
 void TileLayer::flip(FlipDirection direction)
 {
-    QVector<Cell> newGrid(mWidth * mHeight);
+    TileLayer flipped(QString(), 0, 0, mWidth, mHeight);
 
     Q_ASSERT(direction == FlipHorizontally || direction == FlipVertically);
 
-    for (int y = 0; y < mHeight; ++y) {
-        for (int x = 0; x < mWidth; ++x) {
-            Cell &dest = newGrid[x + y * mWidth];
-            if (direction == FlipHorizontally) {
-                const Cell &source = cellAt(mWidth - x - 1, y);
-                dest = source;
-                dest.flippedHorizontally = !source.flippedHorizontally;
-            } else if (direction == FlipVertically) {
-                const Cell &source = cellAt(x, mHeight - y - 1);
-                dest = source;
-                dest.flippedVertically = !source.flippedVertically;
+    for (int c = 0, c_end = mChunks.size(); c < c_end; ++c) {
+        const Chunk &chunk = mChunks.at(c);
+        if (chunk.isEmpty())
+            continue;
+
+        const QRect bounds = chunkBounds(c);
+        for (int y = bounds.top(); y <= bounds.bottom(); ++y) {
+            for (int x = bounds.left(); x <= bounds.right(); ++x) {
+                const quint32 packed = chunk.at(indexInChunk(x, y));
+                if (packed == 0)
+                    continue;
+
+                if (direction == FlipHorizontally) {
+                    flipped.storeCell(mWidth - x - 1, y,
+                                      packed ^ PackedFlippedHorizontally);
+                } else if (direction == FlipVertically) {
+                    flipped.storeCell(x, mHeight - y - 1,
+                                      packed ^ PackedFlippedVertically);
+                }
             }
         }
     }
 
-    mGrid = newGrid;
+    mChunks = flipped.mChunks;
 }
 
 void TileLayer::rotate(RotateDirection direction)
@@ -220,28 +386,31 @@ void TileLayer::rotate(RotateDirection direction)
 
     int newWidth = mHeight;
     int newHeight = mWidth;
-    QVector<Cell> newGrid(newWidth * newHeight);
-
-    for (int y = 0; y < mHeight; ++y) {
-        for (int x = 0; x < mWidth; ++x) {
-            const Cell &source = cellAt(x, y);
-            Cell dest = source;
-
-            unsigned char mask =
-                    (dest.flippedHorizontally << 2) |
-                    (dest.flippedVertically << 1) |
-                    (dest.flippedAntiDiagonally << 0);
-
-            mask = rotateMask[mask];
-
-            dest.flippedHorizontally = (mask & 4) != 0;
-            dest.flippedVertically = (mask & 2) != 0;
-            dest.flippedAntiDiagonally = (mask & 1) != 0;
-
-            if (direction == RotateRight)
-                newGrid[x * newWidth + (mHeight - y - 1)] = dest;
-            else
-                newGrid[(mWidth - x - 1) * newWidth + y] = dest;
+    TileLayer rotated(QString(), 0, 0, newWidth, newHeight);
+
+    for (int c = 0, c_end = mChunks.size(); c < c_end; ++c) {
+        const Chunk &chunk = mChunks.at(c);
+        if (chunk.isEmpty())
+            continue;
+
+        const QRect bounds = chunkBounds(c);
+        for (int y = bounds.top(); y <= bounds.bottom(); ++y) {
+            for (int x = bounds.left(); x <= bounds.right(); ++x) {
+                const quint32 packed = chunk.at(indexInChunk(x, y));
+                if (packed == 0)
+                    continue;
+
+                // The flip flags are the top three bits, in the same order
+                // as used by the rotation masks
+                const unsigned char mask = rotateMask[packed >> 29];
+                const quint32 dest = (packed & PackedTileMask) |
+                        (quint32(mask) << 29);
+
+                if (direction == RotateRight)
+                    rotated.storeCell(mHeight - y - 1, x, dest);
+                else
+                    rotated.storeCell(y, mWidth - x - 1, dest);
+            }
         }
     }
 
@@ -250,7 +419,7 @@ void TileLayer::rotate(RotateDirection direction)
 
     mWidth = newWidth;
     mHeight = newHeight;
-    mGrid = newGrid;
+    mChunks = rotated.mChunks;
 }
 
 
@@ -258,40 +427,55 @@ QSet<Tileset*> TileLayer::usedTilesets() const
 {
     QSet<Tileset*> tilesets;
 
-    for (int i = 0, i_end = mGrid.size(); i < i_end; ++i)
-        if (const Tile *tile = mGrid.at(i).tile)
-            tilesets.insert(tile->tileset());
+    const QVector<bool> used = usedPaletteEntries();
+    for (int i = 1, i_end = mPalette.size(); i < i_end; ++i)
+        if (used.at(i))
+            tilesets.insert(mPalette.at(i)->tileset());
 
     return tilesets;
 }
 
 bool TileLayer::referencesTileset(const Tileset *tileset) const
 {
-    for (int i = 0, i_end = mGrid.size(); i < i_end; ++i) {
-        const Tile *tile = mGrid.at(i).tile;
-        if (tile && tile->tileset() == tileset)
+    const QVector<bool> used = usedPaletteEntries();
+    for (int i = 1, i_end = mPalette.size(); i < i_end; ++i)
+        if (used.at(i) && mPalette.at(i)->tileset() == tileset)
             return true;
-    }
+
     return false;
 }
 
 void TileLayer::removeReferencesToTileset(Tileset *tileset)
 {
-    for (int i = 0, i_end = mGrid.size(); i < i_end; ++i) {
-        const Tile *tile = mGrid.at(i).tile;
-        if (tile && tile->tileset() == tileset)
-            mGrid.replace(i, Cell());
-    }
+    if (!referencesTileset(tileset))
+        return;
+
+    const QVector<bool> used = usedPaletteEntries();
+    QVector<Tile*> newTiles = mPalette;
+
+    for (int i = 1, i_end = newTiles.size(); i < i_end; ++i)
+        if (used.at(i) && newTiles.at(i)->tileset() == tileset)
+            newTiles[i] = 0;
+
+    remapPalette(newTiles);
 }
 
 void TileLayer::replaceReferencesToTileset(Tileset *oldTileset,
                                            Tileset *newTileset)
 {
-    for (int i = 0, i_end = mGrid.size(); i < i_end; ++i) {
-        const Tile *tile = mGrid.at(i).tile;
-        if (tile && tile->tileset() == oldTileset)
-            mGrid[i].tile = newTileset->tileAt(tile->id());
+    if (!referencesTileset(oldTileset))
+        return;
+
+    const QVector<bool> used = usedPaletteEntries();
+    QVector<Tile*> newTiles = mPalette;
+
+    for (int i = 1, i_end = newTiles.size(); i < i_end; ++i) {
+        const Tile *tile = newTiles.at(i);
+        if (used.at(i) && tile->tileset() == oldTileset)
+            newTiles[i] = newTileset->tileAt(tile->id());
     }
+
+    remapPalette(newTiles);
 }
 
 void TileLayer::resize(const QSize &size, const QPoint &offset)
@@ -299,22 +483,24 @@ void TileLayer::resize(const QSize &size, const QPoint &offset)
     if (this->size() == size && offset.isNull())
         return;
 
-    QVector<Cell> newGrid(size.width() * size.height());
+    TileLayer resized(QString(), 0, 0, size.width(), size.height());
 
     // Copy over the preserved part
-    const int startX = qMax(0, -offset.x());
-    const int startY = qMax(0, -offset.y());
-    const int endX = qMin(mWidth, size.width() - offset.x());
-    const int endY = qMin(mHeight, size.height() - offset.y());
-
-    for (int y = startY; y < endY; ++y) {
-        for (int x = startX; x < endX; ++x) {
-            const int index = x + offset.x() + (y + offset.y()) * size.width();
-            newGrid[index] = cellAt(x, y);
-        }
+    const QRect preserved = QRect(-offset, size) & QRect(0, 0, mWidth, mHeight);
+
+    for (int c = 0, c_end = mChunks.size(); c < c_end; ++c) {
+        const Chunk &chunk = mChunks.at(c);
+        if (chunk.isEmpty())
+            continue;
+
+        const QRect bounds = chunkBounds(c) & preserved;
+        for (int y = bounds.top(); y <= bounds.bottom(); ++y)
+            for (int x = bounds.left(); x <= bounds.right(); ++x)
+                resized.storeCell(x + offset.x(), y + offset.y(),
+                                  chunk.at(indexInChunk(x, y)));
     }
 
-    mGrid = newGrid;
+    mChunks = resized.mChunks;
     setSize(size);
 }
 
@@ -322,13 +508,13 @@ void TileLayer::offset(const QPoint &offset,
                        const QRect &bounds,
                        bool wrapX, bool wrapY)
 {
-    QVector<Cell> newGrid(mWidth * mHeight);
+    TileLayer newLayer(QString(), 0, 0, mWidth, mHeight);
 
     for (int y = 0; y < mHeight; ++y) {
         for (int x = 0; x < mWidth; ++x) {
             // Skip out of bounds tiles
             if (!bounds.contains(x, y)) {
-                newGrid[x + y * mWidth] = cellAt(x, y);
+                newLayer.storeCell(x, y, packedCellAt(x, y));
                 continue;
             }
 
@@ -354,13 +540,11 @@ void TileLayer::offset(const QPoint &offset,
 
             // Set the new tile
             if (contains(oldX, oldY) && bounds.contains(oldX, oldY))
-                newGrid[x + y * mWidth] = cellAt(oldX, oldY);
-            else
-                newGrid[x + y * mWidth] = Cell();
+                newLayer.storeCell(x, y, packedCellAt(oldX, oldY));
         }
     }
 
-    mGrid = newGrid;
+    mChunks = newLayer.mChunks;
 }
 
 bool TileLayer::canMergeWith(Layer *other) const
@@ -391,16 +575,52 @@ QRegion TileLayer::computeDiffRegion(const TileLayer *other) const
     QRect r = QRect(0, 0, width(), height());
     r &= QRect(dx, dy, other->width(), other->height());
 
-    for (int y = r.top(); y <= r.bottom(); ++y) {
-        for (int x = r.left(); x <= r.right(); ++x) {
-            if (cellAt(x, y) != other->cellAt(x - dx, y - dy)) {
-                const int rangeStart = x;
-                while (x <= r.right() &&
-                       cellAt(x, y) != other->cellAt(x - dx, y - dy)) {
-                    ++x;
+    // Translate the palette of the other layer to the palette of this layer,
+    // so that cells can be compared by their packed values. Tiles not
+    // referenced by this layer map to an index that is never used.
+    QVector<quint32> translation(other->mPalette.size(), PackedTileMask);
+    translation[0] = 0;
+    for (int i = 1, i_end = other->mPalette.size(); i < i_end; ++i) {
+        QHash<Tile*, quint32>::const_iterator it =
+                mPaletteIndices.find(other->mPalette.at(i));
+        if (it != mPaletteIndices.constEnd())
+            translation[i] = it.value();
+    }
+
+    // When both layers share the same chunk grid, chunks that still share
+    // their data (for example between a layer and its clone) are known to be
+    // equal and can be skipped. Palette entries are never changed without
+    // rewriting, and thus detaching, all chunks.
+    QVector<QRect> areas;
+    if (dx == 0 && dy == 0 && size() == other->size()) {
+        for (int c = 0, c_end = mChunks.size(); c < c_end; ++c)
+            if (mChunks.at(c).constData() != other->mChunks.at(c).constData())
+                areas.append(chunkBounds(c));
+    } else {
+        areas.append(r);
+    }
+
+    foreach (const QRect &area, areas) {
+        for (int y = area.top(); y <= area.bottom(); ++y) {
+            int rangeStart = -1;
+
+            for (int x = area.left(); x <= area.right() + 1; ++x) {
+                bool different = false;
+
+                if (x <= area.right()) {
+                    const quint32 theirs = other->packedCellAt(x - dx, y - dy);
+                    const quint32 translated =
+                            translation.at(theirs & PackedTileMask) |
+                            (theirs & PackedFlipMask);
+                    different = packedCellAt(x, y) != translated;
+                }
+
+                if (different && rangeStart == -1) {
+                    rangeStart = x;
+                } else if (!different && rangeStart != -1) {
+                    ret += QRect(rangeStart, y, x - rangeStart, 1);
+                    rangeStart = -1;
                 }
-                const int rangeEnd = x;
-                ret += QRect(rangeStart, y, rangeEnd - rangeStart, 1);
             }
         }
     }
@@ -410,9 +630,12 @@ QRegion TileLayer::computeDiffRegion(const TileLayer *other) const
 
 bool TileLayer::isEmpty() const
 {
-    for (int i = 0, i_end = mGrid.size(); i < i_end; ++i)
-        if (!mGrid.at(i).isEmpty())
-            return false;
+    for (int c = 0, c_end = mChunks.size(); c < c_end; ++c) {
+        const Chunk &chunk = mChunks.at(c);
+        for (int i = 0, i_end = chunk.size(); i < i_end; ++i)
+            if (chunk.at(i) != 0)
+                return false;
+    }
 
     return true;
 }
@@ -430,7 +653,9 @@ Layer *TileLayer::clone() const
 TileLayer *TileLayer::initializeClone(TileLayer *clone) const
 {
     Layer::initializeClone(clone);
-    clone->mGrid = mGrid;
+    clone->mChunks = mChunks;
+    clone->mPalette = mPalette;
+    clone->mPaletteIndices = mPaletteIndices;
     clone->mMaxTileSize = mMaxTileSize;
     clone->mOffsetMargins = mOffsetMargins;
     return clone;
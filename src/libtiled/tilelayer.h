@@ -35,6 +35,7 @@
 #include "layer.h"
 #include "tiled.h"
 
+#include <QHash>
 #include <QMargins>
 #include <QString>
 #include <QVector>
@@ -88,10 +89,27 @@ public:
     bool flippedAntiDiagonally;
 };
 
+inline uint qHash(const Cell &cell)
+{
+    return ::qHash(cell.tile)
+            ^ (uint(cell.flippedHorizontally) << 29)
+            ^ (uint(cell.flippedVertically) << 30)
+            ^ (uint(cell.flippedAntiDiagonally) << 31);
+}
+
 /**
  * A tile layer is a grid of cells. Each cell refers to a specific tile, and
  * stores how the tile is flipped.
  *
+ * The cells are stored in square chunks, which are only allocated once a
+ * non-empty cell is set within their area. This keeps the memory usage of
+ * large, mostly empty layers proportional to their content.
+ *
+ * Within a chunk, each cell is packed into a 32-bit value holding an index
+ * into the tile palette of the layer and the flip flags. Packed values can
+ * be compared directly, which is used for quickly finding differences and
+ * matching cells.
+ *
  * Coordinates and regions passed to function parameters are in local
  * coordinates and do not take into account the position of the layer.
  */
@@ -146,14 +164,34 @@ public:
     QRegion region() const;
 
     /**
-     * Returns a read-only reference to the cell at the given coordinates. The
-     * coordinates have to be within this layer.
+     * Returns the cell at the given coordinates. The coordinates have to be
+     * within this layer.
      */
-    const Cell &cellAt(int x, int y) const;
+    Cell cellAt(int x, int y) const;
 
-    const Cell &cellAt(const QPoint &point) const
+    Cell cellAt(const QPoint &point) const
     { return cellAt(point.x(), point.y()); }
 
+    /**
+     * Returns the packed value of the cell at the given coordinates. The
+     * coordinates have to be within this layer.
+     *
+     * Two cells of the same layer are equal when their packed values are
+     * equal. Empty cells always have a packed value of 0.
+     */
+    quint32 packedCellAt(int x, int y) const;
+
+    /**
+     * Returns the packed value \a cell would have in this layer, or
+     * InvalidPackedCell when its tile is not referenced by this layer.
+     */
+    quint32 packCell(const Cell &cell) const;
+
+    /**
+     * A packed value that never matches any cell of a layer.
+     */
+    static const quint32 InvalidPackedCell = 0xE0000000;
+
     /**
      * Sets the cell at the given coordinates.
      */
@@ -269,9 +307,47 @@ protected:
     TileLayer *initializeClone(TileLayer *clone) const;
 
 private:
+    enum {
+        ChunkBits = 4,
+        ChunkSize = 1 << ChunkBits,
+        ChunkMask = ChunkSize - 1
+    };
+
+    static const quint32 PackedFlippedHorizontally = 0x80000000;
+    static const quint32 PackedFlippedVertically = 0x40000000;
+    static const quint32 PackedFlippedAntiDiagonally = 0x20000000;
+    static const quint32 PackedFlipMask = 0xE0000000;
+    static const quint32 PackedTileMask = 0x1FFFFFFF;
+
+    typedef QVector<quint32> Chunk;
+
+    int chunkColumns() const { return (mWidth + ChunkMask) >> ChunkBits; }
+    int chunkRows() const { return (mHeight + ChunkMask) >> ChunkBits; }
+
+    int chunkIndex(int x, int y) const
+    { return (x >> ChunkBits) + (y >> ChunkBits) * chunkColumns(); }
+
+    static int indexInChunk(int x, int y)
+    { return (x & ChunkMask) + ((y & ChunkMask) << ChunkBits); }
+
+    QRect chunkBounds(int chunkIndex) const;
+
+    void storeCell(int x, int y, quint32 packed);
+
+    quint32 paletteIndex(Tile *tile);
+    quint32 packCellForWriting(const Cell &cell);
+    Cell unpackCell(quint32 packed) const;
+
+    QVector<bool> usedPaletteEntries() const;
+    void remapPalette(const QVector<Tile*> &newTiles);
+
     QSize mMaxTileSize;
     QMargins mOffsetMargins;
-    QVector<Cell> mGrid;
+    QVector<Chunk> mChunks;
+
+    // The tiles referenced by the packed cells. Index 0 is the empty cell.
+    QVector<Tile*> mPalette;
+    QHash<Tile*, quint32> mPaletteIndices;
 };
 
 
@@ -280,18 +356,28 @@ QRegion TileLayer::region(Condition condition) const
 {
     QRegion region;
 
+    // When empty cells don't match, unallocated chunks can be skipped
+    const bool emptyMatches = condition(Cell());
+    const int columns = chunkColumns();
+
     for (int y = 0; y < mHeight; ++y) {
-        for (int x = 0; x < mWidth; ++x) {
+        const int rowOffset = (y >> ChunkBits) * columns;
+        int x = 0;
+
+        while (x < mWidth) {
+            if (!emptyMatches &&
+                    mChunks.at(rowOffset + (x >> ChunkBits)).isEmpty()) {
+                x = (x | ChunkMask) + 1;
+                continue;
+            }
+
             if (condition(cellAt(x, y))) {
                 const int rangeStart = x;
-                for (++x; x <= mWidth; ++x) {
-                    if (x == mWidth || !condition(cellAt(x, y))) {
-                        const int rangeEnd = x;
-                        region += QRect(rangeStart + mX, y + mY,
-                                        rangeEnd - rangeStart, 1);
-                        break;
-                    }
-                }
+                for (++x; x < mWidth && condition(cellAt(x, y)); ++x)
+                    ;
+                region += QRect(rangeStart + mX, y + mY, x - rangeStart, 1);
+            } else {
+                ++x;
             }
         }
     }
@@ -302,9 +388,22 @@ QRegion TileLayer::region(Condition condition) const
 template<typename Condition>
 bool TileLayer::hasCell(Condition condition) const
 {
-    for (int i = 0, i_end = mGrid.size(); i < i_end; ++i)
-        if (condition(mGrid.at(i)))
-            return true;
+    const bool emptyMatches = condition(Cell());
+
+    for (int i = 0, i_end = mChunks.size(); i < i_end; ++i) {
+        const Chunk &chunk = mChunks.at(i);
+        if (chunk.isEmpty()) {
+            if (emptyMatches)
+                return true;
+            continue;
+        }
+
+        const QRect bounds = chunkBounds(i);
+        for (int y = bounds.top(); y <= bounds.bottom(); ++y)
+            for (int x = bounds.left(); x <= bounds.right(); ++x)
+                if (condition(unpackCell(chunk.at(indexInChunk(x, y)))))
+                    return true;
+    }
 
     return false;
 }
@@ -317,10 +416,27 @@ inline QRegion TileLayer::region() const
     return region(cellInUse);
 }
 
-inline const Cell &TileLayer::cellAt(int x, int y) const
+inline quint32 TileLayer::packedCellAt(int x, int y) const
 {
     Q_ASSERT(contains(x, y));
-    return mGrid.at(x + y * mWidth);
+    const Chunk &chunk = mChunks.at(chunkIndex(x, y));
+    if (chunk.isEmpty())
+        return 0;
+    return chunk.at(indexInChunk(x, y));
+}
+
+inline Cell TileLayer::cellAt(int x, int y) const
+{
+    return unpackCell(packedCellAt(x, y));
+}
+
+inline Cell TileLayer::unpackCell(quint32 packed) const
+{
+    Cell cell(mPalette.at(packed & PackedTileMask));
+    cell.flippedHorizontally = (packed & PackedFlippedHorizontally) != 0;
+    cell.flippedVertically = (packed & PackedFlippedVertically) != 0;
+    cell.flippedAntiDiagonally = (packed & PackedFlippedAntiDiagonally) != 0;
+    return cell;
 }
 
 } // namespace Tiled
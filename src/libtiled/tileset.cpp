@@ -28,13 +28,120 @@
  */
 
 #include "tileset.h"
+#include "imagecache.h"
 #include "tile.h"
 #include "terrain.h"
 
-#include <QBitmap>
+#include <QPainter>
+#include <QtAlgorithms>
+
+#include <cmath>
 
 using namespace Tiled;
 
+namespace {
+
+/**
+ * The maximum width and height of a page of a tileset atlas. Larger pages are
+ * not created, since they would not fit in a single texture on most hardware.
+ */
+const int MaxAtlasSize = 4096;
+
+/**
+ * Draws the \a source area of \a image at \a target, repeating its border
+ * pixels one pixel outwards. This prevents neighbouring tiles in the atlas
+ * from bleeding in when a tile is drawn with smooth scaling.
+ */
+void drawExtruded(QPainter &painter, const QImage &image,
+                  const QRect &source, const QPoint &target)
+{
+    const int x = target.x();
+    const int y = target.y();
+    const int w = source.width();
+    const int h = source.height();
+
+    painter.drawImage(target, image, source);
+
+    // Edges
+    painter.drawImage(QPoint(x, y - 1), image,
+                      QRect(source.left(), source.top(), w, 1));
+    painter.drawImage(QPoint(x, y + h), image,
+                      QRect(source.left(), source.bottom(), w, 1));
+    painter.drawImage(QPoint(x - 1, y), image,
+                      QRect(source.left(), source.top(), 1, h));
+    painter.drawImage(QPoint(x + w, y), image,
+                      QRect(source.right(), source.top(), 1, h));
+
+    // Corners
+    painter.drawImage(QPoint(x - 1, y - 1), image,
+                      QRect(source.topLeft(), QSize(1, 1)));
+    painter.drawImage(QPoint(x + w, y - 1), image,
+                      QRect(source.topRight(), QSize(1, 1)));
+    painter.drawImage(QPoint(x - 1, y + h), image,
+                      QRect(source.bottomLeft(), QSize(1, 1)));
+    painter.drawImage(QPoint(x + w, y + h), image,
+                      QRect(source.bottomRight(), QSize(1, 1)));
+}
+
+/**
+ * Returns the average color of the \a rect area of \a image, which needs to
+ * be in ARGB32 format. The color channels are weighted by the alpha value of
+ * each pixel, so that fully transparent pixels don't affect the color.
+ */
+QRgb averageColor(const QImage &image, const QRect &rect)
+{
+    quint64 alpha = 0;
+    quint64 red = 0;
+    quint64 green = 0;
+    quint64 blue = 0;
+
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for (int x = rect.left(); x <= rect.right(); ++x) {
+            const QRgb pixel = line[x];
+            const uint a = qAlpha(pixel);
+            alpha += a;
+            red += qRed(pixel) * a;
+            green += qGreen(pixel) * a;
+            blue += qBlue(pixel) * a;
+        }
+    }
+
+    if (alpha == 0)
+        return 0;
+
+    const quint64 pixels = quint64(rect.width()) * rect.height();
+    return qRgba(red / alpha, green / alpha, blue / alpha, alpha / pixels);
+}
+
+/**
+ * Returns the key under which tiles with the given \a terrain are found in
+ * the terrain index, when only the corners in \a mask are considered. The
+ * mask is reduced to one bit per corner, which is stored in the upper half of
+ * the key.
+ */
+quint64 terrainIndexKey(unsigned terrain, unsigned mask)
+{
+    unsigned corners = 0;
+    unsigned cornersMask = 0;
+    for (int corner = 0; corner < 4; ++corner) {
+        const unsigned cornerMask = 0xFFu << corner * 8;
+        if (mask & cornerMask) {
+            corners |= 1 << corner;
+            cornersMask |= cornerMask;
+        }
+    }
+
+    return quint64(corners) << 32 | (terrain & cornersMask);
+}
+
+bool tileHeightGreaterThan(const Tile *a, const Tile *b)
+{
+    return a->height() > b->height();
+}
+
+} // anonymous namespace
+
 Tileset::~Tileset()
 {
     qDeleteAll(mTiles);
@@ -55,35 +162,67 @@ bool Tileset::loadFromImage(const QImage &image, const QString &fileName)
 
     const int stopWidth = image.width() - mTileWidth;
     const int stopHeight = image.height() - mTileHeight;
+    const int columns = stopWidth < mMargin ? 0 :
+            (stopWidth - mMargin) / (mTileWidth + mTileSpacing) + 1;
+    const int rows = stopHeight < mMargin ? 0 :
+            (stopHeight - mMargin) / (mTileHeight + mTileSpacing) + 1;
 
     int oldTilesetSize = mTiles.size();
-    int tileNum = 0;
+    const int tileCount = columns * rows;
 
-    for (int y = mMargin; y <= stopHeight; y += mTileHeight + mTileSpacing) {
-        for (int x = mMargin; x <= stopWidth; x += mTileWidth + mTileSpacing) {
-            const QImage tileImage = image.copy(x, y, mTileWidth, mTileHeight);
-            QPixmap tilePixmap = QPixmap::fromImage(tileImage);
+    for (int tileNum = oldTilesetSize; tileNum < tileCount; ++tileNum) {
+        mTiles.append(new Tile(QPixmap(), tileNum, this));
+        mTerrainIndexDirty = true;
+    }
 
-            if (mTransparentColor.isValid()) {
-                const QImage mask =
-                        tileImage.createMaskFromColor(mTransparentColor.rgb());
-                tilePixmap.setMask(QBitmap::fromImage(mask));
-            }
+    // The tiles are copied into an atlas with a one pixel border around each
+    // tile, which allows the renderer to draw them in batches. Large tileset
+    // images are split over several atlas pages, each of which covers a
+    // block of rows and columns.
+    const int cellWidth = mTileWidth + 2;
+    const int cellHeight = mTileHeight + 2;
+    const int pageColumns = qMax(1, MaxAtlasSize / cellWidth);
+    const int pageRows = qMax(1, MaxAtlasSize / cellHeight);
+    const int pagesPerRow = (columns + pageColumns - 1) / pageColumns;
+
+    // Tilesets using the same image with the same layout share their atlas
+    const QString atlasKey = ImageCache::atlasKey(image, mTransparentColor,
+                                                  mTileWidth, mTileHeight,
+                                                  mTileSpacing, mMargin);
+    ImageCache *imageCache = ImageCache::instance();
+    mAtlas = imageCache->atlas(atlasKey);
+    if (!mAtlas) {
+        mAtlas = SharedAtlasPages(new AtlasPages(drawAtlasPages(image, columns, rows)));
+        imageCache->insertAtlas(atlasKey, mAtlas);
+    }
 
-            if (tileNum < oldTilesetSize) {
-                mTiles.at(tileNum)->setImage(tilePixmap);
-            } else {
-                mTiles.append(new Tile(tilePixmap, tileNum, this));
-            }
-            ++tileNum;
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < columns; ++column) {
+            const QPoint target((column % pageColumns) * cellWidth + 1,
+                                (row % pageRows) * cellHeight + 1);
+
+            // The tile image is copied out of the atlas when needed
+            Tile *tile = mTiles.at(row * columns + column);
+            tile->mImage = QPixmap();
+            tile->mPendingImage = QImage();
+            tile->mAtlasRect = QRect(target, QSize(mTileWidth, mTileHeight));
+            tile->mAtlasPage = (row / pageRows) * pagesPerRow + column / pageColumns;
         }
     }
 
+    mAtlasDirty = false;
+    mAverageColorsDirty = true;
+
+    int tileNum = tileCount;
+
     // Blank out any remaining tiles to avoid confusion
     while (tileNum < oldTilesetSize) {
         QPixmap tilePixmap = QPixmap(mTileWidth, mTileHeight);
         tilePixmap.fill();
-        mTiles.at(tileNum)->setImage(tilePixmap);
+        Tile *tile = mTiles.at(tileNum);
+        tile->mImage = tilePixmap;
+        tile->mPendingImage = QImage();
+        tile->mAtlasRect = QRect();
         ++tileNum;
     }
 
@@ -94,9 +233,69 @@ bool Tileset::loadFromImage(const QImage &image, const QString &fileName)
     return true;
 }
 
+/**
+ * Draws the atlas pages for the given tileset \a image, which is split into
+ * the given number of \a columns and \a rows of tiles. Each page covers a
+ * block of rows and columns, ordered by row and then by column.
+ */
+QVector<QImage> Tileset::drawAtlasPages(const QImage &image,
+                                        int columns, int rows) const
+{
+    QImage source = image.convertToFormat(QImage::Format_ARGB32);
+
+    if (mTransparentColor.isValid()) {
+        const QRgb transparent = mTransparentColor.rgb();
+        for (int y = 0; y < source.height(); ++y) {
+            QRgb *line = reinterpret_cast<QRgb*>(source.scanLine(y));
+            for (int x = 0; x < source.width(); ++x)
+                if (line[x] == transparent)
+                    line[x] = 0;
+        }
+    }
+
+    const int cellWidth = mTileWidth + 2;
+    const int cellHeight = mTileHeight + 2;
+    const int pageColumns = qMax(1, MaxAtlasSize / cellWidth);
+    const int pageRows = qMax(1, MaxAtlasSize / cellHeight);
+
+    QVector<QImage> pages;
+
+    for (int firstRow = 0; firstRow < rows; firstRow += pageRows) {
+        for (int firstColumn = 0; firstColumn < columns; firstColumn += pageColumns) {
+            const int pageRowCount = qMin(pageRows, rows - firstRow);
+            const int pageColumnCount = qMin(pageColumns, columns - firstColumn);
+
+            QImage atlasImage(pageColumnCount * cellWidth,
+                              pageRowCount * cellHeight,
+                              QImage::Format_ARGB32_Premultiplied);
+            atlasImage.fill(0);
+
+            QPainter painter(&atlasImage);
+            painter.setCompositionMode(QPainter::CompositionMode_Source);
+
+            for (int row = firstRow; row < firstRow + pageRowCount; ++row) {
+                for (int column = firstColumn; column < firstColumn + pageColumnCount; ++column) {
+                    const QRect tileRect(mMargin + column * (mTileWidth + mTileSpacing),
+                                         mMargin + row * (mTileHeight + mTileSpacing),
+                                         mTileWidth, mTileHeight);
+                    const QPoint target((column - firstColumn) * cellWidth + 1,
+                                        (row - firstRow) * cellHeight + 1);
+
+                    drawExtruded(painter, source, tileRect, target);
+                }
+            }
+
+            painter.end();
+            pages.append(atlasImage);
+        }
+    }
+
+    return pages;
+}
+
 bool Tileset::loadFromImage(const QString &fileName)
 {
-    return loadFromImage(QImage(fileName), fileName);
+    return loadFromImage(ImageCache::instance()->loadImage(fileName), fileName);
 }
 
 Tileset *Tileset::findSimilarTileset(const QList<Tileset*> &tilesets) const
@@ -191,6 +390,37 @@ int Tileset::terrainTransitionPenalty(int terrainType0, int terrainType1)
     return mTerrainTypes.at(terrainType0)->transitionDistance(terrainType1);
 }
 
+QList<Tile*> Tileset::tilesWithTerrain(unsigned terrain, unsigned mask) const
+{
+    if (mTerrainIndexDirty)
+        updateTerrainIndex();
+
+    return mTerrainIndex.value(terrainIndexKey(terrain, mask));
+}
+
+/**
+ * Buckets the tiles by their terrain, once for each combination of corners
+ * that can be considered when looking for a matching tile.
+ */
+void Tileset::updateTerrainIndex() const
+{
+    mTerrainIndex.clear();
+
+    foreach (Tile *tile, mTiles) {
+        const unsigned terrain = tile->terrain();
+        for (unsigned corners = 0; corners < 16; ++corners) {
+            unsigned mask = 0;
+            for (int corner = 0; corner < 4; ++corner)
+                if (corners & (1 << corner))
+                    mask |= 0xFFu << corner * 8;
+
+            mTerrainIndex[terrainIndexKey(terrain, mask)].append(tile);
+        }
+    }
+
+    mTerrainIndexDirty = false;
+}
+
 void Tileset::recalculateTerrainDistances()
 {
     // some fancy macros which can search for a value in each byte of a word simultaneously
@@ -280,6 +510,8 @@ Tile *Tileset::addTile(const QPixmap &image, const QString &source)
 {
     Tile *newTile = new Tile(image, source, tileCount(), this);
     mTiles.append(newTile);
+    mTerrainIndexDirty = true;
+    markAtlasDirty();
     if (mTileHeight < image.height())
         mTileHeight = image.height();
     if (mTileWidth < image.width())
@@ -297,6 +529,8 @@ void Tileset::insertTiles(int index, const QList<Tile *> &tiles)
     for (int i = index + count; i < mTiles.size(); ++i)
         mTiles.at(i)->mId += count;
 
+    mTerrainIndexDirty = true;
+    markAtlasDirty();
     updateTileSize();
 }
 
@@ -311,6 +545,8 @@ void Tileset::removeTiles(int index, int count)
     for (; last != mTiles.end(); ++last)
         (*last)->mId -= count;
 
+    mTerrainIndexDirty = true;
+    markAtlasDirty();
     updateTileSize();
 }
 
@@ -325,28 +561,218 @@ void Tileset::setTileImage(int id, const QPixmap &image,
     if (!tile)
         return;
 
-    const QSize previousImageSize = tile->image().size();
-    const QSize newImageSize = image.size();
+    const QSize previousImageSize = tile->size();
+
+    tile->setImage(image);
+    tile->setImageSource(source);
+
+    updateTileSize(previousImageSize, image.size());
+}
+
+void Tileset::setTileImage(int id, const QImage &image,
+                           const QString &source)
+{
+    Q_ASSERT(mImageSource.isEmpty());
+
+    Tile *tile = tileAt(id);
+    if (!tile)
+        return;
+
+    const QSize previousImageSize = tile->size();
 
     tile->setImage(image);
     tile->setImageSource(source);
 
-    if (previousImageSize != newImageSize) {
-        // Update our max. tile size
-        if (previousImageSize.height() == mTileHeight ||
-                previousImageSize.width() == mTileWidth) {
-            // This used to be the max image; we have to recompute
-            updateTileSize();
+    updateTileSize(previousImageSize, image.size());
+}
+
+/**
+ * Returns the given \a page of the texture atlas of this tileset. Tiles that
+ * are part of the atlas refer to their page by Tile::atlasPage() and to their
+ * area on it by Tile::atlasRect().
+ *
+ * For tilesets based on a tileset image, the atlas is created when loading
+ * the image. For image collection tilesets, the tile images are packed into
+ * the atlas on demand.
+ */
+const QPixmap &Tileset::atlas(int page) const
+{
+    updateAtlas();
+    return mAtlas->pixmap(page);
+}
+
+/**
+ * Packs the tile images into the atlas when they have changed. Needs to be
+ * called from the GUI thread. The atlas pages themselves are converted to
+ * pixmaps when they are first drawn.
+ */
+void Tileset::updateAtlas() const
+{
+    if (mAtlasDirty) {
+        packAtlas();
+
+        // Convert the images of the tiles that are too large for the atlas
+        foreach (Tile *tile, mTiles)
+            if (tile->mAtlasRect.isNull())
+                tile->image();
+    }
+}
+
+/**
+ * Packs the images of the tiles of this image collection tileset into the
+ * atlas, using a simple shelf packing algorithm. A new page is started when
+ * a page is full. Tiles that are too large for a page remain drawn from their
+ * own image.
+ */
+void Tileset::packAtlas() const
+{
+    mAtlasDirty = false;
+    mAtlas.clear();
+
+    QList<Tile*> tiles;
+    int area = 0;
+    int maxWidth = 0;
+
+    foreach (Tile *tile, mTiles) {
+        tile->mAtlasRect = QRect();
+        tile->mAtlasPage = 0;
+
+        const QSize imageSize = tile->size();
+        const QSize size = imageSize + QSize(2, 2);
+        if (imageSize.isEmpty() ||
+                size.width() > MaxAtlasSize || size.height() > MaxAtlasSize)
+            continue;
+
+        tiles.append(tile);
+        area += size.width() * size.height();
+        maxWidth = qMax(maxWidth, size.width());
+    }
+
+    if (tiles.isEmpty())
+        return;
+
+    qStableSort(tiles.begin(), tiles.end(), tileHeightGreaterThan);
+
+    const int atlasWidth = qBound(maxWidth,
+                                  (int) std::ceil(std::sqrt((double) area)),
+                                  MaxAtlasSize);
+
+    QVector<QImage> pages;
+
+    int first = 0;
+    while (first < tiles.size()) {
+        QVector<QPoint> positions;
+        int x = 0;
+        int y = 0;
+        int shelfHeight = 0;
+        int packed = first;
+
+        for (; packed < tiles.size(); ++packed) {
+            const QSize size = tiles.at(packed)->size() + QSize(2, 2);
+
+            if (x + size.width() > atlasWidth) {
+                y += shelfHeight;
+                x = 0;
+                shelfHeight = 0;
+            }
+            if (y + size.height() > MaxAtlasSize)
+                break;
+
+            positions.append(QPoint(x + 1, y + 1));
+            x += size.width();
+            shelfHeight = qMax(shelfHeight, size.height());
+        }
+
+        QImage atlasImage(atlasWidth, y + shelfHeight,
+                          QImage::Format_ARGB32_Premultiplied);
+        atlasImage.fill(0);
+
+        QPainter painter(&atlasImage);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+
+        for (int i = first; i < packed; ++i) {
+            Tile *tile = tiles.at(i);
+            const QImage image = tileImage(tile);
+            const QPoint &position = positions.at(i - first);
+            drawExtruded(painter, image, image.rect(), position);
+            tile->mAtlasRect = QRect(position, image.size());
+            tile->mAtlasPage = pages.size();
+        }
+
+        painter.end();
+        pages.append(atlasImage);
+        first = packed;
+    }
+
+    mAtlas = SharedAtlasPages(new AtlasPages(pages));
+}
+
+/**
+ * Returns the image of the given \a tile, without converting it to a pixmap
+ * when it was not converted yet.
+ */
+QImage Tileset::tileImage(const Tile *tile)
+{
+    if (!tile->mPendingImage.isNull())
+        return tile->mPendingImage;
+    return tile->mImage.toImage();
+}
+
+/**
+ * Computes the average colors of all tiles, when any tile images have changed
+ * since they were last computed.
+ */
+void Tileset::updateAverageColors() const
+{
+    if (!mAverageColorsDirty)
+        return;
+
+    mAverageColorsDirty = false;
+
+    if (mAtlasDirty)
+        packAtlas();
+
+    QVector<QImage> pages;
+    if (mAtlas) {
+        for (int page = 0; page < mAtlas->count(); ++page)
+            pages.append(mAtlas->image(page).convertToFormat(QImage::Format_ARGB32));
+    }
+
+    foreach (Tile *tile, mTiles) {
+        if (!tile->mAtlasRect.isNull()) {
+            tile->mAverageColor = averageColor(pages.at(tile->mAtlasPage),
+                                               tile->mAtlasRect);
         } else {
-            // Check if we have a new maximum
-            if (mTileHeight < newImageSize.height())
-                mTileHeight = newImageSize.height();
-            if (mTileWidth < newImageSize.width())
-                mTileWidth = newImageSize.width();
+            const QImage image = tileImage(tile)
+                    .convertToFormat(QImage::Format_ARGB32);
+            tile->mAverageColor = averageColor(image, image.rect());
         }
     }
 }
 
+/**
+ * Updates the tile size after the image of a tile changed size.
+ */
+void Tileset::updateTileSize(const QSize &previousImageSize,
+                             const QSize &newImageSize)
+{
+    if (previousImageSize == newImageSize)
+        return;
+
+    // Update our max. tile size
+    if (previousImageSize.height() == mTileHeight ||
+            previousImageSize.width() == mTileWidth) {
+        // This used to be the max image; we have to recompute
+        updateTileSize();
+    } else {
+        // Check if we have a new maximum
+        if (mTileHeight < newImageSize.height())
+            mTileHeight = newImageSize.height();
+        if (mTileWidth < newImageSize.width())
+            mTileWidth = newImageSize.width();
+    }
+}
+
 void Tileset::updateTileSize()
 {
     int maxWidth = 0;
@@ -30,9 +30,12 @@
 #ifndef TILESET_H
 #define TILESET_H
 
+#include "imagecache.h"
 #include "object.h"
 
 #include <QColor>
+#include <QHash>
+#include <QImage>
 #include <QList>
 #include <QVector>
 #include <QPoint>
@@ -77,7 +80,10 @@ public:
         mImageWidth(0),
         mImageHeight(0),
         mColumnCount(0),
-        mTerrainDistancesDirty(false)
+        mTerrainDistancesDirty(false),
+        mTerrainIndexDirty(true),
+        mAtlasDirty(false),
+        mAverageColorsDirty(true)
     {
         Q_ASSERT(tileSpacing >= 0);
         Q_ASSERT(margin >= 0);
@@ -324,6 +330,16 @@ public:
      */
     int terrainTransitionPenalty(int terrainType0, int terrainType1);
 
+    /**
+     * Returns the tiles of which the terrain equals \a terrain in the corners
+     * selected by \a mask, in the order in which they appear in the tileset.
+     * Each corner is either fully included in the mask or not at all.
+     *
+     * The tiles are looked up in an index, which is rebuilt on the first call
+     * after the tiles or their terrain information changed.
+     */
+    QList<Tile*> tilesWithTerrain(unsigned terrain, unsigned mask) const;
+
     /**
      * Adds a new tile to the end of the tileset.
      */
@@ -337,23 +353,53 @@ public:
      */
     void setTileImage(int id, const QPixmap &image,
                       const QString &source = QString());
+    void setTileImage(int id, const QImage &image,
+                      const QString &source = QString());
 
     /**
      * Used by the Tile class when its terrain information changes.
      */
-    void markTerrainDistancesDirty() { mTerrainDistancesDirty = true; }
+    void markTerrainDistancesDirty()
+    {
+        mTerrainDistancesDirty = true;
+        mTerrainIndexDirty = true;
+    }
+
+    const QPixmap &atlas(int page) const;
+    void updateAtlas() const;
+
+    /**
+     * Used by the Tile class when its image changes.
+     */
+    void markAtlasDirty()
+    {
+        mAverageColorsDirty = true;
+        if (mImageSource.isEmpty())
+            mAtlasDirty = true;
+    }
+
+    void updateAverageColors() const;
 
 private:
     /**
      * Sets tile size to the maximum size.
      */
     void updateTileSize();
+    void updateTileSize(const QSize &previousImageSize,
+                        const QSize &newImageSize);
 
     /**
      * Calculates the transition distance matrix for all terrain types.
      */
     void recalculateTerrainDistances();
 
+    void updateTerrainIndex() const;
+
+    void packAtlas() const;
+    QVector<QImage> drawAtlasPages(const QImage &image,
+                                   int columns, int rows) const;
+    static QImage tileImage(const Tile *tile);
+
     QString mName;
     QString mFileName;
     QString mImageSource;
@@ -369,6 +415,11 @@ private:
     QList<Tile*> mTiles;
     QList<Terrain*> mTerrainTypes;
     bool mTerrainDistancesDirty;
+    mutable QHash<quint64, QList<Tile*> > mTerrainIndex;
+    mutable bool mTerrainIndexDirty;
+    mutable SharedAtlasPages mAtlas;
+    mutable bool mAtlasDirty;
+    mutable bool mAverageColorsDirty;
 };
 
 } // namespace Tiled
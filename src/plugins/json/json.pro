@@ -3,11 +3,13 @@ include(../plugin.pri)
 DEFINES += JSON_LIBRARY
 
 SOURCES += jsonplugin.cpp \
+    jsonmapwriter.cpp \
     qjsonparser/json.cpp \
     varianttomapconverter.cpp \
     maptovariantconverter.cpp
 
 HEADERS += jsonplugin.h \
+    jsonmapwriter.h \
     json_global.h \
     qjsonparser/json.h \
     varianttomapconverter.h \
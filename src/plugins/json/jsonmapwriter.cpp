@@ -0,0 +1,333 @@
+/*
+ * JSON Tiled Plugin
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "jsonmapwriter.h"
+
+#include "map.h"
+#include "tilelayer.h"
+
+#include <QIODevice>
+#include <qnumeric.h>
+
+using namespace Tiled;
+using namespace Json;
+
+namespace {
+
+// The amount of data collected before it is written to the device
+const int BufferSize = 64 * 1024;
+
+const char hexDigits[] = "0123456789abcdef";
+
+QByteArray indentation(int depth)
+{
+    return QByteArray(depth * 4, ' ');
+}
+
+} // anonymous namespace
+
+JsonMapWriter::JsonMapWriter()
+    : mDevice(0)
+{
+}
+
+bool JsonMapWriter::write(const Map *map, QIODevice *device,
+                          const QDir &mapDir)
+{
+    mDevice = device;
+    mBuffer.clear();
+    mBuffer.reserve(BufferSize + 1024);
+    mError.clear();
+
+    const QLatin1String layersKey("layers");
+    const QVariantMap mapVariant = mConverter.toVariantWithoutLayers(map,
+                                                                     mapDir);
+
+    // Write the map attributes in the order used by QVariantMap, with the
+    // layers in between
+    writeObjectStart(0);
+
+    QVariantMap::const_iterator it = mapVariant.constBegin();
+    QVariantMap::const_iterator it_end = mapVariant.constEnd();
+    bool first = true;
+
+    for (; it != it_end && it.key() < layersKey; ++it) {
+        writeKey(it.key(), first, 0);
+        writeValue(it.value(), 1);
+        first = false;
+    }
+
+    writeKey(layersKey, first, 0);
+    mBuffer += '[';
+    for (int i = 0; i < map->layerCount() && mError.isEmpty(); ++i) {
+        if (i != 0)
+            mBuffer += ", ";
+
+        Layer *layer = map->layerAt(i);
+        if (const TileLayer *tileLayer = layer->asTileLayer())
+            writeTileLayer(tileLayer, 2);
+        else
+            writeValue(mConverter.toVariant(layer), 2);
+    }
+    mBuffer += ']';
+
+    for (; it != it_end; ++it) {
+        writeKey(it.key(), false, 0);
+        writeValue(it.value(), 1);
+    }
+
+    writeObjectEnd(0);
+    flush(true);
+
+    mDevice = 0;
+    return mError.isEmpty();
+}
+
+void JsonMapWriter::writeTileLayer(const TileLayer *tileLayer, int depth)
+{
+    const QLatin1String dataKey("data");
+    const QVariantMap layerVariant = mConverter.toVariantWithoutData(tileLayer);
+
+    writeObjectStart(depth);
+
+    QVariantMap::const_iterator it = layerVariant.constBegin();
+    QVariantMap::const_iterator it_end = layerVariant.constEnd();
+    bool first = true;
+
+    for (; it != it_end && it.key() < dataKey; ++it) {
+        writeKey(it.key(), first, depth);
+        writeValue(it.value(), depth + 1);
+        first = false;
+    }
+
+    writeKey(dataKey, first, depth);
+    writeTileData(tileLayer);
+
+    for (; it != it_end; ++it) {
+        writeKey(it.key(), false, depth);
+        writeValue(it.value(), depth + 1);
+    }
+
+    writeObjectEnd(depth);
+}
+
+void JsonMapWriter::writeTileData(const TileLayer *tileLayer)
+{
+    const GidMapper &gidMapper = mConverter.gidMapper();
+    const int width = tileLayer->width();
+    const int height = tileLayer->height();
+
+    mBuffer += '[';
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            if (x != 0 || y != 0)
+                mBuffer += ", ";
+
+            writeNumber(gidMapper.cellToGid(tileLayer->cellAt(x, y)));
+        }
+
+        flush();
+        if (!mError.isEmpty())
+            return;
+    }
+    mBuffer += ']';
+}
+
+/**
+ * Starts an object. Nested objects start on their own line, like they do in
+ * the output of JsonWriter.
+ */
+void JsonMapWriter::writeObjectStart(int depth)
+{
+    if (depth != 0) {
+        mBuffer += '\n';
+        mBuffer += indentation(depth);
+        mBuffer += "{\n";
+    } else {
+        mBuffer += '{';
+    }
+}
+
+void JsonMapWriter::writeKey(const QString &key, bool first, int depth)
+{
+    if (!first)
+        mBuffer += ",\n";
+
+    mBuffer += indentation(depth);
+    mBuffer += ' ';
+    writeString(key);
+    mBuffer += ':';
+}
+
+void JsonMapWriter::writeObjectEnd(int depth)
+{
+    mBuffer += '\n';
+    mBuffer += indentation(depth);
+    mBuffer += '}';
+}
+
+/**
+ * Writes a value that was created by the MapToVariantConverter, following
+ * the same rules as JsonWriter.
+ */
+void JsonMapWriter::writeValue(const QVariant &value, int depth)
+{
+    switch (value.type()) {
+    case QVariant::List:
+    case QVariant::StringList: {
+        const QVariantList list = value.toList();
+        mBuffer += '[';
+        for (int i = 0; i < list.size(); ++i) {
+            if (i != 0)
+                mBuffer += ", ";
+            writeValue(list.at(i), depth + 1);
+        }
+        mBuffer += ']';
+        break;
+    }
+    case QVariant::Map: {
+        const QVariantMap map = value.toMap();
+        writeObjectStart(depth);
+        QVariantMap::const_iterator it = map.constBegin();
+        QVariantMap::const_iterator it_end = map.constEnd();
+        for (; it != it_end; ++it) {
+            writeKey(it.key(), it == map.constBegin(), depth);
+            writeValue(it.value(), depth + 1);
+        }
+        writeObjectEnd(depth);
+        break;
+    }
+    case QVariant::String:
+    case QVariant::ByteArray:
+        writeString(value.toString());
+        break;
+    case QVariant::Double: {
+        const double d = value.toDouble();
+        if (qIsFinite(d))
+            mBuffer += QByteArray::number(d, 'g', 15);
+        else
+            mBuffer += "null";
+        break;
+    }
+    case QVariant::Bool:
+        mBuffer += value.toBool() ? "true" : "false";
+        break;
+    case QVariant::Invalid:
+        mBuffer += "null";
+        break;
+    case QVariant::Int:
+        mBuffer += QByteArray::number(value.toInt());
+        break;
+    case QVariant::UInt:
+        writeNumber(value.toUInt());
+        break;
+    case QVariant::LongLong:
+        mBuffer += QByteArray::number(value.toLongLong());
+        break;
+    case QVariant::ULongLong:
+        mBuffer += QByteArray::number(value.toULongLong());
+        break;
+    default:
+        if ((int) value.type() == (int) QMetaType::Float) {
+            mBuffer += QByteArray::number(value.toDouble(), 'g', 15);
+        } else if (value.canConvert<qlonglong>()) {
+            mBuffer += QByteArray::number(value.toLongLong());
+        } else if (value.canConvert<QString>()) {
+            writeString(value.toString());
+        } else {
+            mError = QString(QLatin1String("Unsupported type %1"))
+                    .arg(QLatin1String(value.typeName()));
+            mBuffer += "null";
+        }
+        break;
+    }
+
+    flush();
+}
+
+/**
+ * Writes a quoted string, escaped the same way as JsonWriter does.
+ */
+void JsonMapWriter::writeString(const QString &string)
+{
+    mBuffer += '"';
+
+    const QChar *c = string.constData();
+    const QChar *end = c + string.length();
+    for (; c != end; ++c) {
+        const ushort u = c->unicode();
+        switch (u) {
+        case '\b': mBuffer += "\\b"; break;
+        case '\f': mBuffer += "\\f"; break;
+        case '\n': mBuffer += "\\n"; break;
+        case '\r': mBuffer += "\\r"; break;
+        case '\t': mBuffer += "\\t"; break;
+        case '"':  mBuffer += "\\\""; break;
+        case '\\': mBuffer += "\\\\"; break;
+        case '/':  mBuffer += "\\/"; break;
+        default:
+            if (u > 127) {
+                mBuffer += "\\u";
+                mBuffer += hexDigits[(u >> 12) & 0xF];
+                mBuffer += hexDigits[(u >> 8) & 0xF];
+                mBuffer += hexDigits[(u >> 4) & 0xF];
+                mBuffer += hexDigits[u & 0xF];
+            } else {
+                mBuffer += char(u);
+            }
+            break;
+        }
+    }
+
+    mBuffer += '"';
+}
+
+/**
+ * Writes an unsigned number without going through a temporary string,
+ * since this is done for every tile.
+ */
+void JsonMapWriter::writeNumber(unsigned number)
+{
+    char digits[10];
+    int count = 0;
+
+    do {
+        digits[count++] = char('0' + number % 10);
+        number /= 10;
+    } while (number != 0);
+
+    while (count > 0)
+        mBuffer += digits[--count];
+}
+
+/**
+ * Writes the buffered data to the device once enough has been collected, or
+ * always when \a force is true.
+ */
+void JsonMapWriter::flush(bool force)
+{
+    if (mBuffer.isEmpty() || (!force && mBuffer.size() < BufferSize))
+        return;
+
+    if (mError.isEmpty() && mDevice->write(mBuffer) != mBuffer.size())
+        mError = mDevice->errorString();
+
+    mBuffer.resize(0);
+}
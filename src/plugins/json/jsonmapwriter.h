@@ -0,0 +1,84 @@
+/*
+ * JSON Tiled Plugin
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JSONMAPWRITER_H
+#define JSONMAPWRITER_H
+
+#include "maptovariantconverter.h"
+
+#include <QByteArray>
+#include <QString>
+
+class QIODevice;
+
+namespace Tiled {
+class Map;
+class TileLayer;
+}
+
+namespace Json {
+
+/**
+ * Writes a map as JSON directly to a device, without first converting the
+ * whole map to a QVariant. The tile layer data, which makes up most of a
+ * map, is written straight from the tile layers.
+ *
+ * The output is formatted the same way as the auto formatted output of
+ * JsonWriter.
+ */
+class JsonMapWriter
+{
+public:
+    JsonMapWriter();
+
+    /**
+     * Writes the given \a map to the \a device. The \a mapDir is used to
+     * construct relative paths to external resources.
+     *
+     * @return whether writing succeeded
+     */
+    bool write(const Tiled::Map *map, QIODevice *device, const QDir &mapDir);
+
+    const QString &errorString() const { return mError; }
+
+private:
+    Q_DISABLE_COPY(JsonMapWriter)
+
+    void writeTileLayer(const Tiled::TileLayer *tileLayer, int depth);
+    void writeTileData(const Tiled::TileLayer *tileLayer);
+
+    void writeObjectStart(int depth);
+    void writeKey(const QString &key, bool first, int depth);
+    void writeObjectEnd(int depth);
+    void writeValue(const QVariant &value, int depth);
+    void writeString(const QString &string);
+    void writeNumber(unsigned number);
+
+    void flush(bool force = false);
+
+    QIODevice *mDevice;
+    QByteArray mBuffer;
+    QString mError;
+    MapToVariantConverter mConverter;
+};
+
+} // namespace Json
+
+#endif // JSONMAPWRITER_H
@@ -21,7 +21,7 @@
 
 #include "jsonplugin.h"
 
-#include "maptovariantconverter.h"
+#include "jsonmapwriter.h"
 #include "varianttomapconverter.h"
 
 #include "qjsonparser/json.h"
@@ -94,37 +94,31 @@ bool JsonPlugin::write(const Tiled::Map *map, const QString &fileName)
         return false;
     }
 
-    MapToVariantConverter converter;
-    QVariant variant = converter.toVariant(map, QFileInfo(fileName).dir());
-
-    JsonWriter writer;
-    writer.setAutoFormatting(true);
-
-    if (!writer.stringify(variant)) {
-        // This can only happen due to coding error
-        mError = writer.errorString();
-        return false;
-    }
-
-    QTextStream out(&file);
     bool isJsFile = fileName.endsWith(".js");
     if (isJsFile) {
         // Trim and escape name
         JsonWriter nameWriter;
         QString baseName = QFileInfo(fileName).baseName();
         nameWriter.stringify(baseName);
+
+        QTextStream out(&file);
         out << "(function(name,data){\n if(typeof onTileMapLoaded === 'undefined') {\n";
         out << "  if(typeof TileMaps === 'undefined') TileMaps = {};\n";
         out << "  TileMaps[name] = data;\n";
         out << " } else {\n";
         out << "  onTileMapLoaded(name,data);\n";
         out << " }})(" << nameWriter.result() << ",\n";
+        out.flush();
     }
-    out << writer.result();
-    if (isJsFile) {
-        out << ");";
+
+    JsonMapWriter writer;
+    if (!writer.write(map, &file, QFileInfo(fileName).dir())) {
+        mError = tr("Error while writing file:\n%1").arg(writer.errorString());
+        return false;
     }
-    out.flush();
+
+    if (isJsFile)
+        file.write(");");
 
     if (file.error() != QFile::NoError) {
         mError = tr("Error while writing file:\n%1").arg(file.errorString());
@@ -35,6 +35,19 @@ using namespace Tiled;
 using namespace Json;
 
 QVariant MapToVariantConverter::toVariant(const Map *map, const QDir &mapDir)
+{
+    QVariantMap mapVariant = toVariantWithoutLayers(map, mapDir);
+
+    QVariantList layerVariants;
+    foreach (const Layer *layer, map->layers())
+        layerVariants << toVariant(layer);
+    mapVariant["layers"] = layerVariants;
+
+    return mapVariant;
+}
+
+QVariantMap MapToVariantConverter::toVariantWithoutLayers(const Map *map,
+                                                          const QDir &mapDir)
 {
     mMapDir = mapDir;
     mGidMapper.clear();
@@ -73,23 +86,21 @@ QVariant MapToVariantConverter::toVariant(const Map *map, const QDir &mapDir)
     }
     mapVariant["tilesets"] = tilesetVariants;
 
-    QVariantList layerVariants;
-    foreach (const Layer *layer, map->layers()) {
-        switch (layer->layerType()) {
-        case Layer::TileLayerType:
-            layerVariants << toVariant(static_cast<const TileLayer*>(layer));
-            break;
-        case Layer::ObjectGroupType:
-            layerVariants << toVariant(static_cast<const ObjectGroup*>(layer));
-            break;
-        case Layer::ImageLayerType:
-            layerVariants << toVariant(static_cast<const ImageLayer*>(layer));
-            break;
-        }
+    return mapVariant;
+}
+
+QVariant MapToVariantConverter::toVariant(const Layer *layer) const
+{
+    switch (layer->layerType()) {
+    case Layer::TileLayerType:
+        return toVariant(static_cast<const TileLayer*>(layer));
+    case Layer::ObjectGroupType:
+        return toVariant(static_cast<const ObjectGroup*>(layer));
+    case Layer::ImageLayerType:
+        return toVariant(static_cast<const ImageLayer*>(layer));
     }
-    mapVariant["layers"] = layerVariants;
 
-    return mapVariant;
+    return QVariant();
 }
 
 QVariant MapToVariantConverter::toVariant(const Tileset *tileset,
@@ -204,10 +215,7 @@ QVariant MapToVariantConverter::toVariant(const Properties &properties) const
 
 QVariant MapToVariantConverter::toVariant(const TileLayer *tileLayer) const
 {
-    QVariantMap tileLayerVariant;
-    tileLayerVariant["type"] = "tilelayer";
-
-    addLayerAttributes(tileLayerVariant, tileLayer);
+    QVariantMap tileLayerVariant = toVariantWithoutData(tileLayer);
 
     QVariantList tileVariants;
     for (int y = 0; y < tileLayer->height(); ++y)
@@ -218,6 +226,16 @@ QVariant MapToVariantConverter::toVariant(const TileLayer *tileLayer) const
     return tileLayerVariant;
 }
 
+QVariantMap MapToVariantConverter::toVariantWithoutData(const TileLayer *tileLayer) const
+{
+    QVariantMap tileLayerVariant;
+    tileLayerVariant["type"] = "tilelayer";
+
+    addLayerAttributes(tileLayerVariant, tileLayer);
+
+    return tileLayerVariant;
+}
+
 QVariant MapToVariantConverter::toVariant(const ObjectGroup *objectGroup) const
 {
     QVariantMap objectGroupVariant;
@@ -44,6 +44,25 @@ public:
      */
     QVariant toVariant(const Tiled::Map *map, const QDir &mapDir);
 
+    /**
+     * Converts the given \a map to a QVariantMap, leaving out its layers.
+     * Afterwards, the layers of the map can be converted using
+     * toVariant(const Tiled::Layer*).
+     */
+    QVariantMap toVariantWithoutLayers(const Tiled::Map *map,
+                                       const QDir &mapDir);
+
+    QVariant toVariant(const Tiled::Layer *layer) const;
+
+    /**
+     * Converts the given \a tileLayer to a QVariantMap, leaving out its tile
+     * data. This allows the tile data to be written separately, using the
+     * gidMapper() to look up the global tile IDs.
+     */
+    QVariantMap toVariantWithoutData(const Tiled::TileLayer *tileLayer) const;
+
+    const Tiled::GidMapper &gidMapper() const { return mGidMapper; }
+
 private:
     QVariant toVariant(const Tiled::Tileset *tileset, int firstGid) const;
     QVariant toVariant(const Tiled::Properties &properties) const;
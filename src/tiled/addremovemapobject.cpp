@@ -26,6 +26,7 @@
 #include "mapobjectmodel.h"
 
 #include <QCoreApplication>
+#include <QHash>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
@@ -88,3 +89,111 @@ RemoveMapObject::RemoveMapObject(MapDocument *mapDocument,
 {
     setText(QCoreApplication::translate("Undo Commands", "Remove Object"));
 }
+
+
+AddRemoveMapObjects::AddRemoveMapObjects(MapDocument *mapDocument,
+                                         ObjectGroup *objectGroup,
+                                         const QList<MapObject*> &mapObjects,
+                                         bool ownObjects,
+                                         QUndoCommand *parent)
+    : QUndoCommand(parent)
+    , mMapDocument(mapDocument)
+    , mOwnsObjects(ownObjects)
+{
+    // Group the objects by the object group they are added to or removed from
+    QHash<ObjectGroup*, int> groupIndexes;
+
+    foreach (MapObject *mapObject, mapObjects) {
+        ObjectGroup *og = objectGroup ? objectGroup : mapObject->objectGroup();
+
+        int groupIndex = groupIndexes.value(og, -1);
+        if (groupIndex == -1) {
+            groupIndex = mGroupObjects.size();
+            groupIndexes.insert(og, groupIndex);
+
+            GroupObjects groupObjects;
+            groupObjects.objectGroup = og;
+            mGroupObjects.append(groupObjects);
+        }
+
+        GroupObjects &groupObjects = mGroupObjects[groupIndex];
+        groupObjects.objects.append(mapObject);
+        groupObjects.indexes.append(-1);
+    }
+}
+
+AddRemoveMapObjects::~AddRemoveMapObjects()
+{
+    if (mOwnsObjects)
+        foreach (const GroupObjects &groupObjects, mGroupObjects)
+            qDeleteAll(groupObjects.objects);
+}
+
+void AddRemoveMapObjects::addObjects()
+{
+    MapObjectModel *mapObjectModel = mMapDocument->mapObjectModel();
+
+    foreach (const GroupObjects &groupObjects, mGroupObjects)
+        mapObjectModel->insertObjects(groupObjects.objectGroup,
+                                      groupObjects.objects,
+                                      groupObjects.indexes);
+    mOwnsObjects = false;
+}
+
+void AddRemoveMapObjects::removeObjects()
+{
+    MapObjectModel *mapObjectModel = mMapDocument->mapObjectModel();
+
+    for (int i = 0; i < mGroupObjects.size(); ++i) {
+        GroupObjects &groupObjects = mGroupObjects[i];
+        groupObjects.indexes =
+                mapObjectModel->removeObjects(groupObjects.objectGroup,
+                                              groupObjects.objects);
+    }
+    mOwnsObjects = true;
+}
+
+
+AddMapObjects::AddMapObjects(MapDocument *mapDocument,
+                             ObjectGroup *objectGroup,
+                             const QList<MapObject*> &mapObjects,
+                             QUndoCommand *parent)
+    : AddRemoveMapObjects(mapDocument,
+                          objectGroup,
+                          mapObjects,
+                          true,
+                          parent)
+{
+#if QT_VERSION >= 0x050000
+    setText(QCoreApplication::translate("Undo Commands",
+                                        "Add %n Object(s)",
+                                        0, mapObjects.size()));
+#else
+    setText(QCoreApplication::translate("Undo Commands",
+                                        "Add %n Object(s)",
+                                        0, QCoreApplication::UnicodeUTF8,
+                                        mapObjects.size()));
+#endif
+}
+
+
+RemoveMapObjects::RemoveMapObjects(MapDocument *mapDocument,
+                                   const QList<MapObject*> &mapObjects,
+                                   QUndoCommand *parent)
+    : AddRemoveMapObjects(mapDocument,
+                          0,
+                          mapObjects,
+                          false,
+                          parent)
+{
+#if QT_VERSION >= 0x050000
+    setText(QCoreApplication::translate("Undo Commands",
+                                        "Remove %n Object(s)",
+                                        0, mapObjects.size()));
+#else
+    setText(QCoreApplication::translate("Undo Commands",
+                                        "Remove %n Object(s)",
+                                        0, QCoreApplication::UnicodeUTF8,
+                                        mapObjects.size()));
+#endif
+}
@@ -21,6 +21,7 @@
 #ifndef ADDREMOVEMAPOBJECT_H
 #define ADDREMOVEMAPOBJECT_H
 
+#include <QList>
 #include <QUndoCommand>
 
 namespace Tiled {
@@ -89,6 +90,72 @@ public:
     { removeObject(); }
 };
 
+/**
+ * Abstract base class for AddMapObjects and RemoveMapObjects. The objects are
+ * added or removed with a single operation for each object group involved.
+ */
+class AddRemoveMapObjects : public QUndoCommand
+{
+public:
+    AddRemoveMapObjects(MapDocument *mapDocument,
+                        ObjectGroup *objectGroup,
+                        const QList<MapObject*> &mapObjects,
+                        bool ownObjects,
+                        QUndoCommand *parent = 0);
+    ~AddRemoveMapObjects();
+
+protected:
+    void addObjects();
+    void removeObjects();
+
+private:
+    struct GroupObjects
+    {
+        ObjectGroup *objectGroup;
+        QList<MapObject*> objects;
+        QList<int> indexes;
+    };
+
+    MapDocument *mMapDocument;
+    QList<GroupObjects> mGroupObjects;
+    bool mOwnsObjects;
+};
+
+/**
+ * Undo command that adds a number of objects to an object group.
+ */
+class AddMapObjects : public AddRemoveMapObjects
+{
+public:
+    AddMapObjects(MapDocument *mapDocument, ObjectGroup *objectGroup,
+                  const QList<MapObject*> &mapObjects,
+                  QUndoCommand *parent = 0);
+
+    void undo()
+    { removeObjects(); }
+
+    void redo()
+    { addObjects(); }
+};
+
+/**
+ * Undo command that removes a number of objects from a map. The objects may
+ * be part of different object groups.
+ */
+class RemoveMapObjects : public AddRemoveMapObjects
+{
+public:
+    RemoveMapObjects(MapDocument *mapDocument,
+                     const QList<MapObject*> &mapObjects,
+                     QUndoCommand *parent = 0);
+
+    void undo()
+    { addObjects(); }
+
+    void redo()
+    { removeObjects(); }
+};
+
 } // namespace Internal
 } // namespace Tiled
 
@@ -39,10 +39,189 @@
 #include "tilesetmanager.h"
 
 #include <QDebug>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+namespace {
+
+/**
+ * Minimum amount of positions to check before the matching of a rule is
+ * spread over multiple threads.
+ */
+const int MinParallelPositions = 4096;
+
+} // anonymous namespace
+
+namespace Tiled {
+namespace Internal {
+
+/**
+ * The condition a single position of a rule puts on the cell found at the
+ * corresponding position of a set layer.
+ */
+struct CellCondition
+{
+    QPoint pos;
+    QSet<Cell> listYes;     // non-empty cells of the listYes layers at pos
+    QSet<Cell> listNo;      // non-empty cells of the listNo layers at pos
+};
+
+/**
+ * The conditions one input index of a rule puts on one tile layer of the
+ * working map. See compileLayerCondition() for how these are derived from
+ * the listYes and listNo layers.
+ */
+struct LayerCondition
+{
+    bool matches(const QPoint &offset) const;
+
+    const TileLayer *setLayer;
+    QVector<QRect> rects;       // rectangles making up the rule input
+    bool hasListYes;
+    bool hasListNo;
+    QSet<Cell> cells;           // all cells of the listYes layers
+    QVector<CellCondition> positions;
+};
+
+/**
+ * The conditions of a single input index, all of which need to match.
+ *
+ * The anchor is the position that allows the fewest different cells. It is
+ * checked first, which rejects most positions with a single lookup.
+ */
+struct IndexCondition
+{
+    bool matches(const QPoint &offset) const;
+
+    QVector<LayerCondition> layers;
+    const TileLayer *anchorLayer;   // 0 when no position has a listYes cell
+    QPoint anchorPos;
+    QSet<Cell> anchorCells;
+};
+
+/**
+ * A rule compiled against the layers of the working map. The rule matches
+ * when any of its input indexes matches.
+ */
+class CompiledRule
+{
+public:
+    bool matches(const QPoint &offset) const;
+
+    QVector<IndexCondition> indexes;
+
+    /**
+     * Whether the rule writes to any of the layers it reads from.
+     */
+    bool readsOwnOutput;
+};
+
+// Plain loops are used in the matching functions below since they are called
+// concurrently and foreach would copy (and thus reference count) the shared
+// containers.
+
+bool LayerCondition::matches(const QPoint &offset) const
+{
+    // Every position of the rule input needs to be on the layer, which is
+    // checked per rectangle rather than for the bounding rectangle, since the
+    // latter may include positions that are not part of the rule
+    const QRect layerRect(0, 0, setLayer->width(), setLayer->height());
+    for (int i = 0; i < rects.size(); ++i)
+        if (!layerRect.contains(rects.at(i).translated(offset)))
+            return false;
+
+    for (int i = 0; i < positions.size(); ++i) {
+        const CellCondition &condition = positions.at(i);
+        const QPoint pos = condition.pos + offset;
+        const Cell cell = setLayer->cellAt(pos.x(), pos.y());
+
+        if (hasListYes && hasListNo) {
+            if (!condition.listYes.isEmpty() && !condition.listYes.contains(cell))
+                return false;
+            if (condition.listNo.contains(cell))
+                return false;
+        } else if (hasListYes) {
+            if (condition.listYes.contains(cell))
+                continue;
+            if (condition.listYes.isEmpty() && !cells.contains(cell))
+                continue;
+            return false;
+        } else {
+            if (condition.listNo.contains(cell))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+bool IndexCondition::matches(const QPoint &offset) const
+{
+    if (anchorLayer) {
+        const QPoint pos = anchorPos + offset;
+        if (!anchorLayer->contains(pos.x(), pos.y()))
+            return false;
+        if (!anchorCells.contains(anchorLayer->cellAt(pos.x(), pos.y())))
+            return false;
+    }
+
+    for (int i = 0; i < layers.size(); ++i)
+        if (!layers.at(i).matches(offset))
+            return false;
+
+    return true;
+}
+
+bool CompiledRule::matches(const QPoint &offset) const
+{
+    for (int i = 0; i < indexes.size(); ++i)
+        if (indexes.at(i).matches(offset))
+            return true;
+
+    return false;
+}
+
+/**
+ * Finds the positions at which a rule matches within a band of rows. Only
+ * reads from the working map, so that multiple bands can be checked at the
+ * same time.
+ */
+class RuleMatcher : public QRunnable
+{
+public:
+    RuleMatcher(const CompiledRule &rule,
+                int minX, int maxX, int minY, int maxY)
+        : mRule(rule)
+        , mMinX(minX), mMaxX(maxX)
+        , mMinY(minY), mMaxY(maxY)
+    {
+        setAutoDelete(false);
+    }
+
+    void run()
+    {
+        for (int y = mMinY; y <= mMaxY; ++y)
+            for (int x = mMinX; x <= mMaxX; ++x)
+                if (mRule.matches(QPoint(x, y)))
+                    mMatches.append(QPoint(x, y));
+    }
+
+    const QVector<QPoint> &matches() const { return mMatches; }
+
+private:
+    const CompiledRule &mRule;
+    const int mMinX, mMaxX;
+    const int mMinY, mMaxY;
+    QVector<QPoint> mMatches;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
 /*
  * About the order of the methods in this file.
  * The Automapper class has 3 bigger public functions, that is
@@ -62,6 +241,7 @@ AutoMapper::AutoMapper(MapDocument *workingDocument, Map *rules,
     , mDeleteTiles(false)
     , mAutoMappingRadius(0)
     , mNoOverlappingRules(false)
+    , mRulesCompiled(false)
 {
     Q_ASSERT(mMapRules);
 
@@ -341,6 +521,8 @@ bool AutoMapper::prepareAutoMap()
     if (!setupTilesets(mMapRules, mMapWork))
         return false;
 
+    compileRules();
+
     return true;
 }
 
@@ -358,6 +540,7 @@ bool AutoMapper::setupMissingLayers()
         mMapDocument->undoStack()->push(
                     new AddLayer(mMapDocument, index, tilelayer));
         mAddedTileLayers.append(name);
+        mRulesCompiled = false;
     }
 
     foreach (const QString &name, mTouchedObjectGroups) {
@@ -371,6 +554,7 @@ bool AutoMapper::setupMissingLayers()
         mMapDocument->undoStack()->push(
                     new AddLayer(mMapDocument, index, objectGroup));
         mAddedTileLayers.append(name);
+        mRulesCompiled = false;
     }
 
     return true;
@@ -435,6 +619,7 @@ bool AutoMapper::setupTilesets(Map *src, Map *dst)
                                                  properties));
         }
         src->replaceTileset(tileset, replacement);
+        mRulesCompiled = false;
 
         tilesetManager->addReference(replacement);
         tilesetManager->removeReference(tileset);
@@ -477,17 +662,18 @@ void AutoMapper::autoMap(QRegion *where)
         }
     }
 
+    // The matching of each rule is spread over this thread pool, while the
+    // matches are applied in order on this thread. A local pool is used so
+    // that we can wait for exactly our own tasks.
+    QThreadPool threadPool;
+
     // Increase the given region where the next automapper should work.
     // This needs to be done, so you can rely on the order of the rules at all
     // locations
     QRegion ret;
     foreach (const QRect &rect, where->rects())
-        for (int i = 0; i < mRulesInput.size(); ++i) {
-            // at the moment the parallel execution does not work yet
-            // TODO: make multithreading available!
-            // either by dividing the rules or the region to multiple threads
-            ret = ret.united(applyRule(i, rect));
-        }
+        for (int i = 0; i < mRulesInput.size(); ++i)
+            ret = ret.united(applyRule(i, rect, &threadPool));
     *where = where->united(ret);
 }
 
@@ -504,21 +690,19 @@ const QRegion AutoMapper::getSetLayersRegion()
     return result;
 }
 
-static bool compareLayerTo(const TileLayer *setLayer,
-                           const QVector<TileLayer*> &listYes,
-                           const QVector<TileLayer*> &listNo,
-                           const QRegion &ruleRegion, const QPoint &offset);
-
-QRect AutoMapper::applyRule(const int ruleIndex, const QRect &where)
+QRect AutoMapper::applyRule(const int ruleIndex, const QRect &where,
+                            QThreadPool *threadPool)
 {
     QRect ret;
 
     if (mLayerList.isEmpty())
         return ret;
 
-    const QRegion ruleInput = mRulesInput.at(ruleIndex);
-    const QRegion ruleOutput = mRulesOutput.at(ruleIndex);
-    QRect rbr = ruleInput.boundingRect();
+    const CompiledRule &rule = *mCompiledRules.at(ruleIndex);
+    if (rule.indexes.isEmpty())
+        return ret;
+
+    const QRect rbr = mRulesInput.at(ruleIndex).boundingRect();
 
     // Since the rule itself is translated, we need to adjust the borders of the
     // loops. Decrease the size at all sides by one: There must be at least one
@@ -538,97 +722,115 @@ QRect AutoMapper::applyRule(const int ruleIndex, const QRect &where)
         for (int i = 0; i < mMapWork->layerCount(); i++)
             appliedRegions.append(QRegion());
 
-    for (int y = minY; y <= maxY; ++y)
-    for (int x = minX; x <= maxX; ++x) {
-        bool anymatch = false;
-        foreach (const QString &index, mInputRules.indexes) {
-            const InputIndex &ii = mInputRules[index];
-
-            bool allLayerNamesMatch = true;
-            foreach (const QString &name, ii.names) {
-                const int i = mMapWork->indexOfLayer(name, Layer::TileLayerType);
-                if (i == -1) {
-                    allLayerNamesMatch = false;
-                } else {
-                    const TileLayer *setLayer = mMapWork->layerAt(i)->asTileLayer();
-                    allLayerNamesMatch &= compareLayerTo(setLayer,
-                                                         ii[name].listYes,
-                                                         ii[name].listNo,
-                                                         ruleInput,
-                                                         QPoint(x, y));
+    // When the rule writes to any of the layers it reads from, a match can
+    // depend on the output of a previous match, so each position needs to be
+    // checked right before applying the rule there.
+    if (rule.readsOwnOutput) {
+        for (int y = minY; y <= maxY; ++y) {
+            for (int x = minX; x <= maxX; ++x) {
+                const QPoint offset(x, y);
+                if (rule.matches(offset) &&
+                        applyRuleOutput(ruleIndex, offset, appliedRegions)) {
+                    ret = ret.united(rbr.translated(offset));
                 }
             }
-            if (allLayerNamesMatch) {
-                anymatch = true;
-                break;
-            }
         }
+        return ret;
+    }
 
-        if (anymatch) {
-            int r = 0;
-            // choose by chance which group of rule_layers should be used:
-            if (mLayerList.size() > 1)
-                r = qrand() % mLayerList.size();
+    // Otherwise all matches can be found up front and in parallel, after
+    // which they are applied in the same order as they would have been
+    // found sequentially.
+    const int rows = maxY - minY + 1;
+    const int columns = maxX - minX + 1;
+    int bandCount = 1;
+
+    if (rows > 1 && columns * rows >= MinParallelPositions)
+        bandCount = qBound(1, QThread::idealThreadCount() * 4, rows);
+
+    QVector<RuleMatcher*> matchers;
+    for (int band = 0; band < bandCount; ++band) {
+        const int bandMinY = minY + rows * band / bandCount;
+        const int bandMaxY = minY + rows * (band + 1) / bandCount - 1;
+        matchers.append(new RuleMatcher(rule,
+                                        minX, maxX, bandMinY, bandMaxY));
+    }
 
-            if (!mNoOverlappingRules) {
-                copyMapRegion(ruleOutput, QPoint(x, y), mLayerList.at(r));
-                ret = ret.united(rbr.translated(QPoint(x, y)));
-                continue;
-            }
+    if (bandCount == 1) {
+        matchers.first()->run();
+    } else {
+        foreach (RuleMatcher *matcher, matchers)
+            threadPool->start(matcher);
+        threadPool->waitForDone();
+    }
 
-            bool missmatch = false;
-            RuleOutput *translationTable = mLayerList.at(r);
-            QList<Layer*> layers = translationTable->keys();
+    foreach (RuleMatcher *matcher, matchers) {
+        foreach (const QPoint &offset, matcher->matches())
+            if (applyRuleOutput(ruleIndex, offset, appliedRegions))
+                ret = ret.united(rbr.translated(offset));
+        delete matcher;
+    }
 
-            // check if there are no overlaps within this rule.
-            QVector<QRegion> ruleRegionInLayer;
-            for (int i = 0; i < layers.size(); ++i) {
-                Layer *layer = layers.at(i);
+    return ret;
+}
 
-                QRegion appliedPlace;
-                TileLayer *tileLayer = layer->asTileLayer();
-                if (tileLayer)
-                    appliedPlace = tileLayer->region();
-                else
-                    appliedPlace = tileRegionOfObjectGroup(layer->asObjectGroup());
+bool AutoMapper::applyRuleOutput(const int ruleIndex, const QPoint &offset,
+                                 QList<QRegion> &appliedRegions)
+{
+    const QRegion &ruleOutput = mRulesOutput.at(ruleIndex);
 
-                ruleRegionInLayer.append(appliedPlace.intersected(ruleOutput));
-                if (appliedRegions.at(i).intersects(
-                            ruleRegionInLayer[i].translated(x, y))) {
-                    missmatch = true;
-                    break;
-                }
-            }
-            if (missmatch)
-                continue;
+    int r = 0;
+    // choose by chance which group of rule_layers should be used:
+    if (mLayerList.size() > 1)
+        r = qrand() % mLayerList.size();
 
-            copyMapRegion(ruleOutput, QPoint(x, y), mLayerList.at(r));
-            ret = ret.united(rbr.translated(QPoint(x, y)));
-            for (int i = 0; i < translationTable->size(); ++i) {
-                appliedRegions[i] +=
-                        ruleRegionInLayer[i].translated(x, y);
-            }
+    if (!mNoOverlappingRules) {
+        copyMapRegion(ruleOutput, offset, mLayerList.at(r));
+        return true;
+    }
+
+    RuleOutput *translationTable = mLayerList.at(r);
+    QList<Layer*> layers = translationTable->keys();
+
+    // check if there are no overlaps within this rule.
+    QVector<QRegion> ruleRegionInLayer;
+    for (int i = 0; i < layers.size(); ++i) {
+        Layer *layer = layers.at(i);
+
+        QRegion appliedPlace;
+        TileLayer *tileLayer = layer->asTileLayer();
+        if (tileLayer)
+            appliedPlace = tileLayer->region();
+        else
+            appliedPlace = tileRegionOfObjectGroup(layer->asObjectGroup());
+
+        ruleRegionInLayer.append(appliedPlace.intersected(ruleOutput));
+        if (appliedRegions.at(i).intersects(
+                    ruleRegionInLayer[i].translated(offset))) {
+            return false;
         }
     }
 
-    return ret;
+    copyMapRegion(ruleOutput, offset, translationTable);
+    for (int i = 0; i < translationTable->size(); ++i)
+        appliedRegions[i] += ruleRegionInLayer[i].translated(offset);
+
+    return true;
 }
 
 /**
- * Returns a list of all cells which can be found within all tile layers
+ * Returns a set of all cells which can be found within all tile layers
  * within the given region.
  */
-static QVector<Cell> cellsInRegion(const QVector<TileLayer*> &list,
-                                   const QRegion &r)
+static QSet<Cell> cellsInRegion(const QVector<TileLayer*> &list,
+                                const QRegion &r)
 {
-    QVector<Cell> cells;
+    QSet<Cell> cells;
     foreach (const TileLayer *tilelayer, list) {
         foreach (const QRect &rect, r.rects()) {
             for (int x = rect.left(); x <= rect.right(); ++x) {
                 for (int y = rect.top(); y <= rect.bottom(); ++y) {
-                    const Cell &cell = tilelayer->cellAt(x, y);
-                    if (!cells.contains(cell))
-                        cells.append(cell);
+                    cells.insert(tilelayer->cellAt(x, y));
                 }
             }
         }
@@ -639,22 +841,22 @@ static QVector<Cell> cellsInRegion(const QVector<TileLayer*> &list,
 /**
  * This function is one of the core functions for understanding the
  * automapping.
- * In this function a certain region (of the set layer) is compared to
- * several other layers (ruleSet and ruleNotSet).
- * This comparision will determine if a rule of automapping matches,
- * so if this rule is applied at this region given
- * by a QRegion and Offset given by a QPoint.
+ * In this function the conditions that several layers (ruleSet and
+ * ruleNotSet) put on a certain region of the set layer are compiled into
+ * \a condition. These conditions determine if a rule of automapping
+ * matches, so if this rule is applied at this region given by a QRegion and
+ * an offset given by a QPoint (see LayerCondition::matches()).
  *
- * This compares the tile layer setLayer to several others given
- * in the QList listYes (ruleSet) and OList listNo (ruleNotSet).
- * The tile layer setLayer is examined at QRegion ruleRegion + offset
- * The tile layers within listYes and listNo are examined at QRegion ruleRegion.
+ * The conditions are taken from the QList listYes (ruleSet) and QList
+ * listNo (ruleNotSet). The tile layer setLayer is examined at
+ * ruleRegion + offset. The tile layers within listYes and listNo are
+ * examined at ruleRegion.
  *
  * Basically all matches between setLayer and a layer of listYes are considered
  * good, while all matches between setLayer and listNo are considered bad and
  * lead to canceling the comparison, returning false.
  *
- * The comparison is done for each position within the QRegion ruleRegion.
+ * The comparison is done for each position within the ruleRegion.
  * If all positions of the region are considered "good" return true.
  *
  * Now there are several cases to distinguish:
@@ -693,99 +895,140 @@ static QVector<Cell> cellsInRegion(const QVector<TileLayer*> &list,
  *      It was not added to the case, when having only listNo layers to
  *      avoid total symmetrie between those lists.
  *
- * If all positions are considered good, return true.
- * return false otherwise.
+ * Positions which allow any cell are left out of the compiled conditions.
  *
- * @return bool, if the tile layer matches the given list of layers.
+ * @return bool, false if the rule can never match the set layer.
  */
-static bool compareLayerTo(const TileLayer *setLayer,
-                           const QVector<TileLayer*> &listYes,
-                           const QVector<TileLayer*> &listNo,
-                           const QRegion &ruleRegion, const QPoint &offset)
+static bool compileLayerCondition(const TileLayer *setLayer,
+                                  const QVector<TileLayer*> &listYes,
+                                  const QVector<TileLayer*> &listNo,
+                                  const QRegion &ruleRegion,
+                                  LayerCondition &condition)
 {
     if (listYes.isEmpty() && listNo.isEmpty())
         return false;
 
-    QVector<Cell> cells;
-    if (listYes.isEmpty())
-        cells = cellsInRegion(listNo, ruleRegion);
-    if (listNo.isEmpty())
-        cells = cellsInRegion(listYes, ruleRegion);
+    condition.setLayer = setLayer;
+    condition.rects = ruleRegion.rects();
+    condition.hasListYes = !listYes.isEmpty();
+    condition.hasListNo = !listNo.isEmpty();
+
+    // the cells are only needed for the exception mentioned above
+    if (!condition.hasListNo)
+        condition.cells = cellsInRegion(listYes, ruleRegion);
 
     foreach (const QRect &rect, ruleRegion.rects()) {
         for (int x = rect.left(); x <= rect.right(); ++x) {
             for (int y = rect.top(); y <= rect.bottom(); ++y) {
-                // this is only used in the case where only one list has layers
-                // it is needed for the exception mentioned above
-                bool ruleDefinedListYes = false;
-
-                bool matchListYes = false;
-                bool matchListNo  = false;
-
-                if (!setLayer->contains(x + offset.x(), y + offset.y()))
-                    return false;
-
-                const Cell &c1 = setLayer->cellAt(x + offset.x(),
-                                                  y + offset.y());
-
-                // ruleDefined will be set when there is a tile in at least
-                // one layer. if there is a tile in at least one layer, only
-                // the given tiles in the different listYes layers are valid.
-                // if there is given no tile at all in the listYes layers,
-                // consider all tiles valid.
+                CellCondition cellCondition;
+                cellCondition.pos = QPoint(x, y);
 
                 foreach (const TileLayer *comparedTileLayer, listYes) {
-
                     if (!comparedTileLayer->contains(x, y))
                         return false;
 
-                    const Cell &c2 = comparedTileLayer->cellAt(x, y);
-                    if (!c2.isEmpty())
-                        ruleDefinedListYes = true;
-
-                    if (!c2.isEmpty() && c1 == c2)
-                        matchListYes = true;
+                    const Cell cell = comparedTileLayer->cellAt(x, y);
+                    if (!cell.isEmpty())
+                        cellCondition.listYes.insert(cell);
                 }
                 foreach (const TileLayer *comparedTileLayer, listNo) {
-
                     if (!comparedTileLayer->contains(x, y))
                         return false;
 
-                    const Cell &c2 = comparedTileLayer->cellAt(x, y);
+                    const Cell cell = comparedTileLayer->cellAt(x, y);
+                    if (!cell.isEmpty())
+                        cellCondition.listNo.insert(cell);
+                }
+
+                // without any tiles, this position only restricts the set
+                // layer when there are only listYes layers
+                if (condition.hasListNo &&
+                        cellCondition.listYes.isEmpty() &&
+                        cellCondition.listNo.isEmpty())
+                    continue;
 
-                    if (!c2.isEmpty() && c1 == c2)
-                        matchListNo = true;
+                condition.positions.append(cellCondition);
+            }
+        }
+    }
+    return true;
+}
+
+void AutoMapper::compileRules()
+{
+    if (mRulesCompiled)
+        return;
+
+    qDeleteAll(mCompiledRules);
+    mCompiledRules.clear();
+
+    QSet<const Layer*> outputLayers;
+    foreach (const RuleOutput *translationTable, mLayerList)
+        foreach (int layerIndex, translationTable->values())
+            outputLayers.insert(mMapWork->layerAt(layerIndex));
+
+    foreach (const QRegion &ruleInput, mRulesInput) {
+        CompiledRule *rule = new CompiledRule;
+        rule->readsOwnOutput = false;
+
+        foreach (const QString &index, mInputRules.indexes) {
+            const InputIndex &ii = mInputRules.constFind(index).value();
+
+            IndexCondition indexCondition;
+            indexCondition.anchorLayer = 0;
+
+            // An index referring to a layer that does not exist, or which
+            // can never match one of its layers, is left out.
+            bool canMatch = true;
+            foreach (const QString &name, ii.names) {
+                const int i = mMapWork->indexOfLayer(name, Layer::TileLayerType);
+                if (i == -1) {
+                    canMatch = false;
+                    break;
                 }
 
-                // when there are only layers in the listNo
-                // check only if these layers are unmatched
-                // no need to check explicitly the exception in this case.
-                if (listYes.isEmpty()) {
-                    if (matchListNo)
-                        return false;
-                    else
-                        continue;
+                const InputIndexName &ruleLayers = ii.constFind(name).value();
+                LayerCondition condition;
+                if (!compileLayerCondition(mMapWork->layerAt(i)->asTileLayer(),
+                                           ruleLayers.listYes,
+                                           ruleLayers.listNo,
+                                           ruleInput,
+                                           condition)) {
+                    canMatch = false;
+                    break;
                 }
-                // when there are only layers in the listYes
-                // check if these layers are matched, or if the exception works
-                if (listNo.isEmpty()) {
-                    if (matchListYes)
-                        continue;
-                    if (!ruleDefinedListYes && !cells.contains(c1))
+                indexCondition.layers.append(condition);
+            }
+            if (!canMatch)
+                continue;
+
+            // A position with cells in the listYes layers only allows those
+            // cells, so the one with the fewest cells is used as anchor
+            foreach (const LayerCondition &condition, indexCondition.layers) {
+                foreach (const CellCondition &cellCondition, condition.positions) {
+                    if (cellCondition.listYes.isEmpty())
                         continue;
-                    return false;
+                    if (!indexCondition.anchorLayer ||
+                            cellCondition.listYes.size() <
+                            indexCondition.anchorCells.size()) {
+                        indexCondition.anchorLayer = condition.setLayer;
+                        indexCondition.anchorPos = cellCondition.pos;
+                        indexCondition.anchorCells = cellCondition.listYes;
+                    }
                 }
 
-                // there are layers in both lists:
-                // no need to consider ruleDefinedListXXX
-                if ((matchListYes || !ruleDefinedListYes) && !matchListNo)
-                    continue;
-                else
-                    return false;
+                if (outputLayers.contains(condition.setLayer))
+                    rule->readsOwnOutput = true;
             }
+
+            rule->indexes.append(indexCondition);
         }
+
+        mCompiledRules.append(rule);
     }
-    return true;
+
+    Q_ASSERT(mRulesInput.size() == mCompiledRules.size());
+    mRulesCompiled = true;
 }
 
 void AutoMapper::copyMapRegion(const QRegion &region, QPoint offset,
@@ -860,8 +1103,10 @@ void AutoMapper::copyObjectRegion(ObjectGroup *srcLayer, int srcX, int srcY,
         clones.append(clone);
         clone->setX(clone->x() + pixelOffset.x());
         clone->setY(clone->y() + pixelOffset.y());
-        undo->push(new AddMapObject(mMapDocument, dstLayer, clone));
     }
+
+    if (!clones.isEmpty())
+        undo->push(new AddMapObjects(mMapDocument, dstLayer, clones));
 }
 
 void AutoMapper::cleanAll()
@@ -900,6 +1145,7 @@ void AutoMapper::cleanTileLayers()
 
         QUndoStack *undo = mMapDocument->undoStack();
         undo->push(new RemoveLayer(mMapDocument, layerIndex));
+        mRulesCompiled = false;
     }
     mAddedTileLayers.clear();
 }
@@ -927,6 +1173,10 @@ void AutoMapper::cleanUpRuleMapLayers()
 {
     cleanTileLayers();
 
+    qDeleteAll(mCompiledRules);
+    mCompiledRules.clear();
+    mRulesCompiled = false;
+
     QList<RuleOutput*>::const_iterator it;
     for (it = mLayerList.constBegin(); it != mLayerList.constEnd(); ++it)
         delete (*it);
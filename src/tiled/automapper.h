@@ -30,6 +30,8 @@
 #include <QString>
 #include <QVector>
 
+class QThreadPool;
+
 namespace Tiled {
 
 class Layer;
@@ -41,6 +43,7 @@ class Tileset;
 
 namespace Internal {
 
+class CompiledRule;
 class MapDocument;
 
 class InputIndexName
@@ -125,9 +128,19 @@ public:
     /**
      * This cleans all datastructures, which are setup via prepareAutoMap,
      * so the auto mapper becomes ready for its next automatic mapping.
+     *
+     * The compiled rules are kept, so that they can be reused by the next
+     * automatic mapping as long as the layers of the working map stay the
+     * same.
      */
     void cleanAll();
 
+    /**
+     * Makes the next prepareAutoMap() compile the rules again. Needs to be
+     * called when layers of the working map were added, removed or renamed.
+     */
+    void invalidateCompiledRules() { mRulesCompiled = false; }
+
     /**
      * Contains all errors until operation was canceled.
      * The errorlist is cleared within prepareLoad and prepareAutoMap.
@@ -184,6 +197,14 @@ private:
      */
     bool setupTilesets(Map *src, Map *dst);
 
+    /**
+     * Compiles the input of all rules against the layers of the working
+     * map, resolving the layer names and collecting the allowed cells at
+     * each position, so that matching a rule does not need to look at the
+     * rules map. Does nothing when the compiled rules are still valid.
+     */
+    void compileRules();
+
     /**
      * Returns the conjunction of of all regions of all setlayers
      */
@@ -231,11 +252,28 @@ private:
      * This goes through all the positions of the mMapWork and checks if
      * there fits the rule given by the region in mMapRuleSet.
      * if there is a match all Layers are copied to mMapWork.
+     *
+     * The rule needs to have been compiled by compileRules().
+     *
+     * When the rule does not read from the layers it writes to, the
+     * positions are checked in parallel using \a threadPool, after which the
+     * matches are applied in order.
+     *
      * @param ruleIndex: the region which should be compared to all positions
      *              of mMapWork will be looked up in mRulesInput and mRulesOutput
      * @return where: an rectangle where the rule actually got applied
      */
-    QRect applyRule(const int ruleIndex, const QRect &where);
+    QRect applyRule(const int ruleIndex, const QRect &where,
+                    QThreadPool *threadPool);
+
+    /**
+     * Copies the output of the rule at \a ruleIndex to the working map at
+     * the given \a offset, unless overlapping rules are not allowed and the
+     * output would overlap with \a appliedRegions.
+     * @return returns true when the output was applied.
+     */
+    bool applyRuleOutput(const int ruleIndex, const QPoint &offset,
+                         QList<QRegion> &appliedRegions);
 
     /**
      * Cleans up the data structes filled by setupRuleMapLayers(),
@@ -314,6 +352,12 @@ private:
      */
     QList<QRegion> mRulesOutput;
 
+    /**
+     * The rules compiled by compileRules(), matching the indexes of
+     * mRulesInput.
+     */
+    QList<CompiledRule*> mCompiledRules;
+
     /**
      * The inner set with layers to indexes is needed for translating
      * tile layers from mMapRules to mMapWork.
@@ -354,6 +398,11 @@ private:
      */
     bool mNoOverlappingRules;
 
+    /**
+     * Whether mCompiledRules are up to date with the working map.
+     */
+    bool mRulesCompiled;
+
     QSet<QString> mTouchedTileLayers;
 
     QSet<QString> mTouchedObjectGroups;
@@ -30,15 +30,24 @@
 
 #include <QFileInfo>
 #include <QTextStream>
+#include <QUndoStack>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+/**
+ * The time in milliseconds edits are collected before they are automapped.
+ */
+static const int AutoMapDelay = 50;
+
 AutomappingManager::AutomappingManager(QObject *parent)
     : QObject(parent)
     , mMapDocument(0)
     , mLoaded(false)
 {
+    mAutoMapTimer.setSingleShot(true);
+    connect(&mAutoMapTimer, SIGNAL(timeout()),
+            SLOT(autoMapEditedRegion()));
 }
 
 AutomappingManager::~AutomappingManager()
@@ -51,28 +60,66 @@ void AutomappingManager::autoMap()
     if (!mMapDocument)
         return;
 
+    // The whole map is processed, so there is no need to process the edited
+    // region afterwards
+    mAutoMapTimer.stop();
+    mEditedRegion = QRegion();
+    mEditedLayers.clear();
+
     Map *map = mMapDocument->map();
     int w = map->width();
     int h = map->height();
 
-    autoMapInternal(QRect(0, 0, w, h), 0);
+    autoMapInternal(QRect(0, 0, w, h), QSet<QString>());
 }
 
 void AutomappingManager::autoMap(const QRegion &where, Layer *touchedLayer)
 {
-    if (Preferences::instance()->automappingDrawing())
-        autoMapInternal(where, touchedLayer);
+    if (!touchedLayer || !Preferences::instance()->automappingDrawing())
+        return;
+
+    mEditedRegion += where;
+    mEditedLayers.insert(touchedLayer->name());
+
+    // Not restarted when already active, so that automapping keeps up while
+    // drawing continuously
+    if (!mAutoMapTimer.isActive())
+        mAutoMapTimer.start(AutoMapDelay);
+}
+
+void AutomappingManager::autoMapEditedRegion()
+{
+    const QRegion where = mEditedRegion;
+    const QSet<QString> touchedLayers = mEditedLayers;
+    mEditedRegion = QRegion();
+    mEditedLayers.clear();
+
+    if (!mMapDocument || touchedLayers.isEmpty())
+        return;
+
+    // When the edits were undone in the meantime, automapping now would
+    // discard the redo history
+    if (mMapDocument->undoStack()->canRedo())
+        return;
+
+    autoMapInternal(where, touchedLayers);
+}
+
+void AutomappingManager::invalidateCompiledRules()
+{
+    foreach (AutoMapper *autoMapper, mAutoMappers)
+        autoMapper->invalidateCompiledRules();
 }
 
 void AutomappingManager::autoMapInternal(const QRegion &where,
-                                         Layer *touchedLayer)
+                                         const QSet<QString> &touchedLayers)
 {
     mError.clear();
     mWarning.clear();
     if (!mMapDocument)
         return;
 
-    const bool automatic = touchedLayer != 0;
+    const bool automatic = !touchedLayers.isEmpty();
 
     if (!mLoaded) {
         const QString mapPath = QFileInfo(mMapDocument->fileName()).path();
@@ -90,10 +137,14 @@ void AutomappingManager::autoMapInternal(const QRegion &where,
     QRegion *passedRegion = new QRegion(where);
 
     QVector<AutoMapper*> passedAutoMappers;
-    if (touchedLayer) {
+    if (automatic) {
         foreach (AutoMapper *a, mAutoMappers) {
-            if (a->ruleLayerNameUsed(touchedLayer->name()))
-                passedAutoMappers.append(a);
+            foreach (const QString &layerName, touchedLayers) {
+                if (a->ruleLayerNameUsed(layerName)) {
+                    passedAutoMappers.append(a);
+                    break;
+                }
+            }
         }
     } else {
         passedAutoMappers = mAutoMappers;
@@ -196,11 +247,21 @@ void AutomappingManager::setMapDocument(MapDocument *mapDocument)
     if (mMapDocument)
         mMapDocument->disconnect(this);
 
+    mAutoMapTimer.stop();
+    mEditedRegion = QRegion();
+    mEditedLayers.clear();
+
     mMapDocument = mapDocument;
 
     if (mMapDocument) {
         connect(mMapDocument, SIGNAL(regionEdited(QRegion,Layer*)),
                 this, SLOT(autoMap(QRegion,Layer*)));
+        connect(mMapDocument, SIGNAL(layerAdded(int)),
+                this, SLOT(invalidateCompiledRules()));
+        connect(mMapDocument, SIGNAL(layerRemoved(int)),
+                this, SLOT(invalidateCompiledRules()));
+        connect(mMapDocument, SIGNAL(layerChanged(int)),
+                this, SLOT(invalidateCompiledRules()));
     }
 
     mLoaded = false;
@@ -23,7 +23,9 @@
 
 #include <QObject>
 #include <QRegion>
+#include <QSet>
 #include <QString>
+#include <QTimer>
 #include <QVector>
 
 namespace Tiled {
@@ -38,6 +40,11 @@ class MapDocument;
 /**
  * This class is a superior class to the AutoMapper and AutoMapperWrapper class.
  * It uses these classes to do the whole automapping process.
+ *
+ * When automapping while drawing, the edited regions are collected and
+ * automapped together shortly after, so that a brush stroke does not cause
+ * an automapping pass for every single edit. The AutoMappers and their
+ * compiled rules are kept alive between these passes.
  */
 class AutomappingManager : public QObject
 {
@@ -75,8 +82,23 @@ public slots:
     void autoMap();
 
 private slots:
+    /**
+     * Marks the region \a where of \a touchedLayer as edited, to be
+     * automapped by the next call to autoMapEditedRegion().
+     */
     void autoMap(const QRegion &where, Layer *touchedLayer);
 
+    /**
+     * Applies automapping to all regions edited since the last call.
+     */
+    void autoMapEditedRegion();
+
+    /**
+     * Makes the AutoMappers recompile their rules, after the layers of the
+     * map changed.
+     */
+    void invalidateCompiledRules();
+
 private:
     Q_DISABLE_COPY(AutomappingManager)
 
@@ -93,13 +115,14 @@ private:
     bool loadFile(const QString &filePath);
 
     /**
-     * Applies automapping to the Region \a where, considering only layer
-     * \a touchedLayer has changed.
+     * Applies automapping to the Region \a where, considering only the
+     * layers named in \a touchedLayers have changed.
      * There will only those Automappers be used which have a rule layer
-     * touching the \a touchedLayer
-     * If layer is 0, all Automappers are used.
+     * touching any of the \a touchedLayers.
+     * If no layers are given, all Automappers are used.
      */
-    void autoMapInternal(const QRegion &where, Layer *touchedLayer);
+    void autoMapInternal(const QRegion &where,
+                         const QSet<QString> &touchedLayers);
 
     /**
      * deletes all its data structures
@@ -123,6 +146,18 @@ private:
      */
     bool mLoaded;
 
+    /**
+     * The region edited while automapping while drawing, and the names of
+     * the edited layers, which are waiting to be automapped.
+     */
+    QRegion mEditedRegion;
+    QSet<QString> mEditedLayers;
+
+    /**
+     * Coalesces the automapping of edits made in quick succession.
+     */
+    QTimer mAutoMapTimer;
+
     /**
      * Contains all errors which occurred until canceling.
      * If mError is not empty, no serious result can be expected.
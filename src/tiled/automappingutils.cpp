@@ -31,19 +31,40 @@
 namespace Tiled {
 namespace Internal {
 
+/**
+ * Returns the objects in the given layer that may overlap the region, using
+ * the spatial index of the object group. The aligned rectangles used below
+ * can be up to one pixel larger than the bounds of an object, hence the
+ * margin.
+ */
+static QList<MapObject*> objectsNearRegion(ObjectGroup *layer,
+                                           const QRegion &where)
+{
+    if (where.isEmpty())
+        return QList<MapObject*>();
+
+    const QRectF area = QRectF(where.boundingRect()).adjusted(-1, -1, 1, 1);
+    return layer->objectsIntersecting(area);
+}
+
 void eraseRegionObjectGroup(MapDocument *mapDocument,
                                         ObjectGroup *layer,
                                         const QRegion &where)
 {
-    QUndoStack *undo = mapDocument->undoStack();
+    QList<MapObject*> objectsToRemove;
 
-    foreach (MapObject *obj, layer->objects()) {
+    foreach (MapObject *obj, objectsNearRegion(layer, where)) {
         // TODO: we are checking bounds, which is only correct for rectangles and
         // tile objects. polygons and polylines are not covered correctly by this
         // erase method (we are in fact deleting too many objects)
         // TODO2: toAlignedRect may even break rects.
         if (where.intersects(obj->bounds().toAlignedRect()))
-            undo->push(new RemoveMapObject(mapDocument, obj));
+            objectsToRemove.append(obj);
+    }
+
+    if (!objectsToRemove.isEmpty()) {
+        QUndoStack *undo = mapDocument->undoStack();
+        undo->push(new RemoveMapObjects(mapDocument, objectsToRemove));
     }
 }
 
@@ -63,7 +84,7 @@ const QList<MapObject*> objectsInRegion(ObjectGroup *layer,
                                         const QRegion &where)
 {
     QList<MapObject*> ret;
-    foreach (MapObject *obj, layer->objects()) {
+    foreach (MapObject *obj, objectsNearRegion(layer, where)) {
         // TODO: we are checking bounds, which is only correct for rectangles and
         // tile objects. polygons and polylines are not covered correctly by this
         // erase method (we are in fact deleting too many objects)
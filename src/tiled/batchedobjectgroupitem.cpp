@@ -0,0 +1,264 @@
+/*
+ * batchedobjectgroupitem.cpp
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "batchedobjectgroupitem.h"
+
+#include "mapdocument.h"
+#include "mapobject.h"
+#include "mapobjectitem.h"
+#include "maprenderer.h"
+#include "mapview.h"
+#include "objectgroup.h"
+#include "zoomable.h"
+
+#include <QHash>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+namespace {
+
+/**
+ * Sorts objects by the y coordinate at which they are displayed, which is
+ * the order in which MapObjectItems are stacked in top down draw order.
+ */
+class ScreenYLessThan
+{
+public:
+    explicit ScreenYLessThan(const MapRenderer *renderer)
+        : mRenderer(renderer)
+    {}
+
+    bool operator()(const MapObject *a, const MapObject *b) const
+    {
+        return mRenderer->pixelToScreenCoords(a->position()).y() <
+                mRenderer->pixelToScreenCoords(b->position()).y();
+    }
+
+private:
+    const MapRenderer *mRenderer;
+};
+
+QTransform rotationTransform(const MapRenderer *renderer,
+                             const MapObject *object)
+{
+    const QPointF pos = renderer->pixelToScreenCoords(object->position());
+
+    QTransform transform;
+    transform.translate(pos.x(), pos.y());
+    transform.rotate(object->rotation());
+    transform.translate(-pos.x(), -pos.y());
+    return transform;
+}
+
+} // anonymous namespace
+
+BatchedObjectGroupItem::BatchedObjectGroupItem(ObjectGroup *objectGroup,
+                                               MapDocument *mapDocument)
+    : ObjectGroupItem(objectGroup)
+    , mMapDocument(mapDocument)
+    , mMargin(0)
+{
+    // Unlike the ObjectGroupItem, this item paints the objects itself
+    setFlag(QGraphicsItem::ItemHasNoContents, false);
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+
+    syncWithObjectGroup();
+}
+
+void BatchedObjectGroupItem::syncWithObjectGroup()
+{
+    QRectF bounds;
+    mMargin = 0;
+
+    foreach (const MapObject *object, objectGroup()->objects())
+        bounds |= includeObject(object);
+
+    prepareGeometryChange();
+    mBoundingRect = bounds;
+    update();
+}
+
+void BatchedObjectGroupItem::objectsChanged(const QList<MapObject*> &objects)
+{
+    QRectF bounds = mBoundingRect;
+    bool needsUpdate = false;
+
+    foreach (const MapObject *object, objects) {
+        bounds |= includeObject(object);
+        if (!mObjectsDrawnByItems.contains(object))
+            needsUpdate = true;
+    }
+
+    if (bounds != mBoundingRect) {
+        prepareGeometryChange();
+        mBoundingRect = bounds;
+    }
+
+    // The previous location of the objects is not known, so the whole group
+    // is repainted
+    if (needsUpdate)
+        update();
+}
+
+void BatchedObjectGroupItem::setObjectDrawnByItem(MapObject *object,
+                                                  bool drawnByItem)
+{
+    if (drawnByItem == mObjectsDrawnByItems.contains(object))
+        return;
+
+    if (drawnByItem)
+        mObjectsDrawnByItems.insert(object);
+    else
+        mObjectsDrawnByItems.remove(object);
+
+    update(screenRect(object).adjusted(-mMargin, -mMargin, mMargin, mMargin));
+}
+
+MapObject *BatchedObjectGroupItem::objectAt(const QPointF &pos) const
+{
+    const MapRenderer *renderer = mMapDocument->renderer();
+    const QList<MapObject*> objects = objectsInDrawOrder(QRectF(pos, QSizeF()));
+
+    for (int i = objects.size() - 1; i >= 0; --i) {
+        MapObject *object = objects.at(i);
+        if (!object->isVisible())
+            continue;
+
+        QPainterPath shape = renderer->shape(object);
+        if (object->rotation() != 0)
+            shape = rotationTransform(renderer, object).map(shape);
+
+        if (shape.contains(pos))
+            return object;
+    }
+
+    return 0;
+}
+
+QList<MapObject*> BatchedObjectGroupItem::objectsNear(const QRectF &rect) const
+{
+    QList<MapObject*> objects;
+
+    foreach (MapObject *object, objectsInDrawOrder(rect))
+        if (object->isVisible() && screenRect(object).intersects(rect))
+            objects.append(object);
+
+    return objects;
+}
+
+QRectF BatchedObjectGroupItem::boundingRect() const
+{
+    return mBoundingRect;
+}
+
+void BatchedObjectGroupItem::paint(QPainter *painter,
+                                   const QStyleOptionGraphicsItem *option,
+                                   QWidget *widget)
+{
+    MapRenderer *renderer = mMapDocument->renderer();
+    qreal scale = static_cast<MapView*>(widget->parent())->zoomable()->scale();
+    renderer->setPainterScale(scale);
+
+    // The color of an object only depends on its type and its object group
+    QHash<QString, QColor> colors;
+
+    foreach (const MapObject *object, objectsInDrawOrder(option->exposedRect)) {
+        if (!object->isVisible())
+            continue;
+        if (mObjectsDrawnByItems.contains(object))
+            continue;
+
+        QHash<QString, QColor>::iterator color = colors.find(object->type());
+        if (color == colors.end())
+            color = colors.insert(object->type(),
+                                  MapObjectItem::objectColor(object));
+
+        if (object->rotation() != 0) {
+            painter->save();
+            painter->setTransform(rotationTransform(renderer, object), true);
+            renderer->drawMapObject(painter, object, color.value());
+            painter->restore();
+        } else {
+            renderer->drawMapObject(painter, object, color.value());
+        }
+    }
+}
+
+/**
+ * Returns the area covered by the given \a object, in item coordinates.
+ */
+QRectF BatchedObjectGroupItem::screenRect(const MapObject *object) const
+{
+    const MapRenderer *renderer = mMapDocument->renderer();
+    const QRectF rect = renderer->boundingRect(object);
+
+    if (object->rotation() != 0)
+        return rotationTransform(renderer, object).mapRect(rect);
+
+    return rect;
+}
+
+/**
+ * Returns the area covered by the given \a object and makes sure it will be
+ * found when it is exposed. The objects are looked up by their bounds, so
+ * the margin is extended by the amount the object is drawn outside of its
+ * bounds, for example because of its tile, line width or rotation.
+ */
+QRectF BatchedObjectGroupItem::includeObject(const MapObject *object)
+{
+    const MapRenderer *renderer = mMapDocument->renderer();
+    const QRectF rect = screenRect(object);
+    const QPolygonF bounds(object->boundsWithPolygon());
+    const QRectF boundsRect = renderer->pixelToScreenCoords(bounds).boundingRect();
+
+    mMargin = qMax(mMargin, boundsRect.left() - rect.left());
+    mMargin = qMax(mMargin, boundsRect.top() - rect.top());
+    mMargin = qMax(mMargin, rect.right() - boundsRect.right());
+    mMargin = qMax(mMargin, rect.bottom() - boundsRect.bottom());
+
+    return rect;
+}
+
+/**
+ * Returns the objects that may intersect the given \a rect, in the order in
+ * which they are drawn.
+ */
+QList<MapObject*> BatchedObjectGroupItem::objectsInDrawOrder(const QRectF &rect) const
+{
+    const MapRenderer *renderer = mMapDocument->renderer();
+    const QRectF area = rect.adjusted(-mMargin, -mMargin, mMargin, mMargin);
+
+    QPolygonF pixelArea;
+    pixelArea << renderer->screenToPixelCoords(area.topLeft())
+              << renderer->screenToPixelCoords(area.topRight())
+              << renderer->screenToPixelCoords(area.bottomRight())
+              << renderer->screenToPixelCoords(area.bottomLeft());
+
+    QList<MapObject*> objects =
+            objectGroup()->objectsIntersecting(pixelArea.boundingRect());
+
+    if (objectGroup()->drawOrder() == ObjectGroup::TopDownOrder)
+        qStableSort(objects.begin(), objects.end(), ScreenYLessThan(renderer));
+
+    return objects;
+}
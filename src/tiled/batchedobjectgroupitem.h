@@ -0,0 +1,102 @@
+/*
+ * batchedobjectgroupitem.h
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCHEDOBJECTGROUPITEM_H
+#define BATCHEDOBJECTGROUPITEM_H
+
+#include "objectgroupitem.h"
+
+#include <QList>
+#include <QSet>
+
+namespace Tiled {
+
+class MapObject;
+
+namespace Internal {
+
+class MapDocument;
+
+/**
+ * A graphics item for object groups with a large number of objects. Rather
+ * than having an item for each object, it draws all the objects of the group
+ * itself, only looking at the objects that are exposed.
+ *
+ * The MapScene still creates a MapObjectItem for objects that are selected
+ * or hovered, so that they can be interacted with. Those objects are still
+ * drawn by the group in their draw order, except for the ones being edited,
+ * which are drawn by their own item.
+ */
+class BatchedObjectGroupItem : public ObjectGroupItem
+{
+public:
+    BatchedObjectGroupItem(ObjectGroup *objectGroup, MapDocument *mapDocument);
+
+    /**
+     * Recalculates the bounding rect from all objects. Should be called when
+     * the renderer or the way objects are displayed changed.
+     */
+    void syncWithObjectGroup();
+
+    /**
+     * Should be called when the given objects were added to the object group
+     * or were changed.
+     */
+    void objectsChanged(const QList<MapObject*> &objects);
+
+    /**
+     * Sets whether the given \a object is drawn by its own MapObjectItem
+     * rather than by this item.
+     */
+    void setObjectDrawnByItem(MapObject *object, bool drawnByItem);
+
+    /**
+     * Returns the top-most visible object at the given position, in item
+     * coordinates.
+     */
+    MapObject *objectAt(const QPointF &pos) const;
+
+    /**
+     * Returns the visible objects that may intersect the given rectangle,
+     * in item coordinates.
+     */
+    QList<MapObject*> objectsNear(const QRectF &rect) const;
+
+    // QGraphicsItem
+    QRectF boundingRect() const;
+    void paint(QPainter *painter,
+               const QStyleOptionGraphicsItem *option,
+               QWidget *widget = 0);
+
+private:
+    QRectF screenRect(const MapObject *object) const;
+    QRectF includeObject(const MapObject *object);
+    QList<MapObject*> objectsInDrawOrder(const QRectF &rect) const;
+
+    MapDocument *mMapDocument;
+    QRectF mBoundingRect;
+    qreal mMargin;
+    QSet<const MapObject*> mObjectsDrawnByItems;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // BATCHEDOBJECTGROUPITEM_H
@@ -0,0 +1,61 @@
+/*
+ * batchobjectchanges.cpp
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "batchobjectchanges.h"
+
+#include "mapdocument.h"
+#include "mapobjectmodel.h"
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+BatchObjectChanges::BatchObjectChanges(MapDocument *mapDocument,
+                                       Boundary boundary)
+    : mMapDocument(mapDocument)
+    , mBoundary(boundary)
+{
+}
+
+void BatchObjectChanges::undo()
+{
+    // Undo runs through the macro in reverse, so the boundaries swap roles
+    if (mBoundary == Begin)
+        end();
+    else
+        begin();
+}
+
+void BatchObjectChanges::redo()
+{
+    if (mBoundary == Begin)
+        begin();
+    else
+        end();
+}
+
+void BatchObjectChanges::begin()
+{
+    mMapDocument->mapObjectModel()->beginChangeObjects();
+}
+
+void BatchObjectChanges::end()
+{
+    mMapDocument->mapObjectModel()->endChangeObjects();
+}
@@ -0,0 +1,62 @@
+/*
+ * batchobjectchanges.h
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCHOBJECTCHANGES_H
+#define BATCHOBJECTCHANGES_H
+
+#include <QUndoCommand>
+
+namespace Tiled {
+namespace Internal {
+
+class MapDocument;
+
+/**
+ * Marks the beginning or the end of a batch of object changes within an undo
+ * macro. Push a Begin command as the first and an End command as the last
+ * command of the macro, so that the MapObjectModel only notifies about the
+ * changed objects once, when the macro is pushed as well as when it is undone
+ * or redone.
+ */
+class BatchObjectChanges : public QUndoCommand
+{
+public:
+    enum Boundary {
+        Begin,
+        End
+    };
+
+    BatchObjectChanges(MapDocument *mapDocument, Boundary boundary);
+
+    void undo();
+    void redo();
+
+private:
+    void begin();
+    void end();
+
+    MapDocument *mMapDocument;
+    Boundary mBoundary;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // BATCHOBJECTCHANGES_H
@@ -172,7 +172,6 @@ void ClipboardManager::pasteObjectGroup(const ObjectGroup *objectGroup,
     QList<MapObject*> pastedObjects;
     pastedObjects.reserve(objectGroup->objectCount());
 
-    undoStack->beginMacro(tr("Paste Objects"));
     foreach (const MapObject *mapObject, objectGroup->objects()) {
         if (mode == NoTileObjects && !mapObject->cell().isEmpty())
             continue;
@@ -180,11 +179,15 @@ void ClipboardManager::pasteObjectGroup(const ObjectGroup *objectGroup,
         MapObject *objectClone = mapObject->clone();
         objectClone->setPosition(objectClone->position() + offset);
         pastedObjects.append(objectClone);
-        undoStack->push(new AddMapObject(mapDocument,
-                                         currentObjectGroup,
-                                         objectClone));
     }
-    undoStack->endMacro();
+
+    if (!pastedObjects.isEmpty()) {
+        AddMapObjects *command = new AddMapObjects(mapDocument,
+                                                   currentObjectGroup,
+                                                   pastedObjects);
+        command->setText(tr("Paste Objects"));
+        undoStack->push(command);
+    }
 
     mapDocument->setSelectedObjects(pastedObjects);
 }
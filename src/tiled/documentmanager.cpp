@@ -25,6 +25,7 @@
 #include "filesystemwatcher.h"
 #include "map.h"
 #include "mapdocument.h"
+#include "maploader.h"
 #include "maprenderer.h"
 #include "mapscene.h"
 #include "mapview.h"
@@ -34,7 +35,9 @@
 #include "zoomable.h"
 
 #include <QUndoGroup>
+#include <QUndoStack>
 #include <QFileInfo>
+#include <QMessageBox>
 
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -306,6 +309,16 @@ void DocumentManager::closeDocumentAt(int index)
     if (!mapDocument->fileName().isEmpty())
         mFileSystemWatcher->removePath(mapDocument->fileName());
 
+    // Stop reloading this document in the background
+    QMutableHashIterator<MapLoader*, MapDocument*> it(mReloaders);
+    while (it.hasNext()) {
+        if (it.next().value() == mapDocument) {
+            it.key()->cancel();
+            mOutdatedReloaders.remove(it.key());
+            it.remove();
+        }
+    }
+
     delete mapDocument;
 }
 
@@ -331,6 +344,24 @@ bool DocumentManager::reloadDocumentAt(int index)
             reader = qobject_cast<MapReaderInterface*>(plugin->instance);
     }
 
+    if (!reader && MapLoader::supportsFile(oldDocument->fileName())) {
+        // Already being reloaded
+        if (mReloaders.key(oldDocument))
+            return true;
+
+        MapLoader *loader = new MapLoader(oldDocument->fileName(), this);
+        loader->showProgressDialog(mTabWidget);
+        connect(loader, SIGNAL(finished()), SLOT(reloadFinished()));
+
+        // The user may keep editing the map while it is being reloaded
+        connect(oldDocument->undoStack(), SIGNAL(indexChanged(int)),
+                SLOT(documentChangedWhileReloading()));
+
+        mReloaders.insert(loader, oldDocument);
+        loader->start();
+        return true;
+    }
+
     QString error;
     MapDocument *newDocument = MapDocument::load(oldDocument->fileName(),
                                                  reader, &error);
@@ -339,6 +370,81 @@ bool DocumentManager::reloadDocumentAt(int index)
         return false;
     }
 
+    replaceDocument(index, newDocument);
+    return true;
+}
+
+void DocumentManager::reloadFinished()
+{
+    MapLoader *loader = static_cast<MapLoader*>(sender());
+    loader->deleteLater();
+
+    // Not found when the document was closed in the meantime
+    MapDocument *oldDocument = mReloaders.take(loader);
+    const bool outdated = mOutdatedReloaders.remove(loader);
+    int index = mDocuments.indexOf(oldDocument);
+    if (index == -1)
+        return;
+
+    disconnect(oldDocument->undoStack(), SIGNAL(indexChanged(int)),
+               this, SLOT(documentChangedWhileReloading()));
+
+    if (loader->isCanceled())
+        return;
+
+    if (outdated) {
+        const QMessageBox::StandardButton answer =
+                QMessageBox::question(mTabWidget->window(),
+                                      tr("Map Changed"),
+                                      tr("The map \"%1\" was changed while it "
+                                         "was being reloaded. Discard these "
+                                         "changes and show the reloaded map?")
+                                      .arg(QFileInfo(oldDocument->fileName())
+                                           .fileName()),
+                                      QMessageBox::Discard | QMessageBox::Cancel,
+                                      QMessageBox::Cancel);
+        if (answer != QMessageBox::Discard)
+            return;
+
+        // The document may have been closed while asking
+        index = mDocuments.indexOf(oldDocument);
+        if (index == -1)
+            return;
+    }
+
+    Map *map = loader->takeMap();
+    if (!map) {
+        emit reloadError(tr("%1:\n\n%2").arg(oldDocument->fileName(),
+                                              loader->errorString()));
+        return;
+    }
+
+    replaceDocument(index, new MapDocument(map, oldDocument->fileName()));
+}
+
+/**
+ * Marks the reload of the document whose undo stack changed as outdated, so
+ * that its changes are not discarded without asking.
+ */
+void DocumentManager::documentChangedWhileReloading()
+{
+    QUndoStack *undoStack = static_cast<QUndoStack*>(sender());
+
+    QHashIterator<MapLoader*, MapDocument*> it(mReloaders);
+    while (it.hasNext()) {
+        if (it.next().value()->undoStack() == undoStack)
+            mOutdatedReloaders.insert(it.key());
+    }
+}
+
+/**
+ * Replaces the document at \a index with \a newDocument, keeping the view
+ * state.
+ */
+void DocumentManager::replaceDocument(int index, MapDocument *newDocument)
+{
+    MapDocument *oldDocument = mDocuments.at(index);
+
     // Remember current view state
     MapView *mapView = viewForDocument(oldDocument);
     const int layerIndex = oldDocument->currentLayerIndex();
@@ -358,8 +464,6 @@ bool DocumentManager::reloadDocumentAt(int index)
     mapView->verticalScrollBar()->setSliderPosition(verticalPosition);
     if (layerIndex > 0 && layerIndex < newDocument->map()->layerCount())
         newDocument->setCurrentLayerIndex(layerIndex);
-
-    return true;
 }
 
 void DocumentManager::closeAllDocuments()
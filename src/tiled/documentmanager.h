@@ -22,7 +22,9 @@
 #ifndef DOCUMENT_MANAGER_H
 #define DOCUMENT_MANAGER_H
 
+#include <QHash>
 #include <QList>
+#include <QSet>
 #include <QObject>
 #include <QPair>
 #include <QPointF>
@@ -38,6 +40,7 @@ namespace Internal {
 class AbstractTool;
 class FileSystemWatcher;
 class MapDocument;
+class MapLoader;
 class MapScene;
 class MapView;
 class MovableTabWidget;
@@ -135,7 +138,12 @@ public:
      * history and current selections. Will not ask the user whether to save
      * any changes!
      *
-     * Returns whether the map loaded successfully.
+     * When possible, the map is loaded in the background, in which case the
+     * document is replaced once loading finished and errors are reported
+     * through reloadError(). When the document is changed while it is being
+     * reloaded, the user is asked whether to discard those changes.
+     *
+     * Returns whether the map loaded successfully or is being loaded.
      */
     bool reloadDocumentAt(int index);
 
@@ -194,11 +202,15 @@ private slots:
     void fileChanged(const QString &fileName);
 
     void reloadRequested();
+    void reloadFinished();
+    void documentChangedWhileReloading();
 
 private:
     DocumentManager(QObject *parent = 0);
     ~DocumentManager();
 
+    void replaceDocument(int index, MapDocument *newDocument);
+
     QList<MapDocument*> mDocuments;
 
     MovableTabWidget *mTabWidget;
@@ -206,6 +218,8 @@ private:
     AbstractTool *mSelectedTool;
     MapScene *mSceneWithTool;
     FileSystemWatcher *mFileSystemWatcher;
+    QHash<MapLoader*, MapDocument*> mReloaders;
+    QSet<MapLoader*> mOutdatedReloaders;
 
     static DocumentManager *mInstance;
 };
@@ -439,6 +439,8 @@ void EditPolygonTool::updateSelection(QGraphicsSceneMouseEvent *event)
         // Allow selecting some map objects only when there aren't any selected
         QSet<MapObjectItem*> selectedItems;
 
+        mapScene()->createObjectItems(rect);
+
         foreach (QGraphicsItem *item, mapScene()->items(rect,
                                                         Qt::IntersectsItemShape,
                                                         Qt::DescendingOrder,
@@ -458,6 +460,7 @@ void EditPolygonTool::updateSelection(QGraphicsSceneMouseEvent *event)
         }
 
         mapScene()->setSelectedObjectItems(newSelection);
+        mapScene()->releaseObjectItems();
         updateHandles();
     } else {
         // Update the selected handles
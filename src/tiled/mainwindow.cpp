@@ -51,6 +51,7 @@
 #include "map.h"
 #include "mapdocument.h"
 #include "mapdocumentactionhandler.h"
+#include "maploader.h"
 #include "mapobject.h"
 #include "maprenderer.h"
 #include "mapsdock.h"
@@ -71,6 +72,7 @@
 #include "stampbrush.h"
 #include "terrainbrush.h"
 #include "tilelayer.h"
+#include "tilelayeritem.h"
 #include "tileselectiontool.h"
 #include "tileset.h"
 #include "tilesetdock.h"
@@ -98,6 +100,7 @@
 #include <QCloseEvent>
 #include <QComboBox>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QMessageBox>
 #include <QScrollBar>
 #include <QSessionManager>
@@ -513,6 +516,7 @@ MainWindow::~MainWindow()
 
     delete mQuickStampManager;
 
+    TileLayerItem::deleteChunkCache();
     TilesetManager::deleteInstance();
     DocumentManager::deleteInstance();
     Preferences::deleteInstance();
@@ -620,9 +624,61 @@ bool MainWindow::openFile(const QString &fileName,
 
 bool MainWindow::openFile(const QString &fileName)
 {
+    if (fileName.isEmpty())
+        return false;
+
+    if (mDocumentManager->findDocument(fileName) == -1
+            && MapLoader::supportsFile(fileName)) {
+        loadMapInBackground(fileName);
+        return true;
+    }
+
     return openFile(fileName, 0);
 }
 
+void MainWindow::loadMapInBackground(const QString &fileName)
+{
+    // Don't load the same file twice at the same time
+    foreach (MapLoader *loader, mMapLoaders)
+        if (loader->fileName() == fileName)
+            return;
+
+    MapLoader *loader = new MapLoader(fileName, this);
+    loader->showProgressDialog(this);
+    connect(loader, SIGNAL(finished()), SLOT(mapLoaded()));
+
+    mMapLoaders.append(loader);
+    loader->start();
+}
+
+void MainWindow::mapLoaded()
+{
+    MapLoader *loader = static_cast<MapLoader*>(sender());
+    mMapLoaders.removeOne(loader);
+    loader->deleteLater();
+
+    if (loader->isCanceled())
+        return;
+
+    // The file may have been opened in the meantime
+    const QString &fileName = loader->fileName();
+    int documentIndex = mDocumentManager->findDocument(fileName);
+    if (documentIndex != -1) {
+        mDocumentManager->switchToDocument(documentIndex);
+        return;
+    }
+
+    Map *map = loader->takeMap();
+    if (!map) {
+        QMessageBox::critical(this, tr("Error Opening Map"),
+                              loader->errorString());
+        return;
+    }
+
+    mDocumentManager->addDocument(new MapDocument(map, fileName));
+    setRecentFile(fileName);
+}
+
 void MainWindow::openLastFiles()
 {
     mSettings.beginGroup(QLatin1String("recentFiles"));
@@ -661,7 +717,8 @@ void MainWindow::openLastFiles()
         if (!(i < selectedLayer.size()))
             continue;
 
-        if (openFile(lastOpenFiles.at(i))) {
+        // Opened synchronously, since the view is restored right away
+        if (openFile(lastOpenFiles.at(i), 0)) {
             MapView *mapView = mDocumentManager->currentMapView();
 
             // Restore camera to the previous position
@@ -724,8 +781,12 @@ void MainWindow::openFile()
     }
 
     mSettings.setValue(QLatin1String("lastUsedOpenFilter"), selectedFilter);
-    foreach (const QString &fileName, fileNames)
-        openFile(fileName, mapReader);
+    foreach (const QString &fileName, fileNames) {
+        if (mapReader)
+            openFile(fileName, mapReader);
+        else
+            openFile(fileName);
+    }
 }
 
 bool MainWindow::saveFile(const QString &fileName)
@@ -1032,8 +1093,7 @@ void MainWindow::cut()
     if (tileLayer && !selectedArea.isEmpty()) {
         stack->push(new EraseTiles(mMapDocument, tileLayer, selectedArea));
     } else if (!selectedObjects.isEmpty()) {
-        foreach (MapObject *mapObject, selectedObjects)
-            stack->push(new RemoveMapObject(mMapDocument, mapObject));
+        stack->push(new RemoveMapObjects(mMapDocument, selectedObjects));
     }
 
     mActionHandler->selectNone();
@@ -1108,8 +1168,7 @@ void MainWindow::delete_()
     if (tileLayer && !selectedArea.isEmpty()) {
         undoStack->push(new EraseTiles(mMapDocument, tileLayer, selectedArea));
     } else if (!selectedObjects.isEmpty()) {
-        foreach (MapObject *mapObject, selectedObjects)
-            undoStack->push(new RemoveMapObject(mMapDocument, mapObject));
+        undoStack->push(new RemoveMapObjects(mMapDocument, selectedObjects));
     }
 
     mActionHandler->selectNone();
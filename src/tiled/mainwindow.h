@@ -52,6 +52,7 @@ class BucketFillTool;
 class CommandButton;
 class DocumentManager;
 class LayerDock;
+class MapLoader;
 class MapDocumentActionHandler;
 class MapScene;
 class MapsDock;
@@ -103,6 +104,13 @@ public:
     void openLastFiles();
 
 public slots:
+    /**
+     * Opens the given file. When possible, the map is loaded in the
+     * background while a progress dialog is shown, in which case this
+     * function returns before the map has been opened.
+     *
+     * @return whether the file was opened or is being loaded
+     */
     bool openFile(const QString &fileName);
 
 protected:
@@ -175,6 +183,8 @@ public slots:
     void onAnimationEditorClosed();
     void onCollisionEditorClosed();
 
+    void mapLoaded();
+
 private:
     /**
       * Asks the user whether the given \a mapDocument should be saved, when
@@ -246,7 +256,10 @@ private:
     QAction *mShowTileAnimationEditor;
     QAction *mShowTileCollisionEditor;
 
+    QList<MapLoader*> mMapLoaders;
+
     void setupQuickStamps();
+    void loadMapInBackground(const QString &fileName);
 
     AutomappingManager *mAutomappingManager;
     DocumentManager *mDocumentManager;
@@ -24,6 +24,7 @@
 #include "addremovelayer.h"
 #include "addremovemapobject.h"
 #include "addremovetileset.h"
+#include "batchobjectchanges.h"
 #include "changeproperties.h"
 #include "changeselectedarea.h"
 #include "flipmapobjects.h"
@@ -56,6 +57,7 @@
 #include "tmxmapwriter.h"
 
 #include <QFileInfo>
+#include <QHash>
 #include <QRect>
 #include <QUndoStack>
 
@@ -92,13 +94,11 @@ MapDocument::MapDocument(Map *map, const QString &fileName):
             SIGNAL(objectsChanged(QList<MapObject*>)));
     connect(mMapObjectModel, SIGNAL(objectsRemoved(QList<MapObject*>)),
             SLOT(onObjectsRemoved(QList<MapObject*>)));
+    connect(mMapObjectModel, SIGNAL(objectsIndexChanged(ObjectGroup*,int,int)),
+            SIGNAL(objectsIndexChanged(ObjectGroup*,int,int)));
 
     connect(mMapObjectModel, SIGNAL(rowsInserted(QModelIndex,int,int)),
             SLOT(onMapObjectModelRowsInserted(QModelIndex,int,int)));
-    connect(mMapObjectModel, SIGNAL(rowsRemoved(QModelIndex,int,int)),
-            SLOT(onMapObjectModelRowsInsertedOrRemoved(QModelIndex,int,int)));
-    connect(mMapObjectModel, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)),
-            SLOT(onObjectsMoved(QModelIndex,int,int,QModelIndex,int)));
 
     connect(mTerrainModel, SIGNAL(terrainRemoved(Terrain*)),
             SLOT(onTerrainRemoved(Terrain*)));
@@ -319,15 +319,18 @@ void MapDocument::resizeMap(const QSize &size, const QPoint &offset)
             ObjectGroup *objectGroup = static_cast<ObjectGroup*>(layer);
 
             // Remove objects that will fall outside of the map
+            QList<MapObject*> objectsToRemove;
             foreach (MapObject *o, objectGroup->objects()) {
                 if (!visibleIn(visibleArea, o, mRenderer)) {
-                    mUndoStack->push(new RemoveMapObject(this, o));
+                    objectsToRemove.append(o);
                 } else {
                     QPointF oldPos = o->position();
                     o->setPosition(oldPos + pixelOffset);
                     mUndoStack->push(new MoveMapObject(this, o, oldPos));
                 }
             }
+            if (!objectsToRemove.isEmpty())
+                mUndoStack->push(new RemoveMapObjects(this, objectsToRemove));
             break;
         }
         case Layer::ImageLayerType:
@@ -385,6 +388,7 @@ void MapDocument::rotateSelectedObjects(RotateDirection direction)
 
     mUndoStack->beginMacro(tr("Rotate %n Object(s)", "",
                               mSelectedObjects.size()));
+    mUndoStack->push(new BatchObjectChanges(this, BatchObjectChanges::Begin));
 
     // TODO: Rotate them properly as a group
     foreach (MapObject *mapObject, mSelectedObjects) {
@@ -404,6 +408,7 @@ void MapDocument::rotateSelectedObjects(RotateDirection direction)
         mapObject->setRotation(newRotation);
         mUndoStack->push(new RotateMapObject(this, mapObject, oldRotation));
     }
+    mUndoStack->push(new BatchObjectChanges(this, BatchObjectChanges::End));
     mUndoStack->endMacro();
 }
 
@@ -718,37 +723,6 @@ void MapDocument::onMapObjectModelRowsInserted(const QModelIndex &parent,
         return;
 
     emit objectsInserted(objectGroup, first, last);
-    onMapObjectModelRowsInsertedOrRemoved(parent, first, last);
-}
-
-void MapDocument::onMapObjectModelRowsInsertedOrRemoved(const QModelIndex &parent,
-                                                        int first, int last)
-{
-    Q_UNUSED(first)
-
-    ObjectGroup *objectGroup = mMapObjectModel->toObjectGroup(parent);
-    if (!objectGroup)
-        return;
-
-    // Inserting or removing objects changes the index of any that come after
-    const int lastIndex = objectGroup->objectCount() - 1;
-    if (last < lastIndex)
-        emit objectsIndexChanged(objectGroup, last + 1, lastIndex);
-}
-
-void MapDocument::onObjectsMoved(const QModelIndex &parent, int start, int end,
-                                 const QModelIndex &destination, int row)
-{
-    if (parent != destination)
-        return;
-
-    ObjectGroup *objectGroup = mMapObjectModel->toObjectGroup(parent);
-
-    // Determine the full range over which object indexes changed
-    const int first = qMin(start, row);
-    const int last = qMax(end, row - 1);
-
-    emit objectsIndexChanged(objectGroup, first, last);
 }
 
 void MapDocument::onLayerAdded(int index)
@@ -836,15 +810,24 @@ void MapDocument::duplicateObjects(const QList<MapObject *> &objects)
 
     mUndoStack->beginMacro(tr("Duplicate %n Object(s)", "", objects.size()));
 
+    // Add the clones to the object group of their original in one go
+    QList<ObjectGroup*> objectGroups;
+    QHash<ObjectGroup*, QList<MapObject*> > clonesByGroup;
     QList<MapObject*> clones;
     foreach (const MapObject *mapObject, objects) {
+        ObjectGroup *objectGroup = mapObject->objectGroup();
+        if (!clonesByGroup.contains(objectGroup))
+            objectGroups.append(objectGroup);
+
         MapObject *clone = mapObject->clone();
         clones.append(clone);
-        mUndoStack->push(new AddMapObject(this,
-                                          mapObject->objectGroup(),
-                                          clone));
+        clonesByGroup[objectGroup].append(clone);
     }
 
+    foreach (ObjectGroup *objectGroup, objectGroups)
+        mUndoStack->push(new AddMapObjects(this, objectGroup,
+                                           clonesByGroup.value(objectGroup)));
+
     mUndoStack->endMacro();
     setSelectedObjects(clones);
 }
@@ -854,10 +837,7 @@ void MapDocument::removeObjects(const QList<MapObject *> &objects)
     if (objects.isEmpty())
         return;
 
-    mUndoStack->beginMacro(tr("Remove %n Object(s)", "", objects.size()));
-    foreach (MapObject *mapObject, objects)
-        mUndoStack->push(new RemoveMapObject(this, mapObject));
-    mUndoStack->endMacro();
+    mUndoStack->push(new RemoveMapObjects(this, objects));
 }
 
 void MapDocument::moveObjectsToGroup(const QList<MapObject *> &objects,
@@ -866,18 +846,15 @@ void MapDocument::moveObjectsToGroup(const QList<MapObject *> &objects,
     if (objects.isEmpty())
         return;
 
-    mUndoStack->beginMacro(tr("Move %n Object(s) to Layer", "",
-                              objects.size()));
-
-    foreach (MapObject *mapObject, objects) {
-        if (mapObject->objectGroup() == objectGroup)
-            continue;
+    QList<MapObject*> objectsToMove;
+    foreach (MapObject *mapObject, objects)
+        if (mapObject->objectGroup() != objectGroup)
+            objectsToMove.append(mapObject);
 
-        mUndoStack->push(new MoveMapObjectToGroup(this,
-                                                  mapObject,
-                                                  objectGroup));
-    }
-    mUndoStack->endMacro();
+    if (!objectsToMove.isEmpty())
+        mUndoStack->push(new MoveMapObjectsToGroup(this,
+                                                   objectsToMove,
+                                                   objectGroup));
 }
 
 void MapDocument::setProperty(Object *object,
@@ -394,9 +394,6 @@ private slots:
     void onObjectsRemoved(const QList<MapObject*> &objects);
 
     void onMapObjectModelRowsInserted(const QModelIndex &parent, int first, int last);
-    void onMapObjectModelRowsInsertedOrRemoved(const QModelIndex &parent, int first, int last);
-    void onObjectsMoved(const QModelIndex &parent, int start, int end,
-                        const QModelIndex &destination, int row);
 
     void onLayerAdded(int index);
     void onLayerAboutToBeRemoved(int index);
@@ -0,0 +1,213 @@
+/*
+ * maploader.cpp
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "maploader.h"
+
+#include "imagelayer.h"
+#include "map.h"
+#include "mapreader.h"
+#include "threadsupport.h"
+#include "tileset.h"
+#include "tilesetmanager.h"
+#include "tmxmapreader.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QProgressDialog>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+namespace Tiled {
+namespace Internal {
+
+/**
+ * A file that reports to the map loader how much of it has been read, and
+ * that stops providing data once loading has been canceled.
+ */
+class ProgressFile : public QFile
+{
+public:
+    ProgressFile(const QString &fileName, MapLoader *loader)
+        : QFile(fileName)
+        , mLoader(loader)
+    {}
+
+protected:
+    qint64 readData(char *data, qint64 maxSize)
+    {
+        if (mLoader->isCanceled())
+            return -1;
+
+        const qint64 result = QFile::readData(data, maxSize);
+        if (size() > 0)
+            mLoader->setProgress(int(pos() * 100 / size()));
+        return result;
+    }
+
+private:
+    MapLoader *mLoader;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+namespace {
+
+class BackgroundMapReader : public MapReader
+{
+protected:
+    /**
+     * Overridden to make sure the resolved reference is a clean path, so
+     * that it can be compared to the file names of loaded tilesets.
+     */
+    QString resolveReference(const QString &reference, const QString &mapPath)
+    {
+        QString resolved = MapReader::resolveReference(reference, mapPath);
+        return QDir::cleanPath(resolved);
+    }
+};
+
+void deleteMap(Map *map)
+{
+    qDeleteAll(map->tilesets());
+    delete map;
+}
+
+} // anonymous namespace
+
+MapLoader::MapLoader(const QString &fileName, QObject *parent)
+    : QThread(parent)
+    , mFileName(fileName)
+    , mMap(0)
+    , mCanceled(0)
+    , mProgress(-1)
+{
+}
+
+MapLoader::~MapLoader()
+{
+    cancel();
+    wait();
+
+    // The tilesets of a map that was not taken are not shared with anything
+    if (mMap)
+        deleteMap(mMap);
+}
+
+bool MapLoader::supportsFile(const QString &fileName)
+{
+    TmxMapReader reader;
+    return reader.supportsFile(fileName) && canUsePixmapsInThreads();
+}
+
+void MapLoader::showProgressDialog(QWidget *parent)
+{
+    QProgressDialog *progressDialog =
+            new QProgressDialog(tr("Loading %1...")
+                                .arg(QFileInfo(mFileName).fileName()),
+                                tr("Cancel"), 0, 100, parent);
+    progressDialog->setWindowTitle(tr("Opening Map"));
+    progressDialog->setMinimumDuration(500);
+    progressDialog->setAutoClose(false);
+    progressDialog->setAutoReset(false);
+
+    connect(progressDialog, SIGNAL(canceled()), SLOT(cancel()));
+    connect(this, SIGNAL(progressChanged(int)),
+            progressDialog, SLOT(setValue(int)));
+    connect(this, SIGNAL(finished()), progressDialog, SLOT(deleteLater()));
+    connect(this, SIGNAL(destroyed()), progressDialog, SLOT(deleteLater()));
+}
+
+Map *MapLoader::takeMap()
+{
+    Map *map = mMap;
+    mMap = 0;
+
+    if (!map)
+        return 0;
+
+    // Share the tilesets that are already loaded, like the TmxMapReader does
+    TilesetManager *tilesetManager = TilesetManager::instance();
+    foreach (Tileset *tileset, map->tilesets()) {
+        if (tileset->fileName().isEmpty())
+            continue;
+
+        Tileset *loaded = tilesetManager->findTileset(tileset->fileName());
+        if (loaded && loaded->tileCount() >= tileset->tileCount()) {
+            map->replaceTileset(tileset, loaded);
+            delete tileset;
+        }
+    }
+
+    // Convert the images to pixmaps, now that we're on the GUI thread
+    foreach (Tileset *tileset, map->tilesets())
+        tileset->updateAtlas();
+    foreach (Layer *layer, map->layers())
+        if (ImageLayer *imageLayer = layer->asImageLayer())
+            imageLayer->image();
+
+    return map;
+}
+
+bool MapLoader::isCanceled() const
+{
+    return const_cast<QAtomicInt&>(mCanceled).fetchAndAddRelaxed(0) != 0;
+}
+
+void MapLoader::cancel()
+{
+    mCanceled.fetchAndStoreRelaxed(1);
+}
+
+void MapLoader::run()
+{
+    ProgressFile file(mFileName, this);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        mError = tr("Could not open file for reading.");
+        return;
+    }
+
+    BackgroundMapReader reader;
+    Map *map = reader.readMap(&file, QFileInfo(mFileName).absolutePath());
+
+    if (isCanceled()) {
+        if (map)
+            deleteMap(map);
+        return;
+    }
+
+    if (!map)
+        mError = reader.errorString();
+
+    mMap = map;
+    setProgress(100);
+}
+
+void MapLoader::setProgress(int percentage)
+{
+    // Only called from the loading thread
+    if (percentage == mProgress)
+        return;
+
+    mProgress = percentage;
+    emit progressChanged(percentage);
+}
@@ -0,0 +1,112 @@
+/*
+ * maploader.h
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MAPLOADER_H
+#define MAPLOADER_H
+
+#include <QAtomicInt>
+#include <QString>
+#include <QThread>
+
+class QWidget;
+
+namespace Tiled {
+
+class Map;
+
+namespace Internal {
+
+/**
+ * Loads a TMX map in a background thread, so that the user interface stays
+ * responsive while the map is parsed, its layer data is decoded and its
+ * images are decoded.
+ *
+ * The loading thread reads its own copy of any external tilesets and keeps
+ * all images as QImage. When the map is taken with takeMap() on the GUI
+ * thread, tilesets that were already loaded are shared with the new map and
+ * the images are converted to pixmaps.
+ */
+class MapLoader : public QThread
+{
+    Q_OBJECT
+
+public:
+    MapLoader(const QString &fileName, QObject *parent = 0);
+    ~MapLoader();
+
+    /**
+     * Returns whether the given file can be loaded in the background.
+     */
+    static bool supportsFile(const QString &fileName);
+
+    const QString &fileName() const { return mFileName; }
+
+    /**
+     * Shows a progress dialog with a Cancel button while loading, when
+     * loading takes a while. The dialog is removed once loading finished.
+     */
+    void showProgressDialog(QWidget *parent);
+
+    /**
+     * Returns the loaded map and passes its ownership to the caller, or
+     * returns 0 when loading failed or was canceled. Needs to be called from
+     * the GUI thread after loading finished.
+     */
+    Map *takeMap();
+
+    /**
+     * Returns the error message when loading failed.
+     */
+    const QString &errorString() const { return mError; }
+
+    bool isCanceled() const;
+
+public slots:
+    /**
+     * Requests loading to stop. The finished() signal is still emitted, but
+     * no map will be available.
+     */
+    void cancel();
+
+signals:
+    /**
+     * Emitted while loading, with the percentage of the file read so far.
+     */
+    void progressChanged(int percentage);
+
+protected:
+    void run();
+
+private:
+    friend class ProgressFile;
+
+    void setProgress(int percentage);
+
+    QString mFileName;
+    Map *mMap;
+    QString mError;
+    QAtomicInt mCanceled;
+    int mProgress;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // MAPLOADER_H
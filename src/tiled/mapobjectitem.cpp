@@ -192,6 +192,7 @@ MapObjectItem::MapObjectItem(MapObject *object, MapDocument *mapDocument,
     mObject(object),
     mMapDocument(mapDocument),
     mIsEditable(false),
+    mDrawnByGroup(false),
     mSyncing(false),
     mResizeHandle(new ResizeHandle(this))
 {
@@ -287,7 +288,8 @@ void MapObjectItem::paint(QPainter *painter,
     qreal scale = static_cast<MapView*>(widget->parent())->zoomable()->scale();
     painter->translate(-pos());
     mMapDocument->renderer()->setPainterScale(scale);
-    mMapDocument->renderer()->drawMapObject(painter, mObject, mColor);
+    if (!mDrawnByGroup)
+        mMapDocument->renderer()->drawMapObject(painter, mObject, mColor);
 
     if (mIsEditable) {
         painter->translate(pos());
@@ -309,6 +311,15 @@ void MapObjectItem::paint(QPainter *painter,
     }
 }
 
+void MapObjectItem::setDrawnByGroup(bool drawnByGroup)
+{
+    if (mDrawnByGroup == drawnByGroup)
+        return;
+
+    mDrawnByGroup = drawnByGroup;
+    update();
+}
+
 void MapObjectItem::resizeObject(const QSizeF &size)
 {
     // Not using the MapObjectModel because it is also used during object
@@ -74,6 +74,15 @@ public:
     bool isEditable() const
     { return mIsEditable; }
 
+    /**
+     * Sets whether the object itself is drawn by the item of its object group
+     * instead of by this item, in which case this item only draws the outline
+     * shown while the object is editable.
+     *
+     * \sa BatchedObjectGroupItem
+     */
+    void setDrawnByGroup(bool drawnByGroup);
+
     // QGraphicsItem
     QRectF boundingRect() const;
     QPainterPath shape() const;
@@ -118,6 +127,7 @@ private:
     QPolygonF mPolygon; // Copy of the polygon, for the same reason
     QColor mColor;      // Cached color of the object
     bool mIsEditable;
+    bool mDrawnByGroup;
     bool mSyncing;
     ResizeHandle *mResizeHandle;
 
@@ -29,9 +29,13 @@
 #include "renamelayer.h"
 
 #include <QCoreApplication>
+#include <QMap>
 
 #define GROUPS_IN_DISPLAY_ORDER 1
 
+// Above this number of separate row ranges, removing objects resets the model
+static const int MaxRowRanges = 16;
+
 using namespace Tiled;
 using namespace Tiled::Internal;
 
@@ -39,6 +43,7 @@ MapObjectModel::MapObjectModel(QObject *parent):
     QAbstractItemModel(parent),
     mMapDocument(0),
     mMap(0),
+    mChangeObjectsDepth(0),
     mObjectGroupIcon(QLatin1String(":/images/16x16/layer-object.png"))
 {
 }
@@ -222,7 +227,7 @@ QModelIndex MapObjectModel::index(ObjectGroup *og) const
 
 QModelIndex MapObjectModel::index(MapObject *o, int column) const
 {
-    const int row = o->objectGroup()->objects().indexOf(o);
+    const int row = o->objectGroup()->indexOfObject(o);
     Q_ASSERT(mObjects[o]);
     return createIndex(row, column, mObjects[o]);
 }
@@ -271,6 +276,8 @@ void MapObjectModel::setMapDocument(MapDocument *mapDocument)
     mGroups.clear();
     qDeleteAll(mObjects);
     mObjects.clear();
+    mChangedObjects.clear();
+    mChangedColumns.clear();
 
     if (mMapDocument) {
         mMap = mMapDocument->map();
@@ -342,34 +349,159 @@ void MapObjectModel::layerAboutToBeRemoved(int index)
         mObjectGroups.removeAt(row);
         delete mGroups.take(og);
         foreach (MapObject *o, og->objects())
-            delete mObjects.take(o);
+            forgetObject(o);
 
         endRemoveRows();
     }
 }
 
+/**
+ * Returns the ranges of consecutive indexes in the sorted \a rows, as pairs
+ * of the first and last position in \a rows.
+ */
+QList<QPair<int, int> > MapObjectModel::consecutiveRanges(const QList<QPair<int, MapObject*> > &rows)
+{
+    QList<QPair<int, int> > ranges;
+    int first = 0;
+    while (first < rows.size()) {
+        int last = first;
+        while (last + 1 < rows.size() &&
+               rows.at(last + 1).first == rows.at(last).first + 1)
+            ++last;
+
+        ranges.append(qMakePair(first, last));
+        first = last + 1;
+    }
+    return ranges;
+}
+
+/**
+ * Drops the model data kept for the removed object \a o.
+ */
+void MapObjectModel::forgetObject(MapObject *o)
+{
+    delete mObjects.take(o);
+    if (mChangedColumns.remove(o))
+        mChangedObjects.removeOne(o);
+}
+
 void MapObjectModel::insertObject(ObjectGroup *og, int index, MapObject *o)
 {
-    const int row = (index >= 0) ? index : og->objectCount();
-    beginInsertRows(this->index(og), row, row);
-    og->insertObject(row, o);
-    mObjects.insert(o, new ObjectOrGroup(o));
-    endInsertRows();
-    emit objectsAdded(QList<MapObject*>() << o);
+    insertObjects(og, QList<MapObject*>() << o, QList<int>() << index);
 }
 
 int MapObjectModel::removeObject(ObjectGroup *og, MapObject *o)
 {
-    QList<MapObject*> objects;
-    objects << o;
+    return removeObjects(og, QList<MapObject*>() << o).first();
+}
+
+/**
+ * Inserts the given \a objects into the object group \a og, at the given
+ * \a indexes. An index of -1 appends the object. Rows are inserted in ranges
+ * of consecutive indexes and objectsAdded() is emitted once for all objects.
+ */
+void MapObjectModel::insertObjects(ObjectGroup *og,
+                                   const QList<MapObject*> &objects,
+                                   const QList<int> &indexes)
+{
+    Q_ASSERT(objects.size() == indexes.size());
+    if (objects.isEmpty())
+        return;
+
+    QList<QPair<int, MapObject*> > rows;
+    int appendRow = og->objectCount();
+    for (int i = 0; i < objects.size(); ++i) {
+        const int index = indexes.at(i);
+        rows.append(qMakePair(index >= 0 ? index : appendRow++,
+                              objects.at(i)));
+    }
+    qSort(rows);
+
+    const QList<QPair<int, int> > ranges = consecutiveRanges(rows);
+
+    // Always insert range by range, since the scene and the views rely on
+    // rowsInserted() to create the items of the new objects. Ranges are
+    // inserted front to back, so that each object ends up at its index.
+    const QModelIndex parent = index(og);
+    for (int r = 0; r < ranges.size(); ++r) {
+        const int first = ranges.at(r).first;
+        const int last = ranges.at(r).second;
+
+        beginInsertRows(parent, rows.at(first).first, rows.at(last).first);
+        og->insertObjects(rows.mid(first, last - first + 1));
+        for (int i = first; i <= last; ++i) {
+            MapObject *o = rows.at(i).second;
+            mObjects.insert(o, new ObjectOrGroup(o));
+        }
+        endInsertRows();
+    }
+
+    // Inserting objects changes the index of any that come after
+    const int lastIndex = og->objectCount() - 1;
+    if (rows.last().first < lastIndex)
+        emit objectsIndexChanged(og, rows.first().first, lastIndex);
+
+    emit objectsAdded(objects);
+}
+
+/**
+ * Removes the given \a objects from the object group \a og. Rows are removed
+ * in ranges of consecutive indexes, or with a model reset when there are many
+ * ranges, and objectsRemoved() is emitted once for all objects.
+ *
+ * @return the indexes at which the objects were removed, in the order of
+ *         \a objects
+ */
+QList<int> MapObjectModel::removeObjects(ObjectGroup *og,
+                                         const QList<MapObject*> &objects)
+{
+    QList<int> indexes;
+    if (objects.isEmpty())
+        return indexes;
+
+    QList<QPair<int, MapObject*> > rows;
+    indexes.reserve(objects.size());
+    foreach (MapObject *o, objects) {
+        const int index = og->indexOfObject(o);
+        indexes.append(index);
+        rows.append(qMakePair(index, o));
+    }
+    qSort(rows);
+
+    const QList<QPair<int, int> > ranges = consecutiveRanges(rows);
+
+    if (ranges.size() > MaxRowRanges) {
+        beginResetModel();
+        og->removeObjects(objects);
+        foreach (MapObject *o, objects)
+            forgetObject(o);
+        endResetModel();
+    } else {
+        // Remove ranges back to front, to keep the remaining rows valid
+        const QModelIndex parent = index(og);
+        for (int r = ranges.size() - 1; r >= 0; --r) {
+            const int first = ranges.at(r).first;
+            const int last = ranges.at(r).second;
+
+            QList<MapObject*> rangeObjects;
+            for (int i = first; i <= last; ++i)
+                rangeObjects.append(rows.at(i).second);
+
+            beginRemoveRows(parent, rows.at(first).first, rows.at(last).first);
+            og->removeObjects(rangeObjects);
+            foreach (MapObject *o, rangeObjects)
+                forgetObject(o);
+            endRemoveRows();
+        }
+    }
+
+    // Removing objects changes the index of any that come after
+    const int lastIndex = og->objectCount() - 1;
+    if (rows.first().first <= lastIndex)
+        emit objectsIndexChanged(og, rows.first().first, lastIndex);
 
-    const int row = og->objects().indexOf(o);
-    beginRemoveRows(index(og), row, row);
-    og->removeObjectAt(row);
-    delete mObjects.take(o);
-    endRemoveRows();
     emit objectsRemoved(objects);
-    return row;
+    return indexes;
 }
 
 void MapObjectModel::moveObjects(ObjectGroup *og, int from, int to, int count)
@@ -382,59 +514,157 @@ void MapObjectModel::moveObjects(ObjectGroup *og, int from, int to, int count)
 
     og->moveObjects(from, to, count);
     endMoveRows();
+
+    // Determine the full range over which object indexes changed
+    const int first = qMin(from, to);
+    const int last = qMax(from + count - 1, to - 1);
+    emit objectsIndexChanged(og, first, last);
 }
 
 // ObjectGroup color changed
 // FIXME: layerChanged should let the scene know that objects need redrawing
 void MapObjectModel::emitObjectsChanged(const QList<MapObject *> &objects)
 {
+    if (mChangeObjectsDepth == 0) {
+        emit objectsChanged(objects);
+        return;
+    }
+
+    foreach (MapObject *o, objects)
+        objectChanged(o);
+}
+
+/**
+ * Groups the changes made to objects until the matching call to
+ * endChangeObjects(). The changed objects are then reported by a single
+ * objectsChanged() signal and a dataChanged() signal for each range of
+ * changed rows. Calls can be nested.
+ */
+void MapObjectModel::beginChangeObjects()
+{
+    ++mChangeObjectsDepth;
+}
+
+void MapObjectModel::endChangeObjects()
+{
+    Q_ASSERT(mChangeObjectsDepth > 0);
+    if (--mChangeObjectsDepth > 0 || mChangedObjects.isEmpty())
+        return;
+
+    const QList<MapObject*> objects = mChangedObjects;
+    mChangedObjects.clear();
+
+    QList<MapObject*> changedColumns[2];
+    foreach (MapObject *o, objects) {
+        const int columns = mChangedColumns.value(o);
+        if (columns & 1)
+            changedColumns[0].append(o);
+        if (columns & 2)
+            changedColumns[1].append(o);
+    }
+    mChangedColumns.clear();
+
+    emitDataChanged(changedColumns[0], 0);
+    emitDataChanged(changedColumns[1], 1);
+
     emit objectsChanged(objects);
 }
 
 void MapObjectModel::setObjectName(MapObject *o, const QString &name)
 {
     o->setName(name);
-    QModelIndex index = this->index(o);
-    emit dataChanged(index, index);
-    emit objectsChanged(QList<MapObject*>() << o);
+    objectChanged(o, 0);
 }
 
 void MapObjectModel::setObjectType(MapObject *o, const QString &type)
 {
     o->setType(type);
-    QModelIndex index = this->index(o, 1);
-    emit dataChanged(index, index);
-    emit objectsChanged(QList<MapObject*>() << o);
+    objectChanged(o, 1);
 }
 
 void MapObjectModel::setObjectPolygon(MapObject *o, const QPolygonF &polygon)
 {
     o->setPolygon(polygon);
-    emit objectsChanged(QList<MapObject*>() << o);
+    objectChanged(o);
 }
 
 void MapObjectModel::setObjectPosition(MapObject *o, const QPointF &pos)
 {
     o->setPosition(pos);
-    emit objectsChanged(QList<MapObject*>() << o);
+    objectChanged(o);
 }
 
 void MapObjectModel::setObjectSize(MapObject *o, const QSizeF &size)
 {
     o->setSize(size);
-    emit objectsChanged(QList<MapObject*>() << o);
+    objectChanged(o);
 }
 
 void MapObjectModel::setObjectRotation(MapObject *o, qreal rotation)
 {
     o->setRotation(rotation);
-    emit objectsChanged(QList<MapObject*>() << o);
+    objectChanged(o);
 }
 
 void MapObjectModel::setObjectVisible(MapObject *o, bool visible)
 {
     o->setVisible(visible);
-    QModelIndex index = this->index(o);
-    emit dataChanged(index, index);
-    emit objectsChanged(QList<MapObject*>() << o);
+    objectChanged(o, 0);
+}
+
+/**
+ * Reports a change to the given object, or remembers it until the end of the
+ * current group of changes. The \a column is the column of which the data
+ * changed, or -1 when the change is not visible in the model.
+ */
+void MapObjectModel::objectChanged(MapObject *o, int column)
+{
+    if (mChangeObjectsDepth == 0) {
+        if (column != -1) {
+            QModelIndex index = this->index(o, column);
+            emit dataChanged(index, index);
+        }
+        emit objectsChanged(QList<MapObject*>() << o);
+        return;
+    }
+
+    QHash<MapObject*, int>::iterator it = mChangedColumns.find(o);
+    if (it == mChangedColumns.end()) {
+        it = mChangedColumns.insert(o, 0);
+        mChangedObjects.append(o);
+    }
+    if (column != -1)
+        it.value() |= 1 << column;
+}
+
+/**
+ * Emits dataChanged() for the given \a column of the \a objects, once for
+ * each range of consecutive rows.
+ */
+void MapObjectModel::emitDataChanged(const QList<MapObject*> &objects,
+                                     int column)
+{
+    QMap<ObjectGroup*, QList<int> > rowsByGroup;
+    foreach (MapObject *o, objects) {
+        ObjectGroup *og = o->objectGroup();
+        rowsByGroup[og].append(og->indexOfObject(o));
+    }
+
+    QMapIterator<ObjectGroup*, QList<int> > it(rowsByGroup);
+    while (it.hasNext()) {
+        it.next();
+        ObjectGroup *og = it.key();
+        QList<int> rows = it.value();
+        qSort(rows);
+
+        int first = 0;
+        for (int i = 1; i <= rows.size(); ++i) {
+            if (i < rows.size() && rows.at(i) == rows.at(i - 1) + 1)
+                continue;
+
+            emit dataChanged(index(og->objectAt(rows.at(first)), column),
+                             index(og->objectAt(rows.at(i - 1)), column));
+            first = i;
+        }
+    }
 }
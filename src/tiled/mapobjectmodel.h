@@ -22,7 +22,9 @@
 #define MAPOBJECTMODEL_H
 
 #include <QAbstractItemModel>
+#include <QHash>
 #include <QIcon>
+#include <QPair>
 
 namespace Tiled {
 
@@ -91,9 +93,17 @@ public:
 
     void insertObject(ObjectGroup *og, int index, MapObject *o);
     int removeObject(ObjectGroup *og, MapObject *o);
+    void insertObjects(ObjectGroup *og,
+                       const QList<MapObject*> &objects,
+                       const QList<int> &indexes);
+    QList<int> removeObjects(ObjectGroup *og,
+                             const QList<MapObject*> &objects);
     void moveObjects(ObjectGroup *og, int from, int to, int count);
     void emitObjectsChanged(const QList<MapObject *> &objects);
 
+    void beginChangeObjects();
+    void endChangeObjects();
+
     void setObjectName(MapObject *o, const QString &name);
     void setObjectType(MapObject *o, const QString &type);
     void setObjectPolygon(MapObject *o, const QPolygonF &polygon);
@@ -107,17 +117,33 @@ signals:
     void objectsChanged(const QList<MapObject *> &objects);
     void objectsRemoved(const QList<MapObject *> &objects);
 
+    /**
+     * Emitted when the index of the objects in the given range changed, as a
+     * result of objects being inserted, removed or moved.
+     */
+    void objectsIndexChanged(ObjectGroup *objectGroup, int first, int last);
+
 private slots:
     void layerAdded(int index);
     void layerChanged(int index);
     void layerAboutToBeRemoved(int index);
 
 private:
+    static QList<QPair<int, int> > consecutiveRanges(const QList<QPair<int, MapObject*> > &rows);
+    void forgetObject(MapObject *o);
+
+    void objectChanged(MapObject *o, int column = -1);
+    void emitDataChanged(const QList<MapObject*> &objects, int column);
+
     MapDocument *mMapDocument;
     Map *mMap;
     QList<ObjectGroup*> mObjectGroups;
-    QMap<MapObject*, ObjectOrGroup*> mObjects;
-    QMap<ObjectGroup*, ObjectOrGroup*> mGroups;
+    QHash<MapObject*, ObjectOrGroup*> mObjects;
+    QHash<ObjectGroup*, ObjectOrGroup*> mGroups;
+
+    int mChangeObjectsDepth;
+    QList<MapObject*> mChangedObjects;
+    QHash<MapObject*, int> mChangedColumns; // Bit mask of changed columns
 
     QIcon mObjectGroupIcon;
 };
@@ -24,6 +24,7 @@
 #include "mapscene.h"
 
 #include "abstracttool.h"
+#include "batchedobjectgroupitem.h"
 #include "map.h"
 #include "mapdocument.h"
 #include "mapobject.h"
@@ -42,6 +43,7 @@
 #include "tilesetmanager.h"
 
 #include <QGraphicsSceneMouseEvent>
+#include <QHash>
 #include <QPainter>
 #include <QKeyEvent>
 #include <QApplication>
@@ -54,6 +56,9 @@ using namespace Tiled::Internal;
 static const qreal darkeningFactor = 0.6;
 static const qreal opacityFactor = 0.4;
 
+// Object groups with at least this many objects are drawn by a single item
+static const int batchedObjectThreshold = 1000;
+
 MapScene::MapScene(QObject *parent):
     QGraphicsScene(parent),
     mMapDocument(0),
@@ -62,7 +67,8 @@ MapScene::MapScene(QObject *parent):
     mUnderMouse(false),
     mCurrentModifiers(Qt::NoModifier),
     mDarkRectangle(new QGraphicsRectItem),
-    mDefaultBackgroundColor(Qt::darkGray)
+    mDefaultBackgroundColor(Qt::darkGray),
+    mHoveredObject(0)
 {
     setBackgroundBrush(mDefaultBackgroundColor);
 
@@ -70,7 +76,7 @@ MapScene::MapScene(QObject *parent):
     connect(tilesetManager, SIGNAL(tilesetChanged(Tileset*)),
             this, SLOT(tilesetChanged(Tileset*)));
     connect(tilesetManager, SIGNAL(repaintTileset(Tileset*)),
-            this, SLOT(tilesetChanged(Tileset*)));
+            this, SLOT(repaintTileset(Tileset*)));
 
     Preferences *prefs = Preferences::instance();
     connect(prefs, SIGNAL(showGridChanged(bool)), SLOT(setGridVisible(bool)));
@@ -82,6 +88,8 @@ MapScene::MapScene(QObject *parent):
     connect(prefs, SIGNAL(gridColorChanged(QColor)), SLOT(update()));
     connect(prefs, SIGNAL(objectLineWidthChanged(qreal)),
             SLOT(setObjectLineWidth(qreal)));
+    connect(prefs, SIGNAL(levelOfDetailThresholdChanged(qreal)),
+            SLOT(setLevelOfDetailThreshold(qreal)));
 
     mDarkRectangle->setPen(Qt::NoPen);
     mDarkRectangle->setBrush(Qt::black);
@@ -90,6 +98,7 @@ MapScene::MapScene(QObject *parent):
 
     mGridVisible = prefs->showGrid();
     mObjectLineWidth = prefs->objectLineWidth();
+    mLevelOfDetailThreshold = prefs->levelOfDetailThreshold();
     mShowTileObjectOutlines = prefs->showTileObjectOutlines();
     mHighlightCurrentLayer = prefs->highlightCurrentLayer();
 
@@ -119,12 +128,17 @@ void MapScene::setMapDocument(MapDocument *mapDocument)
     if (mMapDocument) {
         MapRenderer *renderer = mMapDocument->renderer();
         renderer->setObjectLineWidth(mObjectLineWidth);
+        renderer->setLevelOfDetailThreshold(mLevelOfDetailThreshold);
         renderer->setFlag(ShowTileObjectOutlines, mShowTileObjectOutlines);
 
         connect(mMapDocument, SIGNAL(mapChanged()),
                 this, SLOT(mapChanged()));
         connect(mMapDocument, SIGNAL(regionChanged(QRegion)),
                 this, SLOT(repaintRegion(QRegion)));
+        connect(mMapDocument, SIGNAL(tilesetChanged(Tileset*)),
+                this, SLOT(tilesetChanged(Tileset*)));
+        connect(mMapDocument, SIGNAL(tileAnimationChanged(Tile*)),
+                this, SLOT(tileAnimationChanged(Tile*)));
         connect(mMapDocument, SIGNAL(tileLayerDrawMarginsChanged(TileLayer*)),
                 this, SLOT(tileLayerDrawMarginsChanged(TileLayer*)));
         connect(mMapDocument, SIGNAL(layerAdded(int)),
@@ -177,6 +191,8 @@ void MapScene::refreshScene()
 {
     mLayerItems.clear();
     mObjectItems.clear();
+    mBatchedObjectItems.clear();
+    mHoveredObject = 0;
 
     removeItem(mDarkRectangle);
     clear();
@@ -222,21 +238,15 @@ QGraphicsItem *MapScene::createLayerItem(Layer *layer)
     if (TileLayer *tl = layer->asTileLayer()) {
         layerItem = new TileLayerItem(tl, mMapDocument);
     } else if (ObjectGroup *og = layer->asObjectGroup()) {
-        const ObjectGroup::DrawOrder drawOrder = og->drawOrder();
-        ObjectGroupItem *ogItem = new ObjectGroupItem(og);
-        int objectIndex = 0;
-        foreach (MapObject *object, og->objects()) {
-            MapObjectItem *item = new MapObjectItem(object, mMapDocument,
-                                                    ogItem);
-            if (drawOrder == ObjectGroup::TopDownOrder)
-                item->setZValue(item->y());
-            else
-                item->setZValue(objectIndex);
-
-            mObjectItems.insert(object, item);
-            ++objectIndex;
+        if (og->objectCount() >= batchedObjectThreshold) {
+            // Items are only created for selected or hovered objects
+            layerItem = new BatchedObjectGroupItem(og, mMapDocument);
+        } else {
+            ObjectGroupItem *ogItem = new ObjectGroupItem(og);
+            for (int i = 0; i < og->objectCount(); ++i)
+                createObjectItem(og->objectAt(i), ogItem, i);
+            layerItem = ogItem;
         }
-        layerItem = ogItem;
     } else if (ImageLayer *il = layer->asImageLayer()) {
         layerItem = new ImageLayerItem(il, mMapDocument);
     }
@@ -247,6 +257,157 @@ QGraphicsItem *MapScene::createLayerItem(Layer *layer)
     return layerItem;
 }
 
+ObjectGroupItem *MapScene::objectGroupItem(ObjectGroup *objectGroup) const
+{
+    foreach (QGraphicsItem *item, mLayerItems) {
+        if (ObjectGroupItem *ogItem = dynamic_cast<ObjectGroupItem*>(item)) {
+            if (ogItem->objectGroup() == objectGroup)
+                return ogItem;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Creates the item for the given \a object, which is at the given \a index
+ * in its object group.
+ */
+MapObjectItem *MapScene::createObjectItem(MapObject *object,
+                                          ObjectGroupItem *ogItem,
+                                          int index)
+{
+    MapObjectItem *item = new MapObjectItem(object, mMapDocument, ogItem);
+    if (object->objectGroup()->drawOrder() == ObjectGroup::TopDownOrder)
+        item->setZValue(item->y());
+    else
+        item->setZValue(index);
+
+    mObjectItems.insert(object, item);
+
+    // Objects in batched groups are drawn by the group in their draw order,
+    // until they become editable
+    if (dynamic_cast<BatchedObjectGroupItem*>(ogItem)) {
+        item->setDrawnByGroup(true);
+        mBatchedObjectItems.insert(item);
+    }
+
+    return item;
+}
+
+/**
+ * Returns the item for the given \a object, creating it when the object is
+ * part of a batched object group.
+ */
+MapObjectItem *MapScene::ensureObjectItem(MapObject *object)
+{
+    if (MapObjectItem *item = itemForObject(object))
+        return item;
+
+    ObjectGroup *objectGroup = object->objectGroup();
+    ObjectGroupItem *ogItem = objectGroupItem(objectGroup);
+    Q_ASSERT(dynamic_cast<BatchedObjectGroupItem*>(ogItem));
+
+    return createObjectItem(object, ogItem,
+                            objectGroup->indexOfObject(object));
+}
+
+/**
+ * Removes the item of an object in a batched object group, which will then
+ * be drawn by the object group item again.
+ */
+void MapScene::releaseObjectItem(MapObjectItem *item)
+{
+    BatchedObjectGroupItem *batchedItem =
+            static_cast<BatchedObjectGroupItem*>(item->parentItem());
+
+    batchedItem->setObjectDrawnByItem(item->mapObject(), false);
+    mBatchedObjectItems.remove(item);
+    mObjectItems.remove(item->mapObject());
+    delete item;
+}
+
+/**
+ * Sets whether the given \a item is editable. Editable objects of batched
+ * object groups are drawn by their own item, so that they show up at their
+ * new location while they are moved.
+ */
+void MapScene::setObjectItemEditable(MapObjectItem *item, bool editable)
+{
+    item->setEditable(editable);
+
+    if (mBatchedObjectItems.contains(item)) {
+        BatchedObjectGroupItem *batchedItem =
+                static_cast<BatchedObjectGroupItem*>(item->parentItem());
+        batchedItem->setObjectDrawnByItem(item->mapObject(), editable);
+        item->setDrawnByGroup(!editable);
+    }
+}
+
+void MapScene::releaseObjectItems()
+{
+    foreach (MapObjectItem *item, mBatchedObjectItems) {
+        if (!mSelectedObjectItems.contains(item) &&
+                item->mapObject() != mHoveredObject)
+            releaseObjectItem(item);
+    }
+}
+
+void MapScene::createObjectItems(const QRectF &rect)
+{
+    foreach (QGraphicsItem *item, mLayerItems) {
+        BatchedObjectGroupItem *batchedItem =
+                dynamic_cast<BatchedObjectGroupItem*>(item);
+        if (!batchedItem || !batchedItem->isVisible())
+            continue;
+
+        const QRectF itemRect = batchedItem->mapRectFromScene(rect);
+        foreach (MapObject *object, batchedItem->objectsNear(itemRect))
+            ensureObjectItem(object);
+    }
+}
+
+/**
+ * Returns the top-most object at the given position that is drawn by a
+ * batched object group item.
+ */
+MapObject *MapScene::batchedObjectAt(const QPointF &scenePos) const
+{
+    for (int i = mLayerItems.size() - 1; i >= 0; --i) {
+        BatchedObjectGroupItem *batchedItem =
+                dynamic_cast<BatchedObjectGroupItem*>(mLayerItems.at(i));
+        if (!batchedItem || !batchedItem->isVisible())
+            continue;
+
+        const QPointF pos = batchedItem->mapFromScene(scenePos);
+        if (MapObject *object = batchedItem->objectAt(pos))
+            return object;
+    }
+    return 0;
+}
+
+/**
+ * Sets the object in a batched object group that is under the mouse. An item
+ * is created for this object, so that the tools can interact with it.
+ */
+void MapScene::setHoveredObject(MapObject *object)
+{
+    if (mHoveredObject == object)
+        return;
+
+    MapObject *previous = mHoveredObject;
+    mHoveredObject = object;
+
+    if (object)
+        ensureObjectItem(object);
+
+    if (previous) {
+        MapObjectItem *item = itemForObject(previous);
+        if (item && mBatchedObjectItems.contains(item) &&
+                !mSelectedObjectItems.contains(item))
+            releaseObjectItem(item);
+    }
+}
+
 void MapScene::updateCurrentLayerHighlight()
 {
     if (!mMapDocument)
@@ -283,6 +444,10 @@ void MapScene::repaintRegion(const QRegion &region)
     const MapRenderer *renderer = mMapDocument->renderer();
     const QMargins margins = mMapDocument->map()->drawMargins();
 
+    foreach (QGraphicsItem *item, mLayerItems)
+        if (TileLayerItem *tli = dynamic_cast<TileLayerItem*>(item))
+            tli->invalidateRegion(region);
+
     foreach (const QRect &r, region.rects()) {
         update(renderer->boundingRect(r).adjusted(-margins.left(),
                                                   -margins.top(),
@@ -331,6 +496,9 @@ void MapScene::currentLayerIndexChanged()
  */
 void MapScene::mapChanged()
 {
+    // The renderer may have been recreated for a different orientation
+    mMapDocument->renderer()->setLevelOfDetailThreshold(mLevelOfDetailThreshold);
+
     const QSize mapSize = mMapDocument->renderer()->mapSize();
     setSceneRect(0, 0, mapSize.width(), mapSize.height());
     mDarkRectangle->setRect(0, 0, mapSize.width(), mapSize.height());
@@ -343,6 +511,10 @@ void MapScene::mapChanged()
     foreach (MapObjectItem *item, mObjectItems)
         item->syncWithMapObject();
 
+    foreach (QGraphicsItem *item, mLayerItems)
+        if (BatchedObjectGroupItem *boi = dynamic_cast<BatchedObjectGroupItem*>(item))
+            boi->syncWithObjectGroup();
+
     const Map *map = mMapDocument->map();
     if (map->backgroundColor().isValid())
         setBackgroundBrush(map->backgroundColor());
@@ -355,8 +527,35 @@ void MapScene::tilesetChanged(Tileset *tileset)
     if (!mMapDocument)
         return;
 
-    if (mMapDocument->map()->tilesets().contains(tileset))
+    if (mMapDocument->map()->tilesets().contains(tileset)) {
+        foreach (QGraphicsItem *item, mLayerItems)
+            if (TileLayerItem *tli = dynamic_cast<TileLayerItem*>(item))
+                tli->tilesetChanged(tileset);
+
         update();
+    }
+}
+
+/**
+ * Repaints the layers showing animated tiles of the given \a tileset.
+ */
+void MapScene::repaintTileset(Tileset *tileset)
+{
+    if (!mMapDocument)
+        return;
+
+    if (mMapDocument->map()->tilesets().contains(tileset)) {
+        foreach (QGraphicsItem *item, mLayerItems)
+            if (TileLayerItem *tli = dynamic_cast<TileLayerItem*>(item))
+                tli->tilesetAnimated(tileset);
+
+        update();
+    }
+}
+
+void MapScene::tileAnimationChanged(Tile *tile)
+{
+    tilesetChanged(tile->tileset());
 }
 
 void MapScene::tileLayerDrawMarginsChanged(TileLayer *tileLayer)
@@ -380,6 +579,22 @@ void MapScene::layerAdded(int index)
 
 void MapScene::layerRemoved(int index)
 {
+    // The items of a batched object group are owned by its layer item
+    QGraphicsItem *layerItem = mLayerItems.at(index);
+    if (dynamic_cast<BatchedObjectGroupItem*>(layerItem)) {
+        foreach (MapObjectItem *item, mBatchedObjectItems) {
+            if (item->parentItem() != layerItem)
+                continue;
+
+            if (item->mapObject() == mHoveredObject)
+                mHoveredObject = 0;
+
+            mSelectedObjectItems.remove(item);
+            mBatchedObjectItems.remove(item);
+            mObjectItems.remove(item->mapObject());
+        }
+    }
+
     delete mLayerItems.at(index);
     mLayerItems.remove(index);
 }
@@ -433,6 +648,7 @@ void MapScene::tilesetTileOffsetChanged(Tileset *tileset)
 {
     update();
 
+    // Also drops the cached chunks of the tile layers
     foreach (QGraphicsItem *item, mLayerItems)
         if (TileLayerItem *tli = dynamic_cast<TileLayerItem*>(item))
             tli->syncWithTileLayer();
@@ -442,6 +658,10 @@ void MapScene::tilesetTileOffsetChanged(Tileset *tileset)
         if (!cell.isEmpty() && cell.tile->tileset() == tileset)
             item->syncWithMapObject();
     }
+
+    foreach (QGraphicsItem *item, mLayerItems)
+        if (BatchedObjectGroupItem *boi = dynamic_cast<BatchedObjectGroupItem*>(item))
+            boi->syncWithObjectGroup();
 }
 
 /**
@@ -449,33 +669,19 @@ void MapScene::tilesetTileOffsetChanged(Tileset *tileset)
  */
 void MapScene::objectsInserted(ObjectGroup *objectGroup, int first, int last)
 {
-    ObjectGroupItem *ogItem = 0;
-
-    // Find the object group item for the object group
-    foreach (QGraphicsItem *item, mLayerItems) {
-        if (ObjectGroupItem *ogi = dynamic_cast<ObjectGroupItem*>(item)) {
-            if (ogi->objectGroup() == objectGroup) {
-                ogItem = ogi;
-                break;
-            }
-        }
-    }
-
+    ObjectGroupItem *ogItem = objectGroupItem(objectGroup);
     Q_ASSERT(ogItem);
 
-    const ObjectGroup::DrawOrder drawOrder = objectGroup->drawOrder();
-
-    for (int i = first; i <= last; ++i) {
-        MapObject *object = objectGroup->objectAt(i);
-
-        MapObjectItem *item = new MapObjectItem(object, mMapDocument, ogItem);
-        if (drawOrder == ObjectGroup::TopDownOrder)
-            item->setZValue(item->y());
-        else
-            item->setZValue(i);
-
-        mObjectItems.insert(object, item);
+    // Batched object groups only create items for selected objects
+    if (BatchedObjectGroupItem *batchedItem =
+            dynamic_cast<BatchedObjectGroupItem*>(ogItem)) {
+        batchedItem->objectsChanged(objectGroup->objects().mid(first,
+                                                               last - first + 1));
+        return;
     }
+
+    for (int i = first; i <= last; ++i)
+        createObjectItem(objectGroup->objectAt(i), ogItem, i);
 }
 
 /**
@@ -483,14 +689,37 @@ void MapScene::objectsInserted(ObjectGroup *objectGroup, int first, int last)
  */
 void MapScene::objectsRemoved(const QList<MapObject*> &objects)
 {
+    bool batchedObjectRemoved = false;
+
     foreach (MapObject *o, objects) {
+        if (o == mHoveredObject)
+            mHoveredObject = 0;
+
         ObjectItems::iterator i = mObjectItems.find(o);
-        Q_ASSERT(i != mObjectItems.end());
+        if (i == mObjectItems.end()) {
+            // Drawn by a batched object group item
+            batchedObjectRemoved = true;
+            continue;
+        }
 
-        mSelectedObjectItems.remove(i.value());
-        delete i.value();
+        MapObjectItem *item = i.value();
+        if (mBatchedObjectItems.remove(item)) {
+            BatchedObjectGroupItem *batchedItem =
+                    static_cast<BatchedObjectGroupItem*>(item->parentItem());
+            batchedItem->setObjectDrawnByItem(o, false);
+            batchedObjectRemoved = true;
+        }
+
+        mSelectedObjectItems.remove(item);
+        delete item;
         mObjectItems.erase(i);
     }
+
+    if (batchedObjectRemoved) {
+        foreach (QGraphicsItem *item, mLayerItems)
+            if (dynamic_cast<BatchedObjectGroupItem*>(item))
+                item->update();
+    }
 }
 
 /**
@@ -498,11 +727,26 @@ void MapScene::objectsRemoved(const QList<MapObject*> &objects)
  */
 void MapScene::objectsChanged(const QList<MapObject*> &objects)
 {
+    QHash<ObjectGroup*, QList<MapObject*> > batchedObjects;
+
     foreach (MapObject *object, objects) {
         MapObjectItem *item = itemForObject(object);
-        Q_ASSERT(item);
+        if (item) {
+            item->syncWithMapObject();
+            if (!mBatchedObjectItems.contains(item))
+                continue;
+        }
 
-        item->syncWithMapObject();
+        batchedObjects[object->objectGroup()].append(object);
+    }
+
+    QHashIterator<ObjectGroup*, QList<MapObject*> > it(batchedObjects);
+    while (it.hasNext()) {
+        it.next();
+        ObjectGroupItem *ogItem = objectGroupItem(it.key());
+        if (BatchedObjectGroupItem *batchedItem =
+                dynamic_cast<BatchedObjectGroupItem*>(ogItem))
+            batchedItem->objectsChanged(it.value());
     }
 }
 
@@ -515,6 +759,18 @@ void MapScene::objectsIndexChanged(ObjectGroup *objectGroup,
     if (objectGroup->drawOrder() != ObjectGroup::IndexOrder)
         return;
 
+    ObjectGroupItem *ogItem = objectGroupItem(objectGroup);
+    if (dynamic_cast<BatchedObjectGroupItem*>(ogItem)) {
+        // Only some objects have an item, the others are drawn in index order
+        foreach (MapObjectItem *item, mBatchedObjectItems) {
+            MapObject *object = item->mapObject();
+            if (object->objectGroup() == objectGroup)
+                item->setZValue(objectGroup->indexOfObject(object));
+        }
+        ogItem->update();
+        return;
+    }
+
     for (int i = first; i <= last; ++i) {
         MapObjectItem *item = itemForObject(objectGroup->objectAt(i));
         Q_ASSERT(item);
@@ -529,7 +785,7 @@ void MapScene::updateSelectedObjectItems()
 
     QSet<MapObjectItem*> items;
     foreach (MapObject *object, objects) {
-        MapObjectItem *item = itemForObject(object);
+        MapObjectItem *item = ensureObjectItem(object);
         Q_ASSERT(item);
 
         items.insert(item);
@@ -537,18 +793,26 @@ void MapScene::updateSelectedObjectItems()
 
     // Update the editable state of the items
     foreach (MapObjectItem *item, mSelectedObjectItems - items)
-        item->setEditable(false);
+        setObjectItemEditable(item, false);
     foreach (MapObjectItem *item, items - mSelectedObjectItems)
-        item->setEditable(true);
+        setObjectItemEditable(item, true);
 
     mSelectedObjectItems = items;
     emit selectedObjectItemsChanged();
+
+    // Items of objects in batched object groups that are no longer selected
+    // are removed after the tools have seen the new selection
+    releaseObjectItems();
 }
 
 void MapScene::syncAllObjectItems()
 {
     foreach (MapObjectItem *item, mObjectItems)
         item->syncWithMapObject();
+
+    foreach (QGraphicsItem *item, mLayerItems)
+        if (dynamic_cast<BatchedObjectGroupItem*>(item))
+            item->update();
 }
 
 /**
@@ -574,12 +838,32 @@ void MapScene::setObjectLineWidth(qreal lineWidth)
         mMapDocument->renderer()->setObjectLineWidth(lineWidth);
 
         // Changing the line width can change the size of the object items
-        if (!mObjectItems.isEmpty()) {
-            foreach (MapObjectItem *item, mObjectItems)
-                item->syncWithMapObject();
+        foreach (MapObjectItem *item, mObjectItems)
+            item->syncWithMapObject();
 
-            update();
-        }
+        foreach (QGraphicsItem *item, mLayerItems)
+            if (BatchedObjectGroupItem *boi = dynamic_cast<BatchedObjectGroupItem*>(item))
+                boi->syncWithObjectGroup();
+
+        update();
+    }
+}
+
+void MapScene::setLevelOfDetailThreshold(qreal threshold)
+{
+    if (mLevelOfDetailThreshold == threshold)
+        return;
+
+    mLevelOfDetailThreshold = threshold;
+
+    if (mMapDocument) {
+        mMapDocument->renderer()->setLevelOfDetailThreshold(threshold);
+
+        foreach (QGraphicsItem *item, mLayerItems)
+            if (TileLayerItem *tli = dynamic_cast<TileLayerItem*>(item))
+                tli->invalidateCache();
+
+        update();
     }
 }
 
@@ -592,8 +876,7 @@ void MapScene::setShowTileObjectOutlines(bool enabled)
 
     if (mMapDocument) {
         mMapDocument->renderer()->setFlag(ShowTileObjectOutlines, enabled);
-        if (!mObjectItems.isEmpty())
-            update();
+        update();
     }
 }
 
@@ -651,6 +934,11 @@ void MapScene::mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent)
     if (!mMapDocument)
         return;
 
+    // Tools may refer to the item that was clicked, so the hovered object
+    // is not changed while a button is pressed
+    if (mouseEvent->buttons() == Qt::NoButton)
+        setHoveredObject(batchedObjectAt(mLastMousePos));
+
     QGraphicsScene::mouseMoveEvent(mouseEvent);
     if (mouseEvent->isAccepted())
         return;
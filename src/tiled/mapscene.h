@@ -35,12 +35,14 @@ class ImageLayer;
 class Layer;
 class MapObject;
 class ObjectGroup;
+class Tile;
 class TileLayer;
 class Tileset;
 
 namespace Internal {
 
 class AbstractTool;
+class BatchedObjectGroupItem;
 class MapDocument;
 class MapObjectItem;
 class MapScene;
@@ -97,6 +99,22 @@ public:
     MapObjectItem *itemForObject(MapObject *object) const
     { return mObjectItems.value(object); }
 
+    /**
+     * Makes sure map object items exist for the objects of batched object
+     * groups that may intersect the given \a rect in scene coordinates, so
+     * that they can be found using QGraphicsScene::items(). Call
+     * releaseObjectItems() once the items are no longer needed.
+     *
+     * \sa BatchedObjectGroupItem
+     */
+    void createObjectItems(const QRectF &rect);
+
+    /**
+     * Removes the items of objects in batched object groups that are neither
+     * selected nor hovered. This also happens on each selection change.
+     */
+    void releaseObjectItems();
+
     /**
      * Enables the selected tool at this map scene.
      * Therefore it tells that tool, that this is the active map scene.
@@ -133,6 +151,7 @@ protected:
 private slots:
     void setGridVisible(bool visible);
     void setObjectLineWidth(qreal lineWidth);
+    void setLevelOfDetailThreshold(qreal threshold);
     void setShowTileObjectOutlines(bool enabled);
 
     /**
@@ -154,6 +173,8 @@ private slots:
 
     void mapChanged();
     void tilesetChanged(Tileset *tileset);
+    void repaintTileset(Tileset *tileset);
+    void tileAnimationChanged(Tile *tile);
     void tileLayerDrawMarginsChanged(TileLayer *tileLayer);
 
     void layerAdded(int index);
@@ -175,6 +196,17 @@ private slots:
 
 private:
     QGraphicsItem *createLayerItem(Layer *layer);
+    ObjectGroupItem *objectGroupItem(ObjectGroup *objectGroup) const;
+
+    MapObjectItem *createObjectItem(MapObject *object,
+                                    ObjectGroupItem *ogItem,
+                                    int index);
+    MapObjectItem *ensureObjectItem(MapObject *object);
+    void releaseObjectItem(MapObjectItem *item);
+    void setObjectItemEditable(MapObjectItem *item, bool editable);
+
+    MapObject *batchedObjectAt(const QPointF &scenePos) const;
+    void setHoveredObject(MapObject *object);
 
     void updateCurrentLayerHighlight();
 
@@ -185,6 +217,7 @@ private:
     AbstractTool *mActiveTool;
     bool mGridVisible;
     qreal mObjectLineWidth;
+    qreal mLevelOfDetailThreshold;
     bool mShowTileObjectOutlines;
     bool mHighlightCurrentLayer;
     bool mUnderMouse;
@@ -197,6 +230,8 @@ private:
     typedef QMap<MapObject*, MapObjectItem*> ObjectItems;
     ObjectItems mObjectItems;
     QSet<MapObjectItem*> mSelectedObjectItems;
+    QSet<MapObjectItem*> mBatchedObjectItems;
+    MapObject *mHoveredObject;
 };
 
 } // namespace Internal
@@ -26,6 +26,7 @@
 #include "mapobjectmodel.h"
 
 #include <QCoreApplication>
+#include <QHash>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
@@ -53,3 +54,77 @@ void MoveMapObjectToGroup::redo()
     mMapDocument->mapObjectModel()->removeObject(mOldObjectGroup, mMapObject);
     mMapDocument->mapObjectModel()->insertObject(mNewObjectGroup, -1, mMapObject);
 }
+
+
+MoveMapObjectsToGroup::MoveMapObjectsToGroup(MapDocument *mapDocument,
+                                             const QList<MapObject*> &mapObjects,
+                                             ObjectGroup *objectGroup)
+    : mMapDocument(mapDocument)
+{
+#if QT_VERSION >= 0x050000
+    setText(QCoreApplication::translate("Undo Commands",
+                                        "Move %n Object(s) to Layer",
+                                        0, mapObjects.size()));
+#else
+    setText(QCoreApplication::translate("Undo Commands",
+                                        "Move %n Object(s) to Layer",
+                                        0, QCoreApplication::UnicodeUTF8,
+                                        mapObjects.size()));
+#endif
+
+    QHash<ObjectGroup*, int> groupIndexes;
+
+    foreach (MapObject *mapObject, mapObjects) {
+        ObjectGroup *og = mapObject->objectGroup();
+
+        int groupIndex = groupIndexes.value(og, -1);
+        if (groupIndex == -1) {
+            groupIndex = mOldGroupObjects.size();
+            groupIndexes.insert(og, groupIndex);
+
+            GroupObjects groupObjects;
+            groupObjects.objectGroup = og;
+            mOldGroupObjects.append(groupObjects);
+        }
+
+        mOldGroupObjects[groupIndex].objects.append(mapObject);
+    }
+
+    // The objects are appended to the new object group in the above order
+    mNewGroupObjects.objectGroup = objectGroup;
+    foreach (const GroupObjects &groupObjects, mOldGroupObjects) {
+        mNewGroupObjects.objects.append(groupObjects.objects);
+        for (int i = 0; i < groupObjects.objects.size(); ++i)
+            mNewGroupObjects.indexes.append(-1);
+    }
+}
+
+void MoveMapObjectsToGroup::undo()
+{
+    MapObjectModel *mapObjectModel = mMapDocument->mapObjectModel();
+
+    mNewGroupObjects.indexes =
+            mapObjectModel->removeObjects(mNewGroupObjects.objectGroup,
+                                          mNewGroupObjects.objects);
+
+    foreach (const GroupObjects &groupObjects, mOldGroupObjects)
+        mapObjectModel->insertObjects(groupObjects.objectGroup,
+                                      groupObjects.objects,
+                                      groupObjects.indexes);
+}
+
+void MoveMapObjectsToGroup::redo()
+{
+    MapObjectModel *mapObjectModel = mMapDocument->mapObjectModel();
+
+    for (int i = 0; i < mOldGroupObjects.size(); ++i) {
+        GroupObjects &groupObjects = mOldGroupObjects[i];
+        groupObjects.indexes =
+                mapObjectModel->removeObjects(groupObjects.objectGroup,
+                                              groupObjects.objects);
+    }
+
+    mapObjectModel->insertObjects(mNewGroupObjects.objectGroup,
+                                  mNewGroupObjects.objects,
+                                  mNewGroupObjects.indexes);
+}
@@ -21,6 +21,7 @@
 #ifndef MOVEMAPOBJECTTOGROUP_H
 #define MOVEMAPOBJECTTOGROUP_H
 
+#include <QList>
 #include <QUndoCommand>
 
 namespace Tiled {
@@ -49,6 +50,34 @@ private:
     ObjectGroup *mNewObjectGroup;
 };
 
+/**
+ * Undo command that moves a number of objects to another object group. The
+ * objects are removed from and added to each object group in one operation,
+ * and return to their original index when undone.
+ */
+class MoveMapObjectsToGroup : public QUndoCommand
+{
+public:
+    MoveMapObjectsToGroup(MapDocument *mapDocument,
+                          const QList<MapObject*> &mapObjects,
+                          ObjectGroup *objectGroup);
+
+    void undo();
+    void redo();
+
+private:
+    struct GroupObjects
+    {
+        ObjectGroup *objectGroup;
+        QList<MapObject*> objects;
+        QList<int> indexes;
+    };
+
+    MapDocument *mMapDocument;
+    QList<GroupObjects> mOldGroupObjects;
+    GroupObjects mNewGroupObjects;
+};
+
 } // namespace Internal
 } // namespace Tiled
 
@@ -20,11 +20,13 @@
 
 #include "objectselectiontool.h"
 
+#include "batchobjectchanges.h"
 #include "layer.h"
 #include "map.h"
 #include "mapdocument.h"
 #include "mapobject.h"
 #include "mapobjectitem.h"
+#include "mapobjectmodel.h"
 #include "maprenderer.h"
 #include "mapscene.h"
 #include "movemapobject.h"
@@ -278,6 +280,7 @@ void ObjectSelectionTool::keyPressed(QKeyEvent *event)
 
     QUndoStack *undoStack = mapDocument()->undoStack();
     undoStack->beginMacro(tr("Move %n Object(s)", "", items.size()));
+    undoStack->push(new BatchObjectChanges(mapDocument(), BatchObjectChanges::Begin));
     int i = 0;
     foreach (MapObjectItem *objectItem, items) {
         MapObject *object = objectItem->mapObject();
@@ -286,6 +289,7 @@ void ObjectSelectionTool::keyPressed(QKeyEvent *event)
         undoStack->push(new MoveMapObject(mapDocument(), object, oldPos));
         ++i;
     }
+    undoStack->push(new BatchObjectChanges(mapDocument(), BatchObjectChanges::End));
     undoStack->endMacro();
 }
 
@@ -492,6 +496,8 @@ void ObjectSelectionTool::updateSelection(const QPointF &pos,
 
     QSet<MapObjectItem*> selectedItems;
 
+    mapScene()->createObjectItems(rect);
+
     foreach (QGraphicsItem *item, mapScene()->items(rect)) {
         MapObjectItem *mapObjectItem = dynamic_cast<MapObjectItem*>(item);
         if (mapObjectItem)
@@ -502,6 +508,7 @@ void ObjectSelectionTool::updateSelection(const QPointF &pos,
         selectedItems |= mapScene()->selectedObjectItems();
 
     mapScene()->setSelectedObjectItems(selectedItems);
+    mapScene()->releaseObjectItems();
 }
 
 void ObjectSelectionTool::startSelecting()
@@ -594,6 +601,7 @@ void ObjectSelectionTool::finishMoving(const QPointF &pos)
 
     QUndoStack *undoStack = mapDocument()->undoStack();
     undoStack->beginMacro(tr("Move %n Object(s)", "", mMovingItems.size()));
+    undoStack->push(new BatchObjectChanges(mapDocument(), BatchObjectChanges::Begin));
     int i = 0;
     foreach (MapObjectItem *objectItem, mMovingItems) {
         MapObject *object = objectItem->mapObject();
@@ -601,6 +609,7 @@ void ObjectSelectionTool::finishMoving(const QPointF &pos)
         undoStack->push(new MoveMapObject(mapDocument(), object, oldPos));
         ++i;
     }
+    undoStack->push(new BatchObjectChanges(mapDocument(), BatchObjectChanges::End));
     undoStack->endMacro();
 
     mOldObjectItemPositions.clear();
@@ -675,6 +684,7 @@ void ObjectSelectionTool::finishRotating(const QPointF &pos)
 
     QUndoStack *undoStack = mapDocument()->undoStack();
     undoStack->beginMacro(tr("Rotate %n Object(s)", "", mMovingItems.size()));
+    undoStack->push(new BatchObjectChanges(mapDocument(), BatchObjectChanges::Begin));
     int i = 0;
     foreach (MapObjectItem *objectItem, mMovingItems) {
         MapObject *object = objectItem->mapObject();
@@ -684,6 +694,7 @@ void ObjectSelectionTool::finishRotating(const QPointF &pos)
         undoStack->push(new RotateMapObject(mapDocument(), object, oldRotation));
         ++i;
     }
+    undoStack->push(new BatchObjectChanges(mapDocument(), BatchObjectChanges::End));
     undoStack->endMacro();
 
     mOldObjectItemPositions.clear();
@@ -77,6 +77,7 @@ Preferences::Preferences()
     mGridColor = colorValue("GridColor", Qt::black);
     mGridFine = intValue("GridFine", 4);
     mObjectLineWidth = realValue("ObjectLineWidth", 2);
+    mLevelOfDetailThreshold = realValue("LevelOfDetailThreshold", 4);
     mHighlightCurrentLayer = boolValue("HighlightCurrentLayer");
     mShowTilesetGrid = boolValue("ShowTilesetGrid", true);
     mLanguage = stringValue("Language");
@@ -196,6 +197,16 @@ void Preferences::setObjectLineWidth(qreal lineWidth)
     emit objectLineWidthChanged(mObjectLineWidth);
 }
 
+void Preferences::setLevelOfDetailThreshold(qreal threshold)
+{
+    if (mLevelOfDetailThreshold == threshold)
+        return;
+    mLevelOfDetailThreshold = threshold;
+    mSettings->setValue(QLatin1String("Interface/LevelOfDetailThreshold"),
+                        mLevelOfDetailThreshold);
+    emit levelOfDetailThresholdChanged(mLevelOfDetailThreshold);
+}
+
 void Preferences::setHighlightCurrentLayer(bool highlight)
 {
     if (mHighlightCurrentLayer == highlight)
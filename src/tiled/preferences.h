@@ -52,6 +52,7 @@ public:
     QColor gridColor() const { return mGridColor; }
     int gridFine() const { return mGridFine; }
     qreal objectLineWidth() const { return mObjectLineWidth; }
+    qreal levelOfDetailThreshold() const { return mLevelOfDetailThreshold; }
 
     bool highlightCurrentLayer() const { return mHighlightCurrentLayer; }
     bool showTilesetGrid() const { return mShowTilesetGrid; }
@@ -107,6 +108,7 @@ public slots:
     void setGridColor(QColor gridColor);
     void setGridFine(int gridFine);
     void setObjectLineWidth(qreal lineWidth);
+    void setLevelOfDetailThreshold(qreal threshold);
     void setHighlightCurrentLayer(bool highlight);
     void setShowTilesetGrid(bool showTilesetGrid);
 
@@ -119,6 +121,7 @@ signals:
     void gridColorChanged(QColor gridColor);
     void gridFineChanged(int gridFine);
     void objectLineWidthChanged(qreal lineWidth);
+    void levelOfDetailThresholdChanged(qreal threshold);
     void highlightCurrentLayerChanged(bool highlight);
     void showTilesetGridChanged(bool showTilesetGrid);
 
@@ -148,6 +151,7 @@ private:
     QColor mGridColor;
     int mGridFine;
     qreal mObjectLineWidth;
+    qreal mLevelOfDetailThreshold;
     bool mHighlightCurrentLayer;
     bool mShowTilesetGrid;
 
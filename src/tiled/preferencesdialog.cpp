@@ -144,6 +144,8 @@ PreferencesDialog::PreferencesDialog(QWidget *parent) :
             Preferences::instance(), SLOT(setGridFine(int)));
     connect(mUi->objectLineWidth, SIGNAL(valueChanged(double)),
             SLOT(objectLineWidthChanged(double)));
+    connect(mUi->levelOfDetailThreshold, SIGNAL(valueChanged(double)),
+            SLOT(levelOfDetailThresholdChanged(double)));
 
     connect(mUi->objectTypesTable->selectionModel(),
             SIGNAL(selectionChanged(QItemSelection,QItemSelection)),
@@ -200,6 +202,11 @@ void PreferencesDialog::objectLineWidthChanged(double lineWidth)
     Preferences::instance()->setObjectLineWidth(lineWidth);
 }
 
+void PreferencesDialog::levelOfDetailThresholdChanged(double threshold)
+{
+    Preferences::instance()->setLevelOfDetailThreshold(threshold);
+}
+
 void PreferencesDialog::useOpenGLToggled(bool useOpenGL)
 {
     Preferences::instance()->setUseOpenGL(useOpenGL);
@@ -314,6 +321,7 @@ void PreferencesDialog::fromPreferences()
     mUi->gridColor->setColor(prefs->gridColor());
     mUi->gridFine->setValue(prefs->gridFine());
     mUi->objectLineWidth->setValue(prefs->objectLineWidth());
+    mUi->levelOfDetailThreshold->setValue(prefs->levelOfDetailThreshold());
     mUi->autoMapWhileDrawing->setChecked(prefs->automappingDrawing());
     mObjectTypesModel->setObjectTypes(prefs->objectTypes());
 }
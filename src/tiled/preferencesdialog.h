@@ -52,6 +52,7 @@ protected:
 private slots:
     void languageSelected(int index);
     void objectLineWidthChanged(double lineWidth);
+    void levelOfDetailThresholdChanged(double threshold);
     void useOpenGLToggled(bool useOpenGL);
     void useAutomappingDrawingToggled(bool enabled);
 
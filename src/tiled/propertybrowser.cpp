@@ -20,6 +20,7 @@
 
 #include "propertybrowser.h"
 
+#include "batchobjectchanges.h"
 #include "changelayer.h"
 #include "changeimagelayerposition.h"
 #include "changeimagelayerproperties.h"
@@ -27,11 +28,13 @@
 #include "changemapproperty.h"
 #include "changeobjectgroupproperties.h"
 #include "changeproperties.h"
+#include "compression.h"
 #include "flipmapobjects.h"
 #include "imagelayer.h"
 #include "map.h"
 #include "mapdocument.h"
 #include "mapobject.h"
+#include "mapobjectmodel.h"
 #include "movemapobject.h"
 #include "objectgroup.h"
 #include "preferences.h"
@@ -85,6 +88,8 @@ PropertyBrowser::PropertyBrowser(QWidget *parent)
     mLayerFormatNames.append(QCoreApplication::translate("PreferencesDialog", "Base64 (gzip compressed)"));
     mLayerFormatNames.append(QCoreApplication::translate("PreferencesDialog", "Base64 (zlib compressed)"));
     mLayerFormatNames.append(QCoreApplication::translate("PreferencesDialog", "CSV"));
+    mLayerFormatNames.append(QCoreApplication::translate("PreferencesDialog", "Base64 (Zstandard compressed)"));
+    mLayerFormatNames.append(QCoreApplication::translate("PreferencesDialog", "Base64 (LZ4 compressed)"));
 
     mRenderOrderNames.append(QCoreApplication::translate("PreferencesDialog", "Right Down"));
     mRenderOrderNames.append(QCoreApplication::translate("PreferencesDialog", "Right Up"));
@@ -362,6 +367,12 @@ void PropertyBrowser::addMapProperties()
 
     layerFormatProperty->setAttribute(QLatin1String("enumNames"), mLayerFormatNames);
 
+    QtVariantProperty *compressionLevelProperty =
+            createProperty(CompressionLevelProperty, QVariant::Int,
+                           tr("Compression Level"), groupProperty);
+
+    compressionLevelProperty->setAttribute(QLatin1String("minimum"), -1);
+
     QtVariantProperty *renderOrderProperty =
             createProperty(RenderOrderProperty,
                            QtVariantPropertyManager::enumTypeId(),
@@ -528,6 +539,11 @@ void PropertyBrowser::applyMapValue(PropertyId id, const QVariant &val)
         command = new ChangeMapProperty(mMapDocument, format);
         break;
     }
+    case CompressionLevelProperty: {
+        command = new ChangeMapProperty(mMapDocument, ChangeMapProperty::CompressionLevel,
+                                        val.toInt());
+        break;
+    }
     case RenderOrderProperty: {
         Map::RenderOrder renderOrder = static_cast<Map::RenderOrder>(val.toInt());
         command = new ChangeMapProperty(mMapDocument, renderOrder);
@@ -606,6 +622,7 @@ void PropertyBrowser::applyMapObjectValue(PropertyId id, const QVariant &val)
     QUndoCommand *command = applyMapObjectValueTo(id, val, mapObject);
 
     mMapDocument->undoStack()->beginMacro(command->text());
+    mMapDocument->undoStack()->push(new BatchObjectChanges(mMapDocument, BatchObjectChanges::Begin));
     mMapDocument->undoStack()->push(command);
 
     //Used to share non-custom properties.
@@ -618,6 +635,7 @@ void PropertyBrowser::applyMapObjectValue(PropertyId id, const QVariant &val)
         }
     }
 
+    mMapDocument->undoStack()->push(new BatchObjectChanges(mMapDocument, BatchObjectChanges::End));
     mMapDocument->undoStack()->endMacro();
 }
 
@@ -782,6 +800,35 @@ QtVariantProperty *PropertyBrowser::createProperty(PropertyId id, int type,
     return property;
 }
 
+/**
+ * Limits the compression level property to the levels accepted by the
+ * compression method of the given layer data \a format.
+ */
+void PropertyBrowser::updateCompressionLevelRange(Map::LayerDataFormat format)
+{
+    int maximumLevel;
+
+    switch (format) {
+    case Map::Base64Gzip:
+        maximumLevel = maximumCompressionLevel(Gzip);
+        break;
+    case Map::Base64Zlib:
+        maximumLevel = maximumCompressionLevel(Zlib);
+        break;
+    case Map::Base64Zstd:
+        maximumLevel = maximumCompressionLevel(Zstandard);
+        break;
+    case Map::Base64Lz4:
+        maximumLevel = maximumCompressionLevel(Lz4);
+        break;
+    default:
+        return; // The level is not used by uncompressed formats
+    }
+
+    mIdToProperty[CompressionLevelProperty]->setAttribute(QLatin1String("maximum"),
+                                                          maximumLevel);
+}
+
 void PropertyBrowser::updateProperties()
 {
     mUpdating = true;
@@ -796,6 +843,8 @@ void PropertyBrowser::updateProperties()
         mIdToProperty[StaggerAxisProperty]->setValue(map->staggerAxis());
         mIdToProperty[StaggerIndexProperty]->setValue(map->staggerIndex());
         mIdToProperty[LayerFormatProperty]->setValue(map->layerDataFormat());
+        updateCompressionLevelRange(map->layerDataFormat());
+        mIdToProperty[CompressionLevelProperty]->setValue(map->compressionLevel());
         mIdToProperty[RenderOrderProperty]->setValue(map->renderOrder());
         QColor backgroundColor = map->backgroundColor();
         if (!backgroundColor.isValid())
@@ -21,6 +21,8 @@
 #ifndef PROPERTYBROWSER_H
 #define PROPERTYBROWSER_H
 
+#include "map.h"
+
 #include <QHash>
 #include <QUndoCommand>
 
@@ -34,7 +36,6 @@ namespace Tiled {
 
 class Object;
 class ImageLayer;
-class Map;
 class MapObject;
 class ObjectGroup;
 class TileLayer;
@@ -111,6 +112,7 @@ private:
         StaggerIndexProperty,
         RenderOrderProperty,
         LayerFormatProperty,
+        CompressionLevelProperty,
         ImageSourceProperty,
         FlippingProperty,
         DrawOrderProperty,
@@ -144,6 +146,7 @@ private:
                                       const QString &name,
                                       QtProperty *parent);
 
+    void updateCompressionLevelRange(Map::LayerDataFormat format);
     void updateProperties();
     void updateCustomProperties();
     bool mUpdating;
@@ -41,8 +41,10 @@ void RaiseLowerHelper::raise()
     // Iterate backwards over the ranges in order to keep the indexes valid
     RangeSet<int>::Range firstRange = mSelectionRanges.begin();
     RangeSet<int>::Range it = mSelectionRanges.end();
-    if (it == firstRange) // no range
+    if (it == firstRange) { // no range
+        releaseContext();
         return;
+    }
 
     // For each range of objects, only the first will move
     QList<QUndoCommand*> commands;
@@ -63,6 +65,7 @@ void RaiseLowerHelper::raise()
                                                   from, to, 1));
     } while (it != firstRange);
 
+    releaseContext();
     push(commands,
          QCoreApplication::translate("Undo Commands", "Raise Object"));
 }
@@ -92,6 +95,7 @@ void RaiseLowerHelper::lower()
                                                   from, to, 1));
     }
 
+    releaseContext();
     push(commands,
          QCoreApplication::translate("Undo Commands", "Lower Object"));
 }
@@ -224,6 +228,8 @@ bool RaiseLowerHelper::initContext()
 
     // The list of related items are all items from the same object group
     // that share space with the selected items.
+    mMapScene->createObjectItems(shape.boundingRect());
+
     QList<QGraphicsItem*> items = mMapScene->items(shape,
                                                    Qt::IntersectsItemShape,
                                                    Qt::AscendingOrder);
@@ -244,6 +250,17 @@ bool RaiseLowerHelper::initContext()
     return true;
 }
 
+/**
+ * Releases the map object items that were created by initContext() for
+ * objects in batched object groups.
+ */
+void RaiseLowerHelper::releaseContext()
+{
+    mRelatedObjects.clear();
+    mSelectionRanges.clear();
+    mMapScene->releaseObjectItems();
+}
+
 void RaiseLowerHelper::push(const QList<QUndoCommand*> &commands,
                             const QString &text)
 {
@@ -63,6 +63,7 @@ public:
 
 private:
     bool initContext();
+    void releaseContext();
     void push(const QList<QUndoCommand *> &commands, const QString &text);
 
     MapDocument *mMapDocument;
@@ -34,6 +34,7 @@
 #include "terrain.h"
 
 #include <math.h>
+#include <QHash>
 #include <QVector>
 #include <climits>
 
@@ -268,11 +269,8 @@ static Tile *findBestTile(Tileset *tileset, unsigned terrain, unsigned considera
     QList<Tile*> matches;
     int penalty = INT_MAX;
 
-    // TODO: this is a slow linear search, perhaps we could use a better find algorithm...
-    foreach (Tile *t, tileset->tiles()) {
-        if ((t->terrain() & considerationMask) != (terrain & considerationMask))
-            continue;
-
+    // only the tiles matching the considered corners are candidates
+    foreach (Tile *t, tileset->tilesWithTerrain(terrain, considerationMask)) {
         // calculate the tile transition penalty based on shortest distance to target terrain type
         int tr = tileset->terrainTransitionPenalty(t->terrain() >> 24, terrain >> 24);
         int tl = tileset->terrainTransitionPenalty((t->terrain() >> 16) & 0xFF, (terrain >> 16) & 0xFF);
@@ -361,7 +359,6 @@ void TerrainBrush::updateBrush(QPoint cursorPos, const QVector<QPoint> *list)
 
     int layerWidth = currentLayer->width();
     int layerHeight = currentLayer->height();
-    int numTiles = layerWidth * layerHeight;
     int paintCorner = 0;
 
     // if we are in vertex paint mode, the bottom right corner on the map will appear as an invalid tile offset...
@@ -387,15 +384,13 @@ void TerrainBrush::updateBrush(QPoint cursorPos, const QVector<QPoint> *list)
         terrainId = mTerrain->id();
     }
 
-    // allocate a buffer to build the terrain tilemap (TODO: this could be retained per layer to save regular allocation)
-    Tile **newTerrain = new Tile*[numTiles];
+    // the tiles chosen for each position considered so far, by layer index
+    // (sparse, so that the cost depends on how far the transitions spread
+    // rather than on the size of the layer)
+    QHash<int, Tile*> newTerrain;
 
-    // allocate a buffer of flags for each tile that may be considered (TODO: this could be retained per layer to save regular allocation)
-    char *checked = new char[numTiles];
-    memset(checked, 0, numTiles);
-
-    // create a consideration list, and push the start points
-    QList<QPoint> transitionList;
+    // create a consideration queue, and push the start points
+    QVector<QPoint> transitionList;
     int initialTiles = 0;
 
     if (list) {
@@ -412,15 +407,15 @@ void TerrainBrush::updateBrush(QPoint cursorPos, const QVector<QPoint> *list)
     QRect brushRect(cursorPos, cursorPos);
 
     // produce terrain with transitions using a simple, relative naive approach (considers each tile once, and doesn't allow re-consideration if selection was bad)
-    while (!transitionList.isEmpty()) {
-        // get the next point in the consideration list
-        QPoint p = transitionList.takeFirst();
+    for (int next = 0; next < transitionList.size(); ++next) {
+        // get the next point in the consideration queue
+        const QPoint p = transitionList.at(next);
         int x = p.x(), y = p.y();
         int i = y*layerWidth + x;
 
         // if we have already considered this point, skip to the next
         // TODO: we might want to allow re-consideration if prior tiles... but not for now, this would risk infinite loops
-        if (checked[i])
+        if (newTerrain.contains(i))
             continue;
 
         const Tile *tile = currentLayer->cellAt(p).tile;
@@ -470,20 +465,20 @@ void TerrainBrush::updateBrush(QPoint cursorPos, const QVector<QPoint> *list)
             mask = 0;
 
             // depending which connections have been set, we update the preferred terrain of the tile accordingly
-            if (y > 0 && checked[i - layerWidth]) {
-                preferredTerrain = (::terrain(newTerrain[i - layerWidth]) << 16) | (preferredTerrain & 0x0000FFFF);
+            if (y > 0 && newTerrain.contains(i - layerWidth)) {
+                preferredTerrain = (::terrain(newTerrain.value(i - layerWidth)) << 16) | (preferredTerrain & 0x0000FFFF);
                 mask |= 0xFFFF0000;
             }
-            if (y < layerHeight - 1 && checked[i + layerWidth]) {
-                preferredTerrain = (::terrain(newTerrain[i + layerWidth]) >> 16) | (preferredTerrain & 0xFFFF0000);
+            if (y < layerHeight - 1 && newTerrain.contains(i + layerWidth)) {
+                preferredTerrain = (::terrain(newTerrain.value(i + layerWidth)) >> 16) | (preferredTerrain & 0xFFFF0000);
                 mask |= 0x0000FFFF;
             }
-            if (x > 0 && checked[i - 1]) {
-                preferredTerrain = ((::terrain(newTerrain[i - 1]) << 8) & 0xFF00FF00) | (preferredTerrain & 0x00FF00FF);
+            if (x > 0 && newTerrain.contains(i - 1)) {
+                preferredTerrain = ((::terrain(newTerrain.value(i - 1)) << 8) & 0xFF00FF00) | (preferredTerrain & 0x00FF00FF);
                 mask |= 0xFF00FF00;
             }
-            if (x < layerWidth - 1 && checked[i + 1]) {
-                preferredTerrain = ((::terrain(newTerrain[i + 1]) >> 8) & 0x00FF00FF) | (preferredTerrain & 0xFF00FF00);
+            if (x < layerWidth - 1 && newTerrain.contains(i + 1)) {
+                preferredTerrain = ((::terrain(newTerrain.value(i + 1)) >> 8) & 0x00FF00FF) | (preferredTerrain & 0xFF00FF00);
                 mask |= 0x00FF00FF;
             }
         }
@@ -497,29 +492,28 @@ void TerrainBrush::updateBrush(QPoint cursorPos, const QVector<QPoint> *list)
         }
 
         // add tile to the brush
-        newTerrain[i] = paste;
-        checked[i] = true;
+        newTerrain.insert(i, paste);
 
         // expand the brush rect to fit the edit set
         brushRect |= QRect(p, p);
 
         // consider surrounding tiles if terrain constraints were not satisfied
-        if (y > 0 && !checked[i - layerWidth]) {
+        if (y > 0 && !newTerrain.contains(i - layerWidth)) {
             const Tile *above = currentLayer->cellAt(x, y - 1).tile;
             if (topEdge(paste) != bottomEdge(above))
                 transitionList.append(QPoint(x, y - 1));
         }
-        if (y < layerHeight - 1 && !checked[i + layerWidth]) {
+        if (y < layerHeight - 1 && !newTerrain.contains(i + layerWidth)) {
             const Tile *below = currentLayer->cellAt(x, y + 1).tile;
             if (bottomEdge(paste) != topEdge(below))
                 transitionList.append(QPoint(x, y + 1));
         }
-        if (x > 0 && !checked[i - 1]) {
+        if (x > 0 && !newTerrain.contains(i - 1)) {
             const Tile *left = currentLayer->cellAt(x - 1, y).tile;
             if (leftEdge(paste) != rightEdge(left))
                 transitionList.append(QPoint(x - 1, y));
         }
-        if (x < layerWidth - 1 && !checked[i + 1]) {
+        if (x < layerWidth - 1 && !newTerrain.contains(i + 1)) {
             const Tile *right = currentLayer->cellAt(x + 1, y).tile;
             if (rightEdge(paste) != leftEdge(right))
                 transitionList.append(QPoint(x + 1, y));
@@ -529,28 +523,24 @@ void TerrainBrush::updateBrush(QPoint cursorPos, const QVector<QPoint> *list)
     // create a stamp for the terrain block
     TileLayer *stamp = new TileLayer(QString(), 0, 0, brushRect.width(), brushRect.height());
 
-    for (int y = brushRect.top(); y <= brushRect.bottom(); ++y) {
-        for (int x = brushRect.left(); x <= brushRect.right(); ++x) {
-            int i = y*layerWidth + x;
-            if (!checked[i])
-                continue;
-
-            Tile *tile = newTerrain[i];
-            if (tile)
-                stamp->setCell(x - brushRect.left(), y - brushRect.top(), Cell(tile));
-            else {
-                // TODO: we need to do something to erase tiles where checked[i] is true, and newTerrain[i] is NULL
-                // is there an eraser stamp? investigate how the eraser works...
-            }
+    QHashIterator<int, Tile*> it(newTerrain);
+    while (it.hasNext()) {
+        it.next();
+        const int x = it.key() % layerWidth;
+        const int y = it.key() / layerWidth;
+
+        Tile *tile = it.value();
+        if (tile)
+            stamp->setCell(x - brushRect.left(), y - brushRect.top(), Cell(tile));
+        else {
+            // TODO: we need to do something to erase tiles where newTerrain contains NULL
+            // is there an eraser stamp? investigate how the eraser works...
         }
     }
 
     // set the new tile layer as the brush
     brushItem()->setTileLayer(stamp);
 
-    delete[] checked;
-    delete[] newTerrain;
-
     brushItem()->setTileLayerPosition(brushRect.topLeft());
 
     mPaintX = cursorPos.x();
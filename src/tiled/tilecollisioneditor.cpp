@@ -336,12 +336,10 @@ void TileCollisionEditor::delete_(Operation operation)
         return;
 
     QUndoStack *undoStack = dummyDocument->undoStack();
-    undoStack->beginMacro(operation == Delete ? tr("Delete") : tr("Cut"));
-
-    foreach (MapObject *mapObject, selectedObjects)
-        undoStack->push(new RemoveMapObject(dummyDocument, mapObject));
-
-    undoStack->endMacro();
+    RemoveMapObjects *command = new RemoveMapObjects(dummyDocument,
+                                                     selectedObjects);
+    command->setText(operation == Delete ? tr("Delete") : tr("Cut"));
+    undoStack->push(command);
 }
 
 void TileCollisionEditor::changeEvent(QEvent *e)
@@ -52,6 +52,8 @@ SOURCES += aboutdialog.cpp \
     automapperwrapper.cpp \
     automappingmanager.cpp \
     automappingutils.cpp  \
+    batchedobjectgroupitem.cpp \
+    batchobjectchanges.cpp \
     brushitem.cpp \
     bucketfilltool.cpp \
     changeimagelayerposition.cpp \
@@ -102,6 +104,7 @@ SOURCES += aboutdialog.cpp \
     mainwindow.cpp \
     mapdocumentactionhandler.cpp \
     mapdocument.cpp \
+    maploader.cpp \
     mapobjectitem.cpp \
     mapobjectmodel.cpp \
     mapscene.cpp \
@@ -182,6 +185,8 @@ HEADERS += aboutdialog.h \
     automapperwrapper.h \
     automappingmanager.h \
     automappingutils.h \
+    batchedobjectgroupitem.h \
+    batchobjectchanges.h \
     brushitem.h \
     bucketfilltool.h \
     changeimagelayerposition.h \
@@ -232,6 +237,7 @@ HEADERS += aboutdialog.h \
     mainwindow.h \
     mapdocumentactionhandler.h \
     mapdocument.h \
+    maploader.h \
     mapobjectitem.h \
     mapobjectmodel.h \
     mapscene.h \
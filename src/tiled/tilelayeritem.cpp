@@ -26,15 +26,88 @@
 #include "mapdocument.h"
 #include "maprenderer.h"
 
+#include <QCache>
 #include <QPainter>
 #include <QStyleOptionGraphicsItem>
+#include <QVector>
+#include <QtCore/qmath.h>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+namespace {
+
+/**
+ * The width and height of the cached chunks, in device pixels.
+ */
+const int ChunkSize = 256;
+
+/**
+ * The cost of a single cached chunk, in kilobytes.
+ */
+const int ChunkCost = ChunkSize * ChunkSize * 4 / 1024;
+
+/**
+ * The maximum amount of memory used by the cached chunks of all tile layers,
+ * in kilobytes. The least recently used chunks are dropped first.
+ */
+const int MaxCacheCost = 128 * 1024;
+
+struct ChunkKey
+{
+    ChunkKey(quint64 cacheId, int x, int y)
+        : cacheId(cacheId), x(x), y(y)
+    {}
+
+    bool operator==(const ChunkKey &other) const
+    {
+        return cacheId == other.cacheId && x == other.x && y == other.y;
+    }
+
+    quint64 cacheId;
+    int x;
+    int y;
+};
+
+inline uint qHash(const ChunkKey &key)
+{
+    return ::qHash(key.cacheId) ^ ::qHash(qMakePair(key.x, key.y));
+}
+
+/**
+ * The chunks are shared between all tile layer items, so that the memory
+ * limit applies to all open maps together. Created on demand and deleted by
+ * TileLayerItem::deleteChunkCache().
+ */
+QCache<ChunkKey, QPixmap> *sharedChunkCache = 0;
+
+QCache<ChunkKey, QPixmap> &chunkCache()
+{
+    if (!sharedChunkCache)
+        sharedChunkCache = new QCache<ChunkKey, QPixmap>(MaxCacheCost);
+    return *sharedChunkCache;
+}
+
+/**
+ * Returns a new unique cache id. Changing the cache id of an item makes its
+ * previously cached chunks unreachable, after which they are dropped from the
+ * cache as it fills up.
+ */
+quint64 nextCacheId()
+{
+    static quint64 cacheId = 0;
+    return ++cacheId;
+}
+
+} // anonymous namespace
+
 TileLayerItem::TileLayerItem(TileLayer *layer, MapDocument *mapDocument)
     : mLayer(layer)
     , mMapDocument(mapDocument)
+    , mCacheId(nextCacheId())
+    , mCacheScale(0)
+    , mUsedTilesetsDirty(true)
+    , mAnimatedRegionsDirty(true)
 {
     setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
 
@@ -45,6 +118,8 @@ TileLayerItem::TileLayerItem(TileLayer *layer, MapDocument *mapDocument)
 void TileLayerItem::syncWithTileLayer()
 {
     prepareGeometryChange();
+    invalidateCache();
+    mAnimatedRegionsDirty = true;
 
     MapRenderer *renderer = mMapDocument->renderer();
     QRectF boundingRect = renderer->boundingRect(mLayer->bounds());
@@ -61,6 +136,73 @@ void TileLayerItem::syncWithTileLayer()
                                           margins.bottom());
 }
 
+void TileLayerItem::invalidateRegion(const QRegion &region)
+{
+    mUsedTilesetsDirty = true;
+
+    if (!mAnimatedRegionsDirty)
+        updateAnimatedRegions(region);
+
+    removeChunks(region);
+}
+
+/**
+ * Drops the cached chunks covering the given \a region, which is in tile
+ * coordinates.
+ */
+void TileLayerItem::removeChunks(const QRegion &region)
+{
+    const MapRenderer *renderer = mMapDocument->renderer();
+    const QMargins margins = mMapDocument->map()->drawMargins();
+    QCache<ChunkKey, QPixmap> &cache = chunkCache();
+
+    foreach (const QRect &r, region.rects()) {
+        const QRect chunks = chunksInRect(
+                    renderer->boundingRect(r).adjusted(-margins.left(),
+                                                       -margins.top(),
+                                                       margins.right(),
+                                                       margins.bottom()));
+
+        for (int y = chunks.top(); y <= chunks.bottom(); ++y)
+            for (int x = chunks.left(); x <= chunks.right(); ++x)
+                cache.remove(ChunkKey(mCacheId, x, y));
+    }
+}
+
+void TileLayerItem::invalidateCache()
+{
+    mCacheId = nextCacheId();
+}
+
+void TileLayerItem::deleteChunkCache()
+{
+    delete sharedChunkCache;
+    sharedChunkCache = 0;
+}
+
+void TileLayerItem::tilesetChanged(Tileset *tileset)
+{
+    if (usesTileset(tileset)) {
+        invalidateCache();
+
+        // The animations of the tiles may have changed
+        mAnimatedRegionsDirty = true;
+    }
+}
+
+void TileLayerItem::tilesetAnimated(Tileset *tileset)
+{
+    if (mAnimatedRegionsDirty) {
+        mAnimatedRegions.clear();
+        updateAnimatedRegions(mLayer->bounds());
+        mAnimatedRegionsDirty = false;
+    }
+
+    const QRegion region = mAnimatedRegions.value(tileset);
+    if (!region.isEmpty())
+        removeChunks(region);
+}
+
 QRectF TileLayerItem::boundingRect() const
 {
     return mBoundingRect;
@@ -72,5 +214,164 @@ void TileLayerItem::paint(QPainter *painter,
 {
     MapRenderer *renderer = mMapDocument->renderer();
     // TODO: Display a border around the layer when selected
-    renderer->drawTileLayer(painter, mLayer, option->exposedRect);
+
+    if (!canUseCache(painter)) {
+        renderer->drawTileLayer(painter, mLayer, option->exposedRect);
+        return;
+    }
+
+    // The chunks are aligned to device pixels, so they can be drawn without
+    // scaling. Any fraction of a pixel in the translation is rendered into
+    // the chunks.
+    const QTransform transform = painter->worldTransform();
+    const int originX = qFloor(transform.dx());
+    const int originY = qFloor(transform.dy());
+    const QPointF offset(transform.dx() - originX, transform.dy() - originY);
+    const QPainter::RenderHints renderHints = painter->renderHints();
+
+    if (transform.m11() != mCacheScale || offset != mCacheOffset ||
+            renderHints != mCacheRenderHints) {
+        invalidateCache();
+        mCacheScale = transform.m11();
+        mCacheOffset = offset;
+        mCacheRenderHints = renderHints;
+    }
+
+    QCache<ChunkKey, QPixmap> &cache = chunkCache();
+    const QRect chunks = chunksInRect(option->exposedRect & mBoundingRect);
+
+    painter->save();
+    painter->setWorldTransform(QTransform::fromTranslate(originX, originY));
+
+    for (int y = chunks.top(); y <= chunks.bottom(); ++y) {
+        for (int x = chunks.left(); x <= chunks.right(); ++x) {
+            const ChunkKey key(mCacheId, x, y);
+
+            QPixmap *chunk = cache.object(key);
+            if (!chunk) {
+                chunk = new QPixmap(renderChunk(x, y));
+                cache.insert(key, chunk, ChunkCost);
+            }
+
+            painter->drawPixmap(x * ChunkSize, y * ChunkSize, *chunk);
+        }
+    }
+
+    painter->restore();
+}
+
+/**
+ * Returns whether the layer is used with the given \a tileset. The set of
+ * used tilesets is only recomputed after the layer changed.
+ */
+bool TileLayerItem::usesTileset(Tileset *tileset)
+{
+    if (mUsedTilesetsDirty) {
+        mUsedTilesets = mLayer->usedTilesets();
+        mUsedTilesetsDirty = false;
+    }
+
+    return mUsedTilesets.contains(tileset);
+}
+
+/**
+ * Rescans the cells in the given \a region, which is in map coordinates, for
+ * animated tiles.
+ */
+void TileLayerItem::updateAnimatedRegions(const QRegion &region)
+{
+    QMutableHashIterator<Tileset*, QRegion> it(mAnimatedRegions);
+    while (it.hasNext()) {
+        it.next();
+        it.value() -= region;
+        if (it.value().isEmpty())
+            it.remove();
+    }
+
+    const QRegion cells = region & mLayer->bounds();
+    const int layerX = mLayer->x();
+    const int layerY = mLayer->y();
+
+    foreach (const QRect &rect, cells.rects()) {
+        QHash<Tileset*, QVector<QRect> > animatedCells;
+
+        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+            for (int x = rect.left(); x <= rect.right(); ++x) {
+                const Tile *tile = mLayer->cellAt(x - layerX, y - layerY).tile;
+                if (tile && tile->isAnimated())
+                    animatedCells[tile->tileset()].append(QRect(x, y, 1, 1));
+            }
+        }
+
+        QHashIterator<Tileset*, QVector<QRect> > cellsIt(animatedCells);
+        while (cellsIt.hasNext()) {
+            cellsIt.next();
+            QRegion animated;
+            animated.setRects(cellsIt.value().constData(),
+                              cellsIt.value().size());
+            mAnimatedRegions[cellsIt.key()] += animated;
+        }
+    }
+}
+
+/**
+ * The cache can only be used when the painter is only scaled uniformly and
+ * translated, since the chunks are drawn without any transformation.
+ */
+bool TileLayerItem::canUseCache(const QPainter *painter) const
+{
+    const QTransform &transform = painter->worldTransform();
+    if (transform.type() > QTransform::TxScale)
+        return false;
+    if (transform.m11() <= 0 || transform.m11() != transform.m22())
+        return false;
+
+#if QT_VERSION >= 0x050000
+    if (painter->device()->devicePixelRatio() != 1)
+        return false;
+#endif
+
+    return true;
+}
+
+/**
+ * Returns the transform from item coordinates to the pixels of the chunk at
+ * \a x, \a y.
+ */
+QTransform TileLayerItem::chunkTransform(int x, int y) const
+{
+    return QTransform(mCacheScale, 0, 0, mCacheScale,
+                      mCacheOffset.x() - x * ChunkSize,
+                      mCacheOffset.y() - y * ChunkSize);
+}
+
+/**
+ * Returns the range of chunks covering the given \a rect, which is in item
+ * coordinates.
+ */
+QRect TileLayerItem::chunksInRect(const QRectF &rect) const
+{
+    const QRectF pixels = chunkTransform(0, 0).mapRect(rect);
+
+    return QRect(QPoint(qFloor(pixels.left() / ChunkSize),
+                        qFloor(pixels.top() / ChunkSize)),
+                 QPoint(qCeil(pixels.right() / ChunkSize) - 1,
+                        qCeil(pixels.bottom() / ChunkSize) - 1));
+}
+
+QPixmap TileLayerItem::renderChunk(int x, int y) const
+{
+    QPixmap pixmap(ChunkSize, ChunkSize);
+    pixmap.fill(Qt::transparent);
+
+    const QTransform transform = chunkTransform(x, y);
+    const QRectF exposed = transform.inverted().mapRect(
+                QRectF(0, 0, ChunkSize, ChunkSize));
+
+    QPainter painter(&pixmap);
+    painter.setRenderHints(mCacheRenderHints);
+    painter.setTransform(transform);
+    mMapDocument->renderer()->drawTileLayer(&painter, mLayer, exposed);
+
+    return pixmap;
 }
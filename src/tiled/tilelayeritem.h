@@ -22,10 +22,15 @@
 #define TILELAYERITEM_H
 
 #include <QGraphicsItem>
+#include <QHash>
+#include <QPainter>
+#include <QRegion>
+#include <QSet>
 
 namespace Tiled {
 
 class TileLayer;
+class Tileset;
 
 namespace Internal {
 
@@ -33,6 +38,10 @@ class MapDocument;
 
 /**
  * A graphics item displaying a tile layer in a QGraphicsView.
+ *
+ * The layer is rendered into a cache of fixed-size pixmap chunks for the
+ * current zoom level, so that repainting a layer that didn't change only
+ * needs to draw the cached chunks.
  */
 class TileLayerItem : public QGraphicsItem
 {
@@ -55,6 +64,37 @@ public:
      */
     void syncWithTileLayer();
 
+    /**
+     * Drops the cached chunks covering the given \a region, which is in tile
+     * coordinates. Should be called when the cells in this region changed.
+     */
+    void invalidateRegion(const QRegion &region);
+
+    /**
+     * Drops all cached chunks.
+     */
+    void invalidateCache();
+
+    /**
+     * Deletes the chunks cached for all tile layer items. Needs to be called
+     * before the application object is destroyed, since the chunks are
+     * pixmaps.
+     */
+    static void deleteChunkCache();
+
+    /**
+     * Should be called when the tile images of the given \a tileset have
+     * changed. Drops the cache when this layer uses the tileset.
+     */
+    void tilesetChanged(Tileset *tileset);
+
+    /**
+     * Should be called when the animated tiles of the given \a tileset have
+     * advanced to another frame. Drops the cached chunks showing animated
+     * tiles of the tileset.
+     */
+    void tilesetAnimated(Tileset *tileset);
+
     // QGraphicsItem
     QRectF boundingRect() const;
     void paint(QPainter *painter,
@@ -62,9 +102,29 @@ public:
                QWidget *widget = 0);
 
 private:
+    bool usesTileset(Tileset *tileset);
+    void updateAnimatedRegions(const QRegion &region);
+    void removeChunks(const QRegion &region);
+    bool canUseCache(const QPainter *painter) const;
+    QTransform chunkTransform(int x, int y) const;
+    QRect chunksInRect(const QRectF &rect) const;
+    QPixmap renderChunk(int x, int y) const;
+
     TileLayer *mLayer;
     MapDocument *mMapDocument;
     QRectF mBoundingRect;
+
+    quint64 mCacheId;
+    qreal mCacheScale;
+    QPointF mCacheOffset;
+    QPainter::RenderHints mCacheRenderHints;
+
+    QSet<Tileset*> mUsedTilesets;
+    bool mUsedTilesetsDirty;
+
+    // The cells showing animated tiles, per tileset, in map coordinates
+    QHash<Tileset*, QRegion> mAnimatedRegions;
+    bool mAnimatedRegionsDirty;
 };
 
 } // namespace Internal
@@ -25,6 +25,9 @@
 #include "tilelayer.h"
 #include "map.h"
 
+#include <QBitArray>
+#include <QtAlgorithms>
+
 using namespace Tiled;
 using namespace Tiled::Internal;
 
@@ -53,6 +56,192 @@ private:
     const QMargins mDrawMargins;
 };
 
+/**
+ * Computes the region of connected cells equal to the cell at a given
+ * origin.
+ *
+ * The fill is done one horizontal span at a time. The cells that were
+ * already visited and the cells that are drawable (when there is a
+ * selection) are kept in bit arrays limited to the area that can be filled.
+ * The resulting spans are collected and turned into a region at once, which
+ * avoids repeatedly uniting regions.
+ */
+class FloodFill
+{
+public:
+    FloodFill(const TileLayer *tileLayer, const QRegion &selection)
+        : mTileLayer(tileLayer)
+        , mOrigin(tileLayer->position())
+    {
+        // The area that can be filled, in layer coordinates
+        mBounds = QRect(0, 0, tileLayer->width(), tileLayer->height());
+
+        if (!selection.isEmpty()) {
+            const QRegion localSelection = selection.translated(-mOrigin);
+            mBounds &= localSelection.boundingRect();
+
+            mDrawable.resize(mBounds.width() * mBounds.height());
+            foreach (const QRect &rect, localSelection.rects()) {
+                const QRect r = rect & mBounds;
+                for (int y = r.top(); y <= r.bottom(); ++y)
+                    mDrawable.fill(true, bitIndex(r.left(), y),
+                                   bitIndex(r.right(), y) + 1);
+            }
+        }
+
+        mVisited.resize(mBounds.width() * mBounds.height());
+    }
+
+    QRegion compute(const QPoint &fillOrigin)
+    {
+        const QPoint start = fillOrigin - mOrigin;
+        if (!mBounds.contains(start))
+            return QRegion();
+
+        mMatchCell = mTileLayer->packedCellAt(start.x(), start.y());
+
+        QVector<QPoint> seeds;
+        seeds.append(start);
+
+        while (!seeds.isEmpty()) {
+            const QPoint seed = seeds.last();
+            seeds.removeLast();
+
+            if (!matches(seed.x(), seed.y()))
+                continue;
+
+            const int y = seed.y();
+
+            // Seek as far left and right as we can
+            int left = seed.x();
+            while (left > mBounds.left() && matches(left - 1, y))
+                --left;
+
+            int right = seed.x();
+            while (right < mBounds.right() && matches(right + 1, y))
+                ++right;
+
+            mVisited.fill(true, bitIndex(left, y), bitIndex(right, y) + 1);
+            mSpans.append(Span(y, left, right));
+
+            // Add a seed for each run of matching cells above and below
+            if (y > mBounds.top())
+                addSeeds(seeds, left, right, y - 1);
+            if (y < mBounds.bottom())
+                addSeeds(seeds, left, right, y + 1);
+        }
+
+        return toRegion();
+    }
+
+private:
+    struct Span
+    {
+        Span() : y(0), left(0), right(0) {}
+        Span(int y, int left, int right) : y(y), left(left), right(right) {}
+
+        bool operator<(const Span &other) const
+        {
+            return y < other.y || (y == other.y && left < other.left);
+        }
+
+        int y;
+        int left;
+        int right;
+    };
+
+    int bitIndex(int x, int y) const
+    {
+        return (y - mBounds.top()) * mBounds.width() + (x - mBounds.left());
+    }
+
+    bool matches(int x, int y) const
+    {
+        const int index = bitIndex(x, y);
+        if (mVisited.testBit(index))
+            return false;
+        if (!mDrawable.isEmpty() && !mDrawable.testBit(index))
+            return false;
+        return mTileLayer->packedCellAt(x, y) == mMatchCell;
+    }
+
+    void addSeeds(QVector<QPoint> &seeds, int left, int right, int y) const
+    {
+        bool inRun = false;
+        for (int x = left; x <= right; ++x) {
+            const bool match = matches(x, y);
+            if (match && !inRun)
+                seeds.append(QPoint(x, y));
+            inRun = match;
+        }
+    }
+
+    /**
+     * Turns the spans into a region, merging rows with the same spans into
+     * taller rectangles like QRegion does itself.
+     */
+    QRegion toRegion()
+    {
+        if (mSpans.isEmpty())
+            return QRegion();
+
+        qSort(mSpans);
+
+        QVector<QRect> rects;
+        int bandStart = 0;      // index in rects of the last band
+
+        int i = 0;
+        while (i < mSpans.size()) {
+            const int y = mSpans.at(i).y;
+
+            // Collect the spans of this row
+            QVector<QRect> row;
+            for (; i < mSpans.size() && mSpans.at(i).y == y; ++i) {
+                const Span &span = mSpans.at(i);
+                row.append(QRect(span.left + mOrigin.x(), y + mOrigin.y(),
+                                 span.right - span.left + 1, 1));
+            }
+
+            // Extend the previous band when it ends right above this row and
+            // has the same spans
+            bool extended = false;
+            const int bandSize = rects.size() - bandStart;
+            if (bandSize == row.size() &&
+                    rects.at(bandStart).bottom() + 1 == row.first().top()) {
+                extended = true;
+                for (int j = 0; j < bandSize; ++j) {
+                    const QRect &r = rects.at(bandStart + j);
+                    if (r.left() != row.at(j).left() ||
+                            r.right() != row.at(j).right()) {
+                        extended = false;
+                        break;
+                    }
+                }
+            }
+
+            if (extended) {
+                for (int j = bandStart; j < rects.size(); ++j)
+                    rects[j].setBottom(rects[j].bottom() + 1);
+            } else {
+                bandStart = rects.size();
+                rects += row;
+            }
+        }
+
+        QRegion region;
+        region.setRects(rects.constData(), rects.size());
+        return region;
+    }
+
+    const TileLayer *mTileLayer;
+    const QPoint mOrigin;
+    QRect mBounds;
+    QBitArray mDrawable;
+    QBitArray mVisited;
+    quint32 mMatchCell;
+    QVector<Span> mSpans;
+};
+
 } // anonymous namespace
 
 
@@ -73,6 +262,17 @@ Cell TilePainter::cellAt(int x, int y) const
     return mTileLayer->cellAt(layerX, layerY);
 }
 
+quint32 TilePainter::packedCellAt(int x, int y) const
+{
+    const int layerX = x - mTileLayer->x();
+    const int layerY = y - mTileLayer->y();
+
+    if (!mTileLayer->contains(layerX, layerY))
+        return 0;
+
+    return mTileLayer->packedCellAt(layerX, layerY);
+}
+
 void TilePainter::setCell(int x, int y, const Cell &cell)
 {
     const QRegion &selection = mMapDocument->selectedArea();
@@ -186,106 +386,12 @@ void TilePainter::erase(const QRegion &region)
 
 QRegion TilePainter::computeFillRegion(const QPoint &fillOrigin) const
 {
-    // Create that region that will hold the fill
-    QRegion fillRegion;
-
     // Silently quit if parameters are unsatisfactory
     if (!isDrawable(fillOrigin.x(), fillOrigin.y()))
-        return fillRegion;
-
-    // Cache cell that we will match other cells against
-    const Cell matchCell = cellAt(fillOrigin.x(), fillOrigin.y());
-
-    // Grab map dimensions for later use.
-    const int mapWidth = mMapDocument->map()->width();
-    const int mapHeight = mMapDocument->map()->height();
-    const int mapSize = mapWidth * mapHeight;
-
-    // Create a queue to hold cells that need filling
-    QList<QPoint> fillPositions;
-    fillPositions.append(fillOrigin);
-
-    // Create an array that will store which cells have been processed
-    // This is faster than checking if a given cell is in the region/list
-    QVector<quint8> processedCellsVec(mapSize);
-    quint8 *processedCells = processedCellsVec.data();
-
-    // Loop through queued positions and fill them, while at the same time
-    // checking adjacent positions to see if they should be added
-    while (!fillPositions.empty()) {
-        const QPoint currentPoint = fillPositions.takeFirst();
-        const int startOfLine = currentPoint.y() * mapWidth;
-
-        // Seek as far left as we can
-        int left = currentPoint.x();
-        while (cellAt(left - 1, currentPoint.y()) == matchCell &&
-               isDrawable(left - 1, currentPoint.y()))
-            --left;
-
-        // Seek as far right as we can
-        int right = currentPoint.x();
-        while (cellAt(right + 1, currentPoint.y()) == matchCell &&
-               isDrawable(right + 1, currentPoint.y()))
-            ++right;
-
-        // Add cells between left and right to the region
-        fillRegion += QRegion(left, currentPoint.y(), right - left + 1, 1);
-
-        // Add cell strip to processed cells
-        memset(&processedCells[startOfLine + left],
-               1,
-               right - left);
-
-        // These variables cache whether the last cell was added to the queue
-        // or not as an optimization, since adjacent cells on the x axis
-        // do not need to be added to the queue.
-        bool lastAboveCell = false;
-        bool lastBelowCell = false;
-
-        // Loop between left and right and check if cells above or
-        // below need to be added to the queue
-        for (int x = left; x <= right; ++x) {
-            const QPoint fillPoint(x, currentPoint.y());
-
-            // Check cell above
-            if (fillPoint.y() > 0) {
-                QPoint aboveCell(fillPoint.x(), fillPoint.y() - 1);
-                if (!processedCells[aboveCell.y()*mapWidth + aboveCell.x()] &&
-                    cellAt(aboveCell.x(), aboveCell.y()) == matchCell &&
-                    isDrawable(aboveCell.x(), aboveCell.y()))
-                {
-                    // Do not add the above cell to the queue if its
-                    // x-adjacent cell was added.
-                    if (!lastAboveCell)
-                        fillPositions.append(aboveCell);
-
-                    lastAboveCell = true;
-                } else lastAboveCell = false;
-
-                processedCells[aboveCell.y() * mapWidth + aboveCell.x()] = 1;
-            }
-
-            // Check cell below
-            if (fillPoint.y() + 1 < mapHeight) {
-                QPoint belowCell(fillPoint.x(), fillPoint.y() + 1);
-                if (!processedCells[belowCell.y()*mapWidth + belowCell.x()] &&
-                    cellAt(belowCell.x(), belowCell.y()) == matchCell &&
-                    isDrawable(belowCell.x(), belowCell.y()))
-                {
-                    // Do not add the below cell to the queue if its
-                    // x-adjacent cell was added.
-                    if (!lastBelowCell)
-                        fillPositions.append(belowCell);
-
-                    lastBelowCell = true;
-                } else lastBelowCell = false;
-
-                processedCells[belowCell.y() * mapWidth + belowCell.x()] = 1;
-            }
-        }
-    }
+        return QRegion();
 
-    return fillRegion;
+    FloodFill floodFill(mTileLayer, mMapDocument->selectedArea());
+    return floodFill.compute(fillOrigin);
 }
 
 bool TilePainter::isDrawable(int x, int y) const
@@ -106,6 +106,8 @@ public:
     bool isDrawable(int x, int y) const;
 
 private:
+    quint32 packedCellAt(int x, int y) const;
+
     QRegion paintableRegion(const QRegion &region) const;
     QRegion paintableRegion(int x, int y, int width, int height) const
     { return paintableRegion(QRect(x, y, width, height)); }
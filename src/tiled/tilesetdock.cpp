@@ -206,10 +206,14 @@ static void removeTileReferences(MapDocument *mapDocument, Condition condition)
                 undoStack->push(new EraseTiles(mapDocument, tileLayer, refs));
 
         } else if (ObjectGroup *objectGroup = layer->asObjectGroup()) {
+            QList<MapObject*> objectsToRemove;
             foreach (MapObject *object, objectGroup->objects()) {
                 if (condition(object->cell()))
-                    undoStack->push(new RemoveMapObject(mapDocument, object));
+                    objectsToRemove.append(object);
             }
+            if (!objectsToRemove.isEmpty())
+                undoStack->push(new RemoveMapObjects(mapDocument,
+                                                     objectsToRemove));
         }
     }
 }
@@ -22,6 +22,7 @@
 #include "tilesetmanager.h"
 
 #include "filesystemwatcher.h"
+#include "imagecache.h"
 #include "tileanimationdriver.h"
 #include "tile.h"
 #include "tileset.h"
@@ -144,7 +145,9 @@ void TilesetManager::forceTilesetReload(Tileset *tileset)
     if (!mTilesets.contains(tileset))
         return;
 
+    // Decode the image again even when its modification time didn't change
     QString fileName = tileset->imageSource();
+    ImageCache::instance()->remove(fileName);
     if (tileset->loadFromImage(fileName))
         emit tilesetChanged(tileset);
 }
@@ -185,6 +188,11 @@ void TilesetManager::fileChanged(const QString &path)
 
 void TilesetManager::fileChangedTimeout()
 {
+    // The modification time may not have changed when the file was written
+    // several times within a second, so the cached images are dropped
+    foreach (const QString &fileName, mChangedFiles)
+        ImageCache::instance()->remove(fileName);
+
     foreach (Tileset *tileset, tilesets()) {
         QString fileName = tileset->imageSource();
         if (mChangedFiles.contains(fileName))
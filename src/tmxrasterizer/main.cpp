@@ -35,6 +35,8 @@
 #endif
 
 #include <QDebug>
+#include <QDir>
+#include <QFileInfo>
 #include <QStringList>
 
 namespace {
@@ -47,6 +49,8 @@ struct CommandLineOptions {
         , tileSize(0)
         , useAntiAliasing(false)
         , ignoreVisibility(false)
+        , pyramidTileSize(0)
+        , threadCount(0)
     {}
 
     bool showHelp;
@@ -57,6 +61,10 @@ struct CommandLineOptions {
     int tileSize;
     bool useAntiAliasing;
     bool ignoreVisibility;
+    int pyramidTileSize;
+    QString batchOutputDirectory;
+    QStringList files;
+    int threadCount;
     QStringList layersToHide;
 };
 
@@ -68,6 +76,8 @@ static void showHelp()
     qWarning() <<
             "Usage:\n"
             "  tmxrasterizer [options] [input file] [output file]\n"
+            "  tmxrasterizer --pyramid [options] [input file] [output directory]\n"
+            "  tmxrasterizer --batch [output directory] [options] [input files or directories]\n"
             "\n"
             "Options:\n"
             "  -h --help               : Display this help\n"
@@ -79,7 +89,17 @@ static void showHelp()
             "     --ignore-visibility  : Ignore all layer visibility flags in the map file, and render all\n"
             "                            layers in the output (default is to omit invisible layers)\n"
             "     --hide-layer         : Specifies a layer to omit from the output image\n"
-            "                            Can be repeated to hide multiple layers\n";
+            "                            Can be repeated to hide multiple layers\n"
+            "  -p --pyramid            : Render a pyramid of 256x256 image tiles in z/x/y.png layout\n"
+            "                            into the output directory, instead of a single image\n"
+            "     --pyramid-tile-size SIZE : The size of the image tiles in pyramid mode\n"
+            "                            Implies --pyramid\n"
+            "  -b --batch DIRECTORY    : Render all given maps into the output directory, using\n"
+            "                            multiple threads. Directories are searched for *.tmx files.\n"
+            "                            Subdirectories of the maps are kept in the output directory.\n"
+            "                            External tilesets are only loaded once\n"
+            "  -j --jobs COUNT         : The number of maps rendered at the same time in batch mode\n"
+            "                            (default: the number of cores)\n";
 }
 
 static void showVersion()
@@ -132,6 +152,42 @@ static void parseCommandLineArguments(CommandLineOptions &options)
             } else {
                 options.layersToHide.append(arguments.at(i));
             }
+        } else if (arg == QLatin1String("--pyramid")
+                || arg == QLatin1String("-p")) {
+            if (options.pyramidTileSize == 0)
+                options.pyramidTileSize = 256;
+        } else if (arg == QLatin1String("--pyramid-tile-size")) {
+            i++;
+            if (i >= arguments.size()) {
+                options.showHelp = true;
+            } else {
+                bool tileSizeIsInt;
+                options.pyramidTileSize = arguments.at(i).toInt(&tileSizeIsInt);
+                if (!tileSizeIsInt || options.pyramidTileSize <= 0) {
+                    qWarning() << arguments.at(i) << ": the specified pyramid tile size is not a positive integer.";
+                    options.showHelp = true;
+                }
+            }
+        } else if (arg == QLatin1String("--batch")
+                || arg == QLatin1String("-b")) {
+            i++;
+            if (i >= arguments.size())
+                options.showHelp = true;
+            else
+                options.batchOutputDirectory = arguments.at(i);
+        } else if (arg == QLatin1String("--jobs")
+                || arg == QLatin1String("-j")) {
+            i++;
+            if (i >= arguments.size()) {
+                options.showHelp = true;
+            } else {
+                bool countIsInt;
+                options.threadCount = arguments.at(i).toInt(&countIsInt);
+                if (!countIsInt || options.threadCount <= 0) {
+                    qWarning() << arguments.at(i) << ": the specified job count is not a positive integer.";
+                    options.showHelp = true;
+                }
+            }
         } else if (arg == QLatin1String("--anti-aliasing")
                 || arg == QLatin1String("-a")) {
             options.useAntiAliasing = true;
@@ -142,15 +198,45 @@ static void parseCommandLineArguments(CommandLineOptions &options)
         } else if (arg.at(0) == QLatin1Char('-')) {
             qWarning() << "Unknown option" << arg;
             options.showHelp = true;
-        } else if (options.fileToOpen.isEmpty()) {
-            options.fileToOpen = arg;
-        } else if (options.fileToSave.isEmpty()) {
-            options.fileToSave = arg;
         } else {
-            // All args are already defined. Show help.
-            options.showHelp = true;
+            options.files.append(arg);
         }
     }
+
+    if (!options.batchOutputDirectory.isEmpty())
+        return;
+
+    if (options.files.size() > 2) {
+        // All args are already defined. Show help.
+        options.showHelp = true;
+    }
+    if (options.files.size() > 0)
+        options.fileToOpen = options.files.at(0);
+    if (options.files.size() > 1)
+        options.fileToSave = options.files.at(1);
+    options.files.clear();
+}
+
+/**
+ * Expands the given list of maps and directories to a list of maps, by
+ * searching each directory for TMX files.
+ */
+static QStringList findMaps(const QStringList &files)
+{
+    QStringList maps;
+    foreach (const QString &file, files) {
+        const QFileInfo fileInfo(file);
+        if (fileInfo.isDir()) {
+            const QDir dir(file);
+            const QStringList nameFilters(QLatin1String("*.tmx"));
+            foreach (const QString &map, dir.entryList(nameFilters, QDir::Files,
+                                                       QDir::Name))
+                maps.append(dir.filePath(map));
+        } else {
+            maps.append(file);
+        }
+    }
+    return maps;
 }
 
 int main(int argc, char *argv[])
@@ -172,7 +258,9 @@ int main(int argc, char *argv[])
         showVersion();
         return 0;
     }
-    if (options.showHelp || options.fileToOpen.isEmpty() || options.fileToSave.isEmpty()) {
+    const bool batch = !options.batchOutputDirectory.isEmpty();
+    if (options.showHelp || (batch && options.files.isEmpty()) ||
+            (!batch && (options.fileToOpen.isEmpty() || options.fileToSave.isEmpty()))) {
         showHelp();
         return 0;
     }
@@ -185,6 +273,7 @@ int main(int argc, char *argv[])
     w.setAntiAliasing(options.useAntiAliasing);
     w.setIgnoreVisibility(options.ignoreVisibility);
     w.setLayersToHide(options.layersToHide);
+    w.setPyramidTileSize(options.pyramidTileSize);
 
 
     if (options.tileSize > 0) {
@@ -193,6 +282,13 @@ int main(int argc, char *argv[])
         w.setScale(options.scale);
     }
 
+    if (batch) {
+        const QStringList maps = findMaps(options.files);
+        const int failures = w.renderBatch(maps, options.batchOutputDirectory,
+                                           options.threadCount);
+        return failures > 0 ? 1 : 0;
+    }
+
     return w.render(options.fileToOpen, options.fileToSave);
 }
 
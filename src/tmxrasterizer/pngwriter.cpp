@@ -0,0 +1,284 @@
+/*
+ * pngwriter.cpp
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of the TMX Rasterizer.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "pngwriter.h"
+
+#include <QIODevice>
+#include <QImage>
+#include <QtEndian>
+
+#include <cstdlib>
+
+using namespace Tiled;
+
+namespace {
+
+const int BytesPerPixel = 4;
+const int IdatChunkSize = 64 * 1024;
+
+enum FilterType {
+    FilterNone,
+    FilterSub,
+    FilterUp,
+    FilterAverage,
+    FilterPaeth,
+    FilterTypeCount
+};
+
+class CrcTable
+{
+public:
+    CrcTable()
+    {
+        for (quint32 n = 0; n < 256; ++n) {
+            quint32 c = n;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            mTable[n] = c;
+        }
+    }
+
+    quint32 update(quint32 crc, const char *data, int size) const
+    {
+        const uchar *bytes = reinterpret_cast<const uchar*>(data);
+        for (int i = 0; i < size; ++i)
+            crc = mTable[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+        return crc;
+    }
+
+private:
+    quint32 mTable[256];
+};
+
+const CrcTable crcTable;
+
+inline uchar paethPredictor(int a, int b, int c)
+{
+    const int p = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+
+    if (pa <= pb && pa <= pc)
+        return uchar(a);
+    if (pb <= pc)
+        return uchar(b);
+    return uchar(c);
+}
+
+/**
+ * Applies the given filter to the \a row and stores the result, including
+ * the leading filter type byte, in \a out. Returns the sum of the filtered
+ * bytes interpreted as signed values, which is used as a heuristic to pick
+ * the filter that compresses best.
+ */
+int filterRow(FilterType type,
+              const uchar *row, const uchar *previous, int size,
+              uchar *out)
+{
+    out[0] = uchar(type);
+    ++out;
+
+    int sum = 0;
+
+    for (int i = 0; i < size; ++i) {
+        const int left = i >= BytesPerPixel ? row[i - BytesPerPixel] : 0;
+        const int up = previous[i];
+        const int upLeft = i >= BytesPerPixel ? previous[i - BytesPerPixel] : 0;
+
+        uchar value = row[i];
+        switch (type) {
+        case FilterNone:    break;
+        case FilterSub:     value -= left; break;
+        case FilterUp:      value -= up; break;
+        case FilterAverage: value -= (left + up) / 2; break;
+        case FilterPaeth:   value -= paethPredictor(left, up, upLeft); break;
+        case FilterTypeCount: break;
+        }
+
+        out[i] = value;
+        sum += std::abs(int(static_cast<signed char>(value)));
+    }
+
+    return sum;
+}
+
+void appendUInt32(QByteArray &data, quint32 value)
+{
+    uchar bytes[4];
+    qToBigEndian(value, bytes);
+    data.append(reinterpret_cast<const char*>(bytes), 4);
+}
+
+} // anonymous namespace
+
+/**
+ * Starts writing a PNG image of the given \a size to the \a device. The
+ * image is written with 8-bit RGBA pixels.
+ */
+PngWriter::PngWriter(QIODevice *device, const QSize &size)
+    : mDevice(device)
+    , mSize(size)
+    , mRowsWritten(0)
+    , mError(size.isEmpty())
+    , mCompressor(Zlib)
+{
+    static const char signature[] = "\x89PNG\r\n\x1a\n";
+    if (mDevice->write(signature, 8) != 8)
+        mError = true;
+
+    QByteArray header;
+    appendUInt32(header, size.width());
+    appendUInt32(header, size.height());
+    header.append(char(8));     // bit depth
+    header.append(char(6));     // color type (RGBA)
+    header.append(char(0));     // compression method (deflate)
+    header.append(char(0));     // filter method (adaptive)
+    header.append(char(0));     // interlace method (none)
+
+    if (!writeChunk("IHDR", header))
+        mError = true;
+
+    const int rowSize = size.width() * BytesPerPixel;
+    mPreviousRow.fill(0, rowSize);
+    mCurrentRow.resize(rowSize);
+    mFilteredRow.resize(rowSize + 1);
+    mBestRow.resize(rowSize + 1);
+}
+
+bool PngWriter::writeRows(const QImage &image)
+{
+    if (mError)
+        return false;
+
+    if (image.width() != mSize.width() ||
+            mRowsWritten + image.height() > mSize.height()) {
+        mError = true;
+        return false;
+    }
+
+    const QImage rows = image.format() == QImage::Format_ARGB32
+            ? image : image.convertToFormat(QImage::Format_ARGB32);
+
+    const int rowSize = mCurrentRow.size();
+
+    for (int y = 0; y < rows.height(); ++y) {
+        const QRgb *pixels = reinterpret_cast<const QRgb*>(rows.constScanLine(y));
+        uchar *current = reinterpret_cast<uchar*>(mCurrentRow.data());
+
+        for (int x = 0; x < mSize.width(); ++x) {
+            const QRgb pixel = pixels[x];
+            *current++ = uchar(qRed(pixel));
+            *current++ = uchar(qGreen(pixel));
+            *current++ = uchar(qBlue(pixel));
+            *current++ = uchar(qAlpha(pixel));
+        }
+
+        const uchar *row = reinterpret_cast<const uchar*>(mCurrentRow.constData());
+        const uchar *previous = reinterpret_cast<const uchar*>(mPreviousRow.constData());
+
+        // Pick the filter with the lowest sum of absolute differences
+        int bestSum = -1;
+        for (int type = FilterNone; type < FilterTypeCount; ++type) {
+            const int sum = filterRow(FilterType(type), row, previous, rowSize,
+                                      reinterpret_cast<uchar*>(mFilteredRow.data()));
+            if (bestSum == -1 || sum < bestSum) {
+                bestSum = sum;
+                qSwap(mBestRow, mFilteredRow);
+            }
+        }
+
+        if (!mCompressor.compress(mBestRow.constData(), mBestRow.size(),
+                                  &mCompressed)) {
+            mError = true;
+            return false;
+        }
+
+        qSwap(mPreviousRow, mCurrentRow);
+        ++mRowsWritten;
+
+        if (!flushData(false))
+            return false;
+    }
+
+    return true;
+}
+
+bool PngWriter::finish()
+{
+    if (mError)
+        return false;
+
+    if (mRowsWritten != mSize.height() || !mCompressor.finish(&mCompressed)) {
+        mError = true;
+        return false;
+    }
+
+    if (!flushData(true) || !writeChunk("IEND", QByteArray())) {
+        mError = true;
+        return false;
+    }
+
+    return true;
+}
+
+bool PngWriter::writeChunk(const char *type, const QByteArray &data)
+{
+    QByteArray chunk;
+    chunk.reserve(data.size() + 12);
+    appendUInt32(chunk, data.size());
+    chunk.append(type, 4);
+    chunk.append(data);
+
+    const quint32 crc = crcTable.update(0xffffffffu,
+                                        chunk.constData() + 4,
+                                        data.size() + 4) ^ 0xffffffffu;
+    appendUInt32(chunk, crc);
+
+    return mDevice->write(chunk) == chunk.size();
+}
+
+/**
+ * Writes the compressed data collected so far as IDAT chunks. Unless
+ * \a force is set, only full chunks are written.
+ */
+bool PngWriter::flushData(bool force)
+{
+    while (mCompressed.size() >= IdatChunkSize ||
+           (force && !mCompressed.isEmpty())) {
+        const int size = qMin(mCompressed.size(), IdatChunkSize);
+        if (!writeChunk("IDAT", mCompressed.left(size))) {
+            mError = true;
+            return false;
+        }
+        mCompressed.remove(0, size);
+    }
+
+    return true;
+}
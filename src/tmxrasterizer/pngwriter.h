@@ -0,0 +1,80 @@
+/*
+ * pngwriter.h
+ * Copyright 2026, agent <agent@local>
+ *
+ * This file is part of the TMX Rasterizer.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PNGWRITER_H
+#define PNGWRITER_H
+
+#include "compression.h"
+
+#include <QByteArray>
+#include <QSize>
+
+class QImage;
+class QIODevice;
+
+/**
+ * Writes a PNG image to a device row by row, so that the whole image never
+ * needs to be held in memory. The rows are filtered and compressed as they
+ * are written.
+ */
+class PngWriter
+{
+public:
+    PngWriter(QIODevice *device, const QSize &size);
+
+    /**
+     * Appends all rows of the given \a image, which needs to have the width
+     * of the PNG image.
+     */
+    bool writeRows(const QImage &image);
+
+    /**
+     * Writes the remaining compressed data and the end of the PNG stream.
+     * Fails when fewer rows than the height of the image were written.
+     */
+    bool finish();
+
+private:
+    Q_DISABLE_COPY(PngWriter)
+
+    bool writeChunk(const char *type, const QByteArray &data);
+    bool flushData(bool force);
+
+    QIODevice *mDevice;
+    QSize mSize;
+    int mRowsWritten;
+    bool mError;
+    Tiled::Compressor mCompressor;
+    QByteArray mPreviousRow;
+    QByteArray mCurrentRow;
+    QByteArray mFilteredRow;
+    QByteArray mBestRow;
+    QByteArray mCompressed;
+};
+
+#endif // PNGWRITER_H
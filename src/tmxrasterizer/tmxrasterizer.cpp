@@ -28,6 +28,8 @@
 
 #include "tmxrasterizer.h"
 
+#include "pngwriter.h"
+
 #include "hexagonalrenderer.h"
 #include "imagelayer.h"
 #include "isometricrenderer.h"
@@ -36,23 +38,190 @@
 #include "objectgroup.h"
 #include "orthogonalrenderer.h"
 #include "staggeredrenderer.h"
+#include "threadsupport.h"
+#include "tile.h"
 #include "tilelayer.h"
+#include "tileset.h"
 
-
+#include <QAtomicInt>
 #include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QRunnable>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QtCore/qmath.h>
 
 using namespace Tiled;
 
+/**
+ * Shares external tilesets between the maps rendered by a TmxRasterizer, so
+ * that they are only parsed once. Images are shared through the ImageCache.
+ * Can be used from multiple threads at the same time.
+ */
+class TilesetCache
+{
+public:
+    ~TilesetCache()
+    {
+        qDeleteAll(mTilesets);
+    }
+
+    Tileset *tileset(const QString &source) const
+    {
+        QMutexLocker locker(&mMutex);
+        return mTilesets.value(source);
+    }
+
+    /**
+     * Adds the \a tileset loaded from \a source, unless another thread has
+     * already added it in the meantime. Returns the cached tileset.
+     */
+    Tileset *addTileset(const QString &source, Tileset *tileset)
+    {
+        // Make sure nothing is initialized lazily while rendering, since the
+        // tileset is used by several threads at the same time
+        tileset->updateAtlas();
+        tileset->updateAverageColors();
+        foreach (const Tile *tile, tileset->tiles())
+            if (tile->atlasRect().isNull())
+                tile->image();
+
+        QMutexLocker locker(&mMutex);
+        if (Tileset *existing = mTilesets.value(source)) {
+            delete tileset;
+            return existing;
+        }
+
+        mTilesets.insert(source, tileset);
+        mCachedTilesets.insert(tileset);
+        return tileset;
+    }
+
+    bool contains(Tileset *tileset) const
+    {
+        QMutexLocker locker(&mMutex);
+        return mCachedTilesets.contains(tileset);
+    }
+
+private:
+    mutable QMutex mMutex;
+    QHash<QString, Tileset*> mTilesets;
+    QSet<Tileset*> mCachedTilesets;
+};
+
+namespace {
+
+// The approximate amount of memory used by each band of a banded PNG image
+const int MaxBandBytes = 16 * 1024 * 1024;
+
+class RasterizerMapReader : public MapReader
+{
+public:
+    explicit RasterizerMapReader(TilesetCache *cache)
+        : mCache(cache)
+    {}
+
+protected:
+    /**
+     * Overridden to make sure the resolved reference is a clean path, which
+     * is used as the key in the cache.
+     */
+    QString resolveReference(const QString &reference, const QString &mapPath)
+    {
+        QString resolved = MapReader::resolveReference(reference, mapPath);
+        return QDir::cleanPath(resolved);
+    }
+
+    /**
+     * Overridden to share external tilesets between maps. The tileset is
+     * owned by the cache.
+     */
+    Tileset *readExternalTileset(const QString &source, QString *error)
+    {
+        if (Tileset *tileset = mCache->tileset(source))
+            return tileset;
+
+        RasterizerMapReader reader(mCache);
+        Tileset *tileset = reader.readTileset(source);
+        if (!tileset) {
+            *error = reader.errorString();
+            return 0;
+        }
+
+        return mCache->addTileset(source, tileset);
+    }
+
+private:
+    TilesetCache *mCache;
+};
+
+class RenderTask : public QRunnable
+{
+public:
+    RenderTask(TmxRasterizer *rasterizer,
+               const QString &mapFileName,
+               const QString &imageFileName,
+               QAtomicInt *failures)
+        : mRasterizer(rasterizer)
+        , mMapFileName(mapFileName)
+        , mImageFileName(imageFileName)
+        , mFailures(failures)
+    {}
+
+    void run()
+    {
+        if (mRasterizer->render(mMapFileName, mImageFileName) != 0)
+            mFailures->ref();
+    }
+
+private:
+    TmxRasterizer *mRasterizer;
+    const QString mMapFileName;
+    const QString mImageFileName;
+    QAtomicInt *mFailures;
+};
+
+/**
+ * Returns the deepest directory containing all of the given absolute
+ * directory \a paths.
+ */
+QString commonParentPath(const QStringList &paths)
+{
+    QStringList common = paths.first().split(QLatin1Char('/'));
+
+    foreach (const QString &path, paths) {
+        const QStringList parts = path.split(QLatin1Char('/'));
+        int matching = 0;
+        while (matching < common.size() && matching < parts.size() &&
+               common.at(matching) == parts.at(matching))
+            ++matching;
+        common = common.mid(0, matching);
+    }
+
+    const QString commonPath = common.join(QLatin1String("/"));
+    return commonPath.isEmpty() ? QLatin1String("/") : commonPath;
+}
+
+} // anonymous namespace
+
 TmxRasterizer::TmxRasterizer():
     mScale(1.0),
     mTileSize(0),
     mUseAntiAliasing(true),
-    mIgnoreVisibility(false)
+    mIgnoreVisibility(false),
+    mPyramidTileSize(0),
+    mTilesetCache(new TilesetCache)
 {
 }
 
 TmxRasterizer::~TmxRasterizer()
 {
+    delete mTilesetCache;
 }
 
 bool TmxRasterizer::shouldDrawLayer(Layer *layer)
@@ -74,7 +243,7 @@ int TmxRasterizer::render(const QString &mapFileName,
 {
     Map *map;
     MapRenderer *renderer;
-    MapReader reader;
+    RasterizerMapReader reader(mTilesetCache);
     map = reader.readMap(mapFileName);
     if (!map) {
         qWarning().nospace() << "Error while reading " << mapFileName << ":\n"
@@ -107,21 +276,153 @@ int TmxRasterizer::render(const QString &mapFileName,
         xScale = yScale = mScale;
     }
 
-    QSize mapSize = renderer->mapSize();
-    mapSize.rwidth() *= xScale;
-    mapSize.rheight() *= yScale;
+    const int result = mPyramidTileSize > 0
+            ? renderPyramid(map, renderer, xScale, yScale, imageFileName)
+            : renderImage(map, renderer, xScale, yScale, imageFileName);
 
-    QImage image(mapSize, QImage::Format_ARGB32);
-    image.fill(Qt::transparent);
-    QPainter painter(&image);
+    delete renderer;
+    foreach (Tileset *tileset, map->tilesets())
+        if (!mTilesetCache->contains(tileset))
+            delete tileset;
+    delete map;
+
+    return result;
+}
+
+/**
+ * Renders each of the given maps to an image with the same base name in the
+ * \a outputDirectory, or to a subdirectory of it in pyramid mode. The maps
+ * are rendered concurrently using \a threadCount threads, or the ideal
+ * thread count when 0 is given.
+ *
+ * The directory structure below the common parent directory of the maps is
+ * kept in the output directory. When two maps would still be rendered to
+ * the same output, nothing is rendered.
+ *
+ * Returns the number of maps that failed to render.
+ */
+int TmxRasterizer::renderBatch(const QStringList &mapFileNames,
+                               const QString &outputDirectory,
+                               int threadCount)
+{
+    const QDir dir(outputDirectory);
+    if (!dir.mkpath(QLatin1String("."))) {
+        qWarning().nospace() << "Error while creating directory "
+                             << outputDirectory;
+        return mapFileNames.size();
+    }
+
+    if (mapFileNames.isEmpty())
+        return 0;
+
+    QStringList mapDirectories;
+    foreach (const QString &mapFileName, mapFileNames)
+        mapDirectories.append(QFileInfo(mapFileName).absolutePath());
+
+    const QDir commonDir(commonParentPath(mapDirectories));
+
+    QStringList imageFileNames;
+    QHash<QString, QString> outputToMap;
+    int collisions = 0;
+
+    for (int i = 0; i < mapFileNames.size(); ++i) {
+        const QString &mapFileName = mapFileNames.at(i);
+        const QString relativeDir = commonDir.relativeFilePath(mapDirectories.at(i));
+
+        QString outputName = QFileInfo(mapFileName).completeBaseName();
+        if (mPyramidTileSize == 0)
+            outputName += QLatin1String(".png");
+        if (!relativeDir.isEmpty() && relativeDir != QLatin1String("."))
+            outputName = relativeDir + QLatin1Char('/') + outputName;
+
+        const QString imageFileName = QDir::cleanPath(dir.filePath(outputName));
+
+        // Maps in the same directory may still share their base name
+        const QHash<QString, QString>::const_iterator it =
+                outputToMap.constFind(imageFileName);
+        if (it != outputToMap.constEnd()) {
+            qWarning().nospace() << "Error: " << mapFileName << " and "
+                                 << it.value() << " would both be rendered to "
+                                 << imageFileName;
+            ++collisions;
+        } else {
+            outputToMap.insert(imageFileName, mapFileName);
+        }
+
+        imageFileNames.append(imageFileName);
+    }
+
+    if (collisions > 0)
+        return mapFileNames.size();
+
+    // Create the directories for maps from subdirectories up front, rather
+    // than from several threads
+    if (mPyramidTileSize == 0) {
+        foreach (const QString &imageFileName, imageFileNames) {
+            const QString imageDir = QFileInfo(imageFileName).absolutePath();
+            if (!dir.mkpath(imageDir)) {
+                qWarning().nospace() << "Error while creating directory "
+                                     << imageDir;
+                return mapFileNames.size();
+            }
+        }
+    }
+
+    if (threadCount <= 0)
+        threadCount = QThread::idealThreadCount();
+
+    if (threadCount > 1 && !canUsePixmapsInThreads()) {
+        qWarning() << "Pixmaps are not supported outside of the GUI thread"
+                      " on this platform, rendering maps sequentially.";
+        threadCount = 1;
+    }
+
+    int failures = 0;
+
+    if (threadCount <= 1) {
+        for (int i = 0; i < mapFileNames.size(); ++i)
+            if (render(mapFileNames.at(i), imageFileNames.at(i)) != 0)
+                ++failures;
+        return failures;
+    }
+
+    QAtomicInt failureCount(0);
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount);
+
+    for (int i = 0; i < mapFileNames.size(); ++i)
+        pool.start(new RenderTask(this, mapFileNames.at(i),
+                                  imageFileNames.at(i), &failureCount));
+
+    pool.waitForDone();
+
+#if QT_VERSION >= 0x050000
+    failures = failureCount.load();
+#else
+    failures = failureCount;
+#endif
+    return failures;
+}
 
+void TmxRasterizer::setupPainter(QPainter &painter,
+                                 qreal xScale, qreal yScale) const
+{
     if (xScale != qreal(1) || yScale != qreal(1)) {
         if (mUseAntiAliasing) {
             painter.setRenderHints(QPainter::SmoothPixmapTransform |
                                    QPainter::Antialiasing);
         }
-        painter.setTransform(QTransform::fromScale(xScale, yScale));
+        painter.scale(xScale, yScale);
     }
+}
+
+/**
+ * Draws the layers of the \a map that should be drawn. When given, only the
+ * \a exposed rectangle (in map pixels) is drawn.
+ */
+void TmxRasterizer::drawMap(QPainter &painter, Map *map,
+                            MapRenderer *renderer, const QRectF &exposed)
+{
     // Perform a similar rendering than found in saveasimagedialog.cpp
     foreach (Layer *layer, map->layers()) {
 
@@ -135,18 +436,234 @@ int TmxRasterizer::render(const QString &mapFileName,
         const ImageLayer *imageLayer = dynamic_cast<const ImageLayer*>(layer);
 
         if (tileLayer) {
-            renderer->drawTileLayer(&painter, tileLayer);
+            renderer->drawTileLayer(&painter, tileLayer, exposed);
         } else if (imageLayer) {
-            renderer->drawImageLayer(&painter, imageLayer);
+            renderer->drawImageLayer(&painter, imageLayer, exposed);
         }
     }
+}
+
+/**
+ * Renders the map to a single image. PNG images are rendered and written in
+ * horizontal bands, so that only a single band needs to be kept in memory
+ * regardless of the height of the map. Other formats are rendered to a full
+ * image before saving it.
+ */
+int TmxRasterizer::renderImage(Map *map, MapRenderer *renderer,
+                               qreal xScale, qreal yScale,
+                               const QString &imageFileName)
+{
+    QSize mapSize = renderer->mapSize();
+    mapSize.rwidth() *= xScale;
+    mapSize.rheight() *= yScale;
+
+    if (QFileInfo(imageFileName).suffix().compare(QLatin1String("png"),
+                                                  Qt::CaseInsensitive) == 0) {
+        return renderBandedPng(map, renderer, xScale, yScale,
+                               mapSize, imageFileName);
+    }
+
+    QImage image(mapSize, QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+
+    setupPainter(painter, xScale, yScale);
+    drawMap(painter, map, renderer);
+    painter.end();
 
     // Save image
     image.save(imageFileName);
 
-    delete renderer;
-    qDeleteAll(map->tilesets());
-    delete map;
+    return 0;
+}
+
+/**
+ * Renders the map to a PNG image of the given \a size, one band of rows at a
+ * time. Each band is encoded and written to the file before the next one is
+ * rendered.
+ */
+int TmxRasterizer::renderBandedPng(Map *map, MapRenderer *renderer,
+                                   qreal xScale, qreal yScale,
+                                   const QSize &size,
+                                   const QString &imageFileName)
+{
+    QFile file(imageFileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning().nospace() << "Error while writing " << imageFileName
+                             << ": " << file.errorString();
+        return 1;
+    }
+
+    const int bandHeight = qBound(1, MaxBandBytes / qMax(1, size.width() * 4),
+                                  qMax(1, size.height()));
+
+    PngWriter writer(&file, size);
+
+    for (int top = 0; top < size.height(); top += bandHeight) {
+        const int height = qMin(bandHeight, size.height() - top);
+
+        QImage band(size.width(), height, QImage::Format_ARGB32_Premultiplied);
+        band.fill(0);
+
+        QPainter painter(&band);
+        painter.translate(0, -top);
+        setupPainter(painter, xScale, yScale);
+
+        const QRectF exposed = painter.transform().inverted()
+                .mapRect(QRectF(band.rect()));
+
+        drawMap(painter, map, renderer, exposed);
+        painter.end();
+
+        if (!writer.writeRows(band))
+            break;
+    }
+
+    if (!writer.finish()) {
+        qWarning().nospace() << "Error while writing " << imageFileName;
+        file.close();
+        file.remove();
+        return 1;
+    }
 
     return 0;
 }
+
+/**
+ * Renders the map as a pyramid of image tiles into the given \a directory,
+ * using the z/x/y.png layout common to web map viewers. The most detailed
+ * zoom level shows the map at the requested scale, and each level below it
+ * is downsampled by half from the tiles of the level above, until the whole
+ * map fits in a single tile at zoom level 0.
+ *
+ * Only a few image tiles are kept in memory at any time, regardless of the
+ * size of the map. Image tiles that are fully transparent are not written,
+ * and are removed when they exist from an earlier run.
+ */
+int TmxRasterizer::renderPyramid(Map *map, MapRenderer *renderer,
+                                 qreal xScale, qreal yScale,
+                                 const QString &directory)
+{
+    const int tileSize = mPyramidTileSize;
+    const QSize mapSize = renderer->mapSize();
+    const int width = qCeil(mapSize.width() * xScale);
+    const int height = qCeil(mapSize.height() * yScale);
+
+    int maxZoom = 0;
+    while ((qint64(tileSize) << maxZoom) < qMax(width, height))
+        ++maxZoom;
+
+    const QDir dir(directory);
+    if (!dir.mkpath(QLatin1String("."))) {
+        qWarning().nospace() << "Error while creating directory "
+                             << directory;
+        return 1;
+    }
+
+    // Render the most detailed zoom level directly from the map
+    const int columns = (width + tileSize - 1) / tileSize;
+    const int rows = (height + tileSize - 1) / tileSize;
+
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < columns; ++x) {
+            QImage image(tileSize, tileSize,
+                         QImage::Format_ARGB32_Premultiplied);
+            image.fill(0);
+
+            QPainter painter(&image);
+            painter.translate(-x * tileSize, -y * tileSize);
+            setupPainter(painter, xScale, yScale);
+
+            const QRectF exposed = painter.transform().inverted()
+                    .mapRect(QRectF(image.rect()));
+
+            drawMap(painter, map, renderer, exposed);
+            painter.end();
+
+            if (!saveTile(image, dir, maxZoom, x, y))
+                return 1;
+        }
+    }
+
+    // Downsample each zoom level from the tiles of the level above
+    for (int zoom = maxZoom - 1; zoom >= 0; --zoom) {
+        const int levelTileSize = tileSize << (maxZoom - zoom);
+        const int levelColumns = (width + levelTileSize - 1) / levelTileSize;
+        const int levelRows = (height + levelTileSize - 1) / levelTileSize;
+        const qreal half = tileSize / 2.0;
+
+        for (int y = 0; y < levelRows; ++y) {
+            for (int x = 0; x < levelColumns; ++x) {
+                QImage image(tileSize, tileSize,
+                             QImage::Format_ARGB32_Premultiplied);
+                image.fill(0);
+
+                QPainter painter(&image);
+                painter.setRenderHint(QPainter::SmoothPixmapTransform);
+
+                for (int dy = 0; dy < 2; ++dy) {
+                    for (int dx = 0; dx < 2; ++dx) {
+                        const QString fileName =
+                                QString(QLatin1String("%1/%2/%3.png"))
+                                .arg(zoom + 1)
+                                .arg(x * 2 + dx)
+                                .arg(y * 2 + dy);
+
+                        const QImage child(dir.filePath(fileName));
+                        if (!child.isNull()) {
+                            painter.drawImage(QRectF(dx * half, dy * half,
+                                                     half, half),
+                                              child);
+                        }
+                    }
+                }
+
+                painter.end();
+
+                if (!saveTile(image, dir, zoom, x, y))
+                    return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static bool isTransparent(const QImage &image)
+{
+    for (int y = 0; y < image.height(); ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for (int x = 0; x < image.width(); ++x)
+            if (qAlpha(line[x]) != 0)
+                return false;
+    }
+    return true;
+}
+
+bool TmxRasterizer::saveTile(const QImage &image, const QDir &directory,
+                             int zoom, int x, int y) const
+{
+    const QString path = QString(QLatin1String("%1/%2")).arg(zoom).arg(x);
+    const QString fileName = QString(QLatin1String("%1/%2.png"))
+            .arg(path).arg(y);
+
+    if (isTransparent(image)) {
+        // Remove any tile left by an earlier run, since the next zoom level
+        // is downsampled from the files that exist
+        if (directory.exists(fileName) && !directory.remove(fileName)) {
+            qWarning().nospace() << "Error while removing "
+                                 << directory.filePath(fileName);
+            return false;
+        }
+        return true;
+    }
+
+    if (!directory.mkpath(path) ||
+            !image.save(directory.filePath(fileName), "PNG")) {
+        qWarning().nospace() << "Error while writing "
+                             << directory.filePath(fileName);
+        return false;
+    }
+
+    return true;
+}
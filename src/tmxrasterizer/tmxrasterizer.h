@@ -34,6 +34,19 @@
 #include <QString>
 #include <QStringList>
 
+class QDir;
+class QImage;
+class QPainter;
+class QRectF;
+class QSize;
+
+namespace Tiled {
+class Map;
+class MapRenderer;
+}
+
+class TilesetCache;
+
 using namespace Tiled;
 
 class TmxRasterizer
@@ -47,24 +60,55 @@ public:
     int tileSize() const { return mTileSize; }
     bool useAntiAliasing() const { return mUseAntiAliasing; }
     bool IgnoreVisibility() const { return mIgnoreVisibility; }
+    int pyramidTileSize() const { return mPyramidTileSize; }
 
     void setScale(qreal scale) { mScale = scale; }
     void setTileSize(int tileSize) { mTileSize = tileSize; }
     void setAntiAliasing(bool useAntiAliasing) { mUseAntiAliasing = useAntiAliasing; }
     void setIgnoreVisibility(bool IgnoreVisibility) { mIgnoreVisibility = IgnoreVisibility; }
 
+    /**
+     * Sets the size of the image tiles rendered in pyramid mode. When larger
+     * than 0, render() writes a pyramid of image tiles into the output
+     * directory instead of a single image.
+     */
+    void setPyramidTileSize(int tileSize) { mPyramidTileSize = tileSize; }
+
     void setLayersToHide(QStringList layersToHide) { mLayersToHide = layersToHide; }
 
     int render(const QString &mapFileName, const QString &imageFileName);
+    int renderBatch(const QStringList &mapFileNames,
+                    const QString &outputDirectory,
+                    int threadCount = 0);
 
 private:
+    Q_DISABLE_COPY(TmxRasterizer)
+
     qreal mScale;
     int mTileSize;
     bool mUseAntiAliasing;
     bool mIgnoreVisibility;
+    int mPyramidTileSize;
     QStringList mLayersToHide;
+    TilesetCache *mTilesetCache;
 
     bool shouldDrawLayer(Layer *layer);
+    void setupPainter(QPainter &painter, qreal xScale, qreal yScale) const;
+    void drawMap(QPainter &painter, Map *map, MapRenderer *renderer,
+                 const QRectF &exposed = QRectF());
+
+    int renderImage(Map *map, MapRenderer *renderer,
+                    qreal xScale, qreal yScale,
+                    const QString &imageFileName);
+    int renderBandedPng(Map *map, MapRenderer *renderer,
+                        qreal xScale, qreal yScale,
+                        const QSize &size,
+                        const QString &imageFileName);
+    int renderPyramid(Map *map, MapRenderer *renderer,
+                      qreal xScale, qreal yScale,
+                      const QString &directory);
+    bool saveTile(const QImage &image, const QDir &directory,
+                  int zoom, int x, int y) const;
 
 };
 
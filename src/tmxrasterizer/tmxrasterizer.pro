@@ -33,9 +33,11 @@ macx {
 }
 
 SOURCES += main.cpp \
+         pngwriter.cpp \
          tmxrasterizer.cpp
 
-HEADERS += tmxrasterizer.h
+HEADERS += pngwriter.h \
+         tmxrasterizer.h
 
 manpage.path = $${PREFIX}/share/man/man1/
 manpage.files += ../../docs/tmxrasterizer.1
@@ -0,0 +1,72 @@
+include(../../src/libtiled/libtiled.pri)
+
+CONFIG += qtestlib
+TEMPLATE = app
+
+greaterThan(QT_MAJOR_VERSION, 4) {
+    QT += widgets
+}
+
+DEFINES += QT_NO_CAST_FROM_ASCII \
+    QT_NO_CAST_TO_ASCII
+
+macx {
+    LIBS += -L$$OUT_PWD/../../bin/Tiled.app/Contents/Frameworks
+} else {
+    LIBS += -L$$OUT_PWD/../../lib
+}
+
+!win32:!macx {
+    QMAKE_RPATHDIR += \$\$ORIGIN/../../lib
+
+    # It is not possible to use ORIGIN in QMAKE_RPATHDIR, so a bit manually
+    QMAKE_LFLAGS += -Wl,-z,origin \'-Wl,-rpath,$$join(QMAKE_RPATHDIR, ":")\'
+    QMAKE_RPATHDIR =
+}
+
+# The parts of the editor needed to create a map document and undo changes
+# to its objects
+TILED_DIR = ../../src/tiled
+INCLUDEPATH += $$TILED_DIR
+DEPENDPATH += $$TILED_DIR
+
+# Input
+SOURCES += test_mapobjectmodel.cpp \
+    $$TILED_DIR/addremovelayer.cpp \
+    $$TILED_DIR/addremovemapobject.cpp \
+    $$TILED_DIR/addremovetileset.cpp \
+    $$TILED_DIR/batchobjectchanges.cpp \
+    $$TILED_DIR/changelayer.cpp \
+    $$TILED_DIR/changemapobject.cpp \
+    $$TILED_DIR/changeproperties.cpp \
+    $$TILED_DIR/changeselectedarea.cpp \
+    $$TILED_DIR/filesystemwatcher.cpp \
+    $$TILED_DIR/flipmapobjects.cpp \
+    $$TILED_DIR/layermodel.cpp \
+    $$TILED_DIR/mapdocument.cpp \
+    $$TILED_DIR/mapobjectmodel.cpp \
+    $$TILED_DIR/movelayer.cpp \
+    $$TILED_DIR/movemapobject.cpp \
+    $$TILED_DIR/movemapobjecttogroup.cpp \
+    $$TILED_DIR/objecttypes.cpp \
+    $$TILED_DIR/offsetlayer.cpp \
+    $$TILED_DIR/painttilelayer.cpp \
+    $$TILED_DIR/pluginmanager.cpp \
+    $$TILED_DIR/renamelayer.cpp \
+    $$TILED_DIR/renameterrain.cpp \
+    $$TILED_DIR/resizemap.cpp \
+    $$TILED_DIR/resizetilelayer.cpp \
+    $$TILED_DIR/rotatemapobject.cpp \
+    $$TILED_DIR/terrainmodel.cpp \
+    $$TILED_DIR/tileanimationdriver.cpp \
+    $$TILED_DIR/tilepainter.cpp \
+    $$TILED_DIR/tilesetmanager.cpp \
+    $$TILED_DIR/tmxmapreader.cpp \
+    $$TILED_DIR/tmxmapwriter.cpp
+HEADERS += $$TILED_DIR/filesystemwatcher.h \
+    $$TILED_DIR/layermodel.h \
+    $$TILED_DIR/mapdocument.h \
+    $$TILED_DIR/mapobjectmodel.h \
+    $$TILED_DIR/terrainmodel.h \
+    $$TILED_DIR/tileanimationdriver.h \
+    $$TILED_DIR/tilesetmanager.h
@@ -0,0 +1,89 @@
+#include "addremovemapobject.h"
+#include "map.h"
+#include "mapdocument.h"
+#include "mapobject.h"
+#include "mapobjectmodel.h"
+#include "objectgroup.h"
+#include "preferences.h"
+
+#include <QtTest/QtTest>
+#include <QUndoStack>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+// The map is never saved by these tests. Defining the bits of the preferences
+// used by the map writer avoids linking in the rest of the application.
+Preferences *Preferences::instance() { return 0; }
+bool Preferences::dtdEnabled() const { return false; }
+
+class test_MapObjectModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void undoScatteredRemoveMapObjects();
+};
+
+void test_MapObjectModel::undoScatteredRemoveMapObjects()
+{
+    Map *map = new Map(Map::Orthogonal, 100, 100, 32, 32);
+    ObjectGroup *objectGroup = new ObjectGroup(QLatin1String("Objects"),
+                                               0, 0, 100, 100);
+    map->addLayer(objectGroup);
+
+    QList<MapObject*> objects;
+    for (int i = 0; i < 60; ++i) {
+        MapObject *object = new MapObject(QString::number(i), QString(),
+                                          QPointF(i * 32, 0),
+                                          QSizeF(32, 32));
+        objectGroup->addObject(object);
+        objects.append(object);
+    }
+
+    MapDocument mapDocument(map);
+    MapObjectModel *model = mapDocument.mapObjectModel();
+
+    // Removing every third object leaves more separate row ranges than the
+    // model removes one by one
+    QList<MapObject*> removed;
+    for (int i = 0; i < objects.size(); i += 3)
+        removed.append(objects.at(i));
+
+    mapDocument.undoStack()->push(new RemoveMapObjects(&mapDocument, removed));
+    QCOMPARE(objectGroup->objectCount(), objects.size() - removed.size());
+
+    QSignalSpy resetSpy(model, SIGNAL(modelReset()));
+    QSignalSpy rowsInsertedSpy(model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    QSignalSpy objectsInsertedSpy(&mapDocument,
+                                  SIGNAL(objectsInserted(ObjectGroup*,int,int)));
+
+    mapDocument.undoStack()->undo();
+
+    // The objects are back at their original index
+    QCOMPARE(objectGroup->objects(), objects);
+    for (int i = 0; i < objects.size(); ++i)
+        QCOMPARE(objectGroup->indexOfObject(objects.at(i)), i);
+
+    // Each restored object was announced as an inserted row, which is what
+    // the map scene relies on to create its item
+    QCOMPARE(resetSpy.count(), 0);
+    QCOMPARE(rowsInsertedSpy.count(), removed.size());
+    QCOMPARE(objectsInsertedSpy.count(), removed.size());
+
+    QSet<int> insertedRows;
+    for (int i = 0; i < objectsInsertedSpy.count(); ++i) {
+        const QList<QVariant> arguments = objectsInsertedSpy.at(i);
+        const int first = arguments.at(1).toInt();
+        const int last = arguments.at(2).toInt();
+        QCOMPARE(first, last);
+        insertedRows.insert(first);
+    }
+    foreach (MapObject *object, removed)
+        QVERIFY(insertedRows.contains(objectGroup->indexOfObject(object)));
+
+    QCOMPARE(model->rowCount(model->index(objectGroup)), objects.size());
+}
+
+QTEST_MAIN(test_MapObjectModel)
+#include "test_mapobjectmodel.moc"
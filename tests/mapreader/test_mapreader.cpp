@@ -1,7 +1,11 @@
+#include "compression.h"
 #include "map.h"
 #include "mapobject.h"
+#include "mapwriter.h"
 #include "objectgroup.h"
+#include "tile.h"
 #include "tilelayer.h"
+#include "tileset.h"
 #include "mapreader.h"
 
 #include <QtTest/QtTest>
@@ -14,6 +18,9 @@ class test_MapReader : public QObject
 
 private slots:
     void loadMap();
+    void roundTripLayerData_data();
+    void roundTripLayerData();
+    void layerDataErrorLocation();
 };
 
 void test_MapReader::loadMap()
@@ -53,5 +60,134 @@ void test_MapReader::loadMap()
     QCOMPARE(mapObject->height(), qreal(64));
 }
 
+void test_MapReader::roundTripLayerData_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::addColumn<int>("compressionLevel");
+
+    QTest::newRow("csv") << int(Map::CSV) << -1;
+    QTest::newRow("base64") << int(Map::Base64) << -1;
+    QTest::newRow("gzip") << int(Map::Base64Gzip) << -1;
+    QTest::newRow("zlib") << int(Map::Base64Zlib) << 9;
+    QTest::newRow("zstd") << int(Map::Base64Zstd) << -1;
+    QTest::newRow("zstd level 19") << int(Map::Base64Zstd) << 19;
+    QTest::newRow("zstd invalid level") << int(Map::Base64Zstd) << 0;
+    QTest::newRow("lz4") << int(Map::Base64Lz4) << -1;
+    QTest::newRow("lz4 level 12") << int(Map::Base64Lz4) << 12;
+    QTest::newRow("lz4 invalid level") << int(Map::Base64Lz4) << 100;
+}
+
+void test_MapReader::roundTripLayerData()
+{
+    QFETCH(int, format);
+    QFETCH(int, compressionLevel);
+
+    const Map::LayerDataFormat layerDataFormat =
+            static_cast<Map::LayerDataFormat>(format);
+
+    if ((layerDataFormat == Map::Base64Zstd && !compressionSupported(Zstandard)) ||
+            (layerDataFormat == Map::Base64Lz4 && !compressionSupported(Lz4))) {
+#if QT_VERSION >= 0x050000
+        QSKIP("Compression method not supported by this build");
+#else
+        QSKIP("Compression method not supported by this build", SkipSingle);
+#endif
+    }
+
+    // The tileset image is read back from the temporary directory
+    const QString path = QDir::tempPath();
+    const QString imageFileName = path + QLatin1String("/test_mapreader_tiles.png");
+
+    QImage image(64, 64, QImage::Format_ARGB32);
+    image.fill(0xff808080);
+    QVERIFY(image.save(imageFileName));
+
+    Map map(Map::Orthogonal, 40, 30, 32, 32);
+    map.setLayerDataFormat(layerDataFormat);
+    map.setCompressionLevel(compressionLevel);
+
+    Tileset *tileset = new Tileset(QLatin1String("Tiles"), 32, 32);
+    QVERIFY(tileset->loadFromImage(image, imageFileName));
+    QCOMPARE(tileset->tileCount(), 4);
+    map.addTileset(tileset);
+
+    TileLayer *tileLayer = new TileLayer(QLatin1String("Ground"), 0, 0, 40, 30);
+    for (int y = 0; y < tileLayer->height(); ++y) {
+        for (int x = 0; x < tileLayer->width(); ++x) {
+            if ((x + y) % 5 == 0)
+                continue;
+
+            Cell cell(tileset->tileAt((x * 7 + y) % 4));
+            cell.flippedHorizontally = x % 3 == 0;
+            cell.flippedVertically = y % 4 == 0;
+            tileLayer->setCell(x, y, cell);
+        }
+    }
+    map.addLayer(tileLayer);
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::ReadWrite));
+    MapWriter writer;
+    writer.writeMap(&map, &buffer, path);
+    QVERIFY(buffer.seek(0));
+
+    MapReader reader;
+    Map *readMap = reader.readMap(&buffer, path);
+    QVERIFY2(readMap, qPrintable(reader.errorString()));
+
+    QCOMPARE(readMap->layerCount(), 1);
+    QCOMPARE(readMap->tilesetCount(), 1);
+    QCOMPARE(readMap->compressionLevel(), compressionLevel);
+
+    const TileLayer *readLayer = readMap->layerAt(0)->asTileLayer();
+    QVERIFY(readLayer);
+    QCOMPARE(readLayer->size(), tileLayer->size());
+
+    for (int y = 0; y < tileLayer->height(); ++y) {
+        for (int x = 0; x < tileLayer->width(); ++x) {
+            const Cell &expected = tileLayer->cellAt(x, y);
+            const Cell &actual = readLayer->cellAt(x, y);
+
+            QCOMPARE(actual.isEmpty(), expected.isEmpty());
+            if (expected.isEmpty())
+                continue;
+
+            QCOMPARE(actual.tile->id(), expected.tile->id());
+            QCOMPARE(actual.flippedHorizontally, expected.flippedHorizontally);
+            QCOMPARE(actual.flippedVertically, expected.flippedVertically);
+        }
+    }
+
+    qDeleteAll(readMap->tilesets());
+    delete readMap;
+    delete tileset;
+    QFile::remove(imageFileName);
+}
+
+void test_MapReader::layerDataErrorLocation()
+{
+    QByteArray data(
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<map version=\"1.0\" orientation=\"orthogonal\" width=\"2\" height=\"2\" tilewidth=\"32\" tileheight=\"32\">\n"
+        " <layer name=\"Ground\" width=\"2\" height=\"2\">\n"
+        "  <data encoding=\"csv\">\n"
+        "0,0,0\n"
+        "  </data>\n"
+        " </layer>\n"
+        " <objectgroup name=\"Objects\" width=\"0\" height=\"0\"/>\n"
+        "</map>\n");
+
+    QBuffer buffer(&data);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    MapReader reader;
+    Map *map = reader.readMap(&buffer);
+    QVERIFY(!map);
+
+    // The error points at the layer data rather than at the end of the map
+    QVERIFY2(reader.errorString().contains(QLatin1String("Line 4,")),
+             qPrintable(reader.errorString()));
+}
+
 QTEST_MAIN(test_MapReader)
 #include "test_mapreader.moc"